@@ -0,0 +1,79 @@
+// Checkpoint and restore times for one book of N resting orders: the
+// matcher's stall for a forked checkpoint, the child's write, an in-line
+// write, and the mmap restore into empty pools. Compare with the build
+// time, which is roughly what replaying the orders would cost.
+#include "book_registry.h"
+#include "checkpoint.h"
+#include "telemetry.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static double since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+static void run(const std::string &dir, uint64_t n) {
+  constexpr Price MID = 1'000'000;
+  constexpr uint64_t LEVELS = 2000; // per side
+
+  auto telemetry = std::make_unique<Telemetry>();
+  auto books = std::make_unique<BookRegistry>(*telemetry);
+  BookRegistry::Book &b = books->get(0);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < n; i++) {
+    bool is_buy = i % 2 == 0;
+    Price offset = (i / 2) % LEVELS;
+    b.book.addOrder(b.next_order_id++, is_buy ? MID - offset : MID + 1 + offset,
+                    1 + i % 100, is_buy, i % 64);
+  }
+  double build = since(t0);
+
+  Checkpointer checkpointer(dir, 1, 0, 1, CheckpointOptions{.every = 1});
+  checkpointer.poll(*books, 1, n);
+  double stall = checkpointer.fork_stall_max_ns() / 1e9;
+  checkpointer.wait();
+  double forked = checkpointer.last_write_ns() / 1e9;
+
+  checkpointer.write(*books, n);
+  double inline_write = checkpointer.last_write_ns() / 1e9;
+  uintmax_t bytes = fs::file_size(checkpointer.path());
+
+  books.reset();
+  telemetry = std::make_unique<Telemetry>();
+  books = std::make_unique<BookRegistry>(*telemetry);
+  JournalPosition from;
+  CheckpointRestoreStats restored = restore_checkpoints(
+      dir, [&](InstrumentId) -> BookRegistry & { return *books; }, from);
+
+  std::printf("orders=%-9lu file=%6.1f MiB build=%7.3fs fork_stall=%7.3fms "
+              "forked_write=%7.3fs inline_write=%7.3fs restore=%7.3fs "
+              "(%.1f M orders/s)%s\n",
+              n, bytes / 1048576.0, build, stall * 1e3, forked, inline_write,
+              restored.seconds, restored.orders / restored.seconds / 1e6,
+              restored.orders == n ? "" : " MISMATCH");
+}
+
+int main(int argc, char **argv) {
+  std::vector<uint64_t> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+  if (sizes.empty())
+    sizes = {1'000'000, 10'000'000};
+
+  std::string dir =
+      "/tmp/fastbook_checkpoint_bench_" + std::to_string(getpid());
+  for (uint64_t n : sizes) {
+    run(dir, n);
+    fs::remove_all(dir);
+  }
+}
@@ -0,0 +1,287 @@
+// Per-operation microbenchmarks for the book, the order pool and the SPSC
+// ring, each across resting depths of 1e3 to 1e7 orders.
+//
+// Books are built once per depth and shared by the benchmarks that follow.
+// Every timed batch is undone outside the timer (PauseTiming once per
+// BATCH operations), so each operation sees the same book shape however
+// many iterations the library picks.
+#include "order_pool.h"
+#include "orderbook.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <emmintrin.h>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t BATCH = 256;    // operations per timed batch
+constexpr Price MID = 1'000'000; // bids below, asks above
+constexpr Price LEVELS = 1000;   // per side
+// Resting order size, so crossing benchmarks never exhaust a level
+constexpr Volume DEEP = 1'000'000'000;
+// Beyond the ladder's tick window, so these levels live in the cold map
+constexpr Price FAR = LADDER_WINDOW_TICKS * 4;
+
+// A book with `depth` resting orders spread evenly over LEVELS levels per
+// side. Order ids 1..depth are resting; new orders take ids above that.
+struct BookFixture {
+  int64_t depth;
+  std::unique_ptr<Orderbook> book = std::make_unique<Orderbook>();
+  OrderId next_id;
+  std::mt19937_64 rng{42};
+
+  explicit BookFixture(int64_t n) : depth(n), next_id(n + 1) {
+    for (int64_t i = 0; i < n; i++) {
+      bool is_buy = i % 2 == 0;
+      Price offset = (i / 2) % LEVELS;
+      book->addOrder(i + 1, is_buy ? MID - 1 - offset : MID + 1 + offset, DEEP,
+                     is_buy, 1);
+    }
+  }
+
+  Price passive_bid() { return MID - 1 - rng() % LEVELS; }
+};
+
+BookFixture &book_at(int64_t depth) {
+  static std::unique_ptr<BookFixture> cached;
+  if (!cached || cached->depth != depth) {
+    cached.reset(); // free the old book before building the next
+    cached = std::make_unique<BookFixture>(depth);
+  }
+  return *cached;
+}
+
+struct PoolFixture {
+  int64_t depth;
+  Telemetry telemetry;
+  Matching::OrderPool pool{telemetry};
+  std::vector<uint64_t> ids; // resting ids in random order
+  uint64_t next_id;
+
+  explicit PoolFixture(int64_t n) : depth(n), next_id(n + 1) {
+    for (int64_t i = 1; i <= n; i++) {
+      pool.allocate(i, 1, 1);
+      ids.push_back(i);
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64{7});
+  }
+};
+
+PoolFixture &pool_at(int64_t depth) {
+  static std::unique_ptr<PoolFixture> cached;
+  if (!cached || cached->depth != depth) {
+    cached.reset();
+    cached = std::make_unique<PoolFixture>(depth);
+  }
+  return *cached;
+}
+
+// Reports throughput and, since an iteration may be a batch, time per op
+void finish(benchmark::State &state, size_t ops_per_iteration) {
+  state.SetItemsProcessed(state.iterations() * ops_per_iteration);
+  state.counters["per_op"] = benchmark::Counter(
+      static_cast<double>(ops_per_iteration),
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+}
+
+// --- Orderbook ---
+
+void BM_AddResting(benchmark::State &state) {
+  BookFixture &f = book_at(state.range(0));
+  std::vector<OrderId> added(BATCH);
+  for (auto _ : state) {
+    for (size_t i = 0; i < BATCH; i++) {
+      added[i] = f.next_id++;
+      f.book->addOrder(added[i], f.passive_bid(), 1, true, 1);
+    }
+    state.PauseTiming();
+    for (OrderId id : added)
+      f.book->removeOrder(id);
+    state.ResumeTiming();
+  }
+  finish(state, BATCH);
+}
+
+void BM_AddCrossing(benchmark::State &state) {
+  // Each buy takes 1 from the best ask and never rests, so the book is
+  // unchanged apart from that resting order's size
+  BookFixture &f = book_at(state.range(0));
+  Price best_ask = f.book->bestAsk()->first;
+  for (auto _ : state) {
+    for (size_t i = 0; i < BATCH; i++)
+      f.book->addOrder(f.next_id++, best_ask, 1, true, 1);
+  }
+  finish(state, BATCH);
+}
+
+void remove_at(benchmark::State &state, bool far) {
+  BookFixture &f = book_at(state.range(0));
+  std::vector<OrderId> added(BATCH);
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (size_t i = 0; i < BATCH; i++) {
+      added[i] = f.next_id++;
+      Price price = far ? MID - FAR - f.rng() % LEVELS : f.passive_bid();
+      f.book->addOrder(added[i], price, 1, true, 1);
+    }
+    state.ResumeTiming();
+    for (OrderId id : added)
+      f.book->removeOrder(id);
+  }
+  finish(state, BATCH);
+}
+
+void BM_RemoveNearMid(benchmark::State &state) { remove_at(state, false); }
+void BM_RemoveFarFromMid(benchmark::State &state) { remove_at(state, true); }
+
+void BM_MarketSweep(benchmark::State &state) {
+  // Sweeps the best k ask levels, then rebuilds them untimed
+  BookFixture &f = book_at(state.range(0));
+  const size_t k = state.range(1);
+  struct Resting {
+    Price price;
+    Volume qty;
+  };
+  std::vector<Resting> swept;
+  for (auto _ : state) {
+    state.PauseTiming();
+    swept.clear();
+    Volume total = 0;
+    f.book->top(Side::Ask, k, [&](const Level &level) {
+      level.for_each([&](const Matching::Order &o) {
+        swept.push_back({level.price, o.quantity_remaining});
+      });
+      total += level.volume;
+    });
+    state.ResumeTiming();
+
+    f.book->matchMarketOrder(true, total);
+
+    state.PauseTiming();
+    for (const Resting &r : swept)
+      f.book->addOrder(f.next_id++, r.price, r.qty, false, 1);
+    state.ResumeTiming();
+  }
+  state.counters["orders_per_sweep"] = static_cast<double>(swept.size());
+  finish(state, 1);
+}
+
+// --- OrderPool ---
+
+void BM_PoolAllocate(benchmark::State &state) {
+  PoolFixture &f = pool_at(state.range(0));
+  std::vector<uint64_t> added(BATCH);
+  for (auto _ : state) {
+    for (size_t i = 0; i < BATCH; i++) {
+      added[i] = f.next_id++;
+      benchmark::DoNotOptimize(f.pool.allocate(added[i], 1, 1));
+    }
+    state.PauseTiming();
+    for (uint64_t id : added)
+      f.pool.deallocate(id);
+    state.ResumeTiming();
+  }
+  finish(state, BATCH);
+}
+
+void BM_PoolFind(benchmark::State &state) {
+  PoolFixture &f = pool_at(state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(f.pool.find(f.ids[i]));
+    if (++i == f.ids.size())
+      i = 0;
+  }
+  finish(state, 1);
+}
+
+void BM_PoolDeallocate(benchmark::State &state) {
+  PoolFixture &f = pool_at(state.range(0));
+  size_t cursor = 0;
+  for (auto _ : state) {
+    size_t n = std::min(BATCH, f.ids.size());
+    for (size_t i = 0; i < n; i++)
+      f.pool.deallocate(f.ids[(cursor + i) % f.ids.size()]);
+    state.PauseTiming();
+    for (size_t i = 0; i < n; i++)
+      f.pool.allocate(f.ids[(cursor + i) % f.ids.size()], 1, 1);
+    cursor = (cursor + n) % f.ids.size();
+    state.ResumeTiming();
+  }
+  finish(state, std::min(BATCH, f.ids.size()));
+}
+
+// --- SPSCQueue ---
+
+void BM_SpscPingPong(benchmark::State &state) {
+  // One round trip: the benchmark thread sends a value, the echo thread
+  // sends it back. Both spin, yielding now and then so a single-CPU
+  // machine still makes progress.
+  using Queue = SPSCQueue<uint64_t, 1024>;
+  auto ping = std::make_unique<Queue>();
+  auto pong = std::make_unique<Queue>();
+  std::atomic<bool> stop{false};
+
+  auto spin = [](unsigned &spins) {
+    if (++spins % 1024 == 0)
+      std::this_thread::yield();
+    else
+      _mm_pause();
+  };
+
+  std::thread echo([&] {
+    unsigned spins = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (auto v = ping->dequeue()) {
+        while (!pong->enqueue(*v))
+          spin(spins);
+      } else {
+        spin(spins);
+      }
+    }
+  });
+
+  uint64_t seq = 0;
+  for (auto _ : state) {
+    unsigned spins = 0;
+    while (!ping->enqueue(seq))
+      spin(spins);
+    std::optional<uint64_t> back;
+    while (!(back = pong->dequeue()))
+      spin(spins);
+    benchmark::DoNotOptimize(*back);
+    seq++;
+  }
+  stop.store(true);
+  echo.join();
+  finish(state, 1);
+}
+
+void depths(benchmark::internal::Benchmark *b) {
+  b->RangeMultiplier(10)->Range(1'000, 10'000'000);
+}
+
+} // namespace
+
+BENCHMARK(BM_AddResting)->Apply(depths);
+BENCHMARK(BM_AddCrossing)->Apply(depths);
+BENCHMARK(BM_RemoveNearMid)->Apply(depths);
+BENCHMARK(BM_RemoveFarFromMid)->Apply(depths);
+BENCHMARK(BM_MarketSweep)
+    ->ArgsProduct({benchmark::CreateRange(1'000, 10'000'000, 10), {1, 10}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PoolAllocate)->Apply(depths);
+BENCHMARK(BM_PoolFind)->Apply(depths);
+BENCHMARK(BM_PoolDeallocate)->Apply(depths);
+BENCHMARK(BM_SpscPingPong)->UseRealTime();
+
+BENCHMARK_MAIN();
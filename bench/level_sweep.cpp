@@ -0,0 +1,181 @@
+// Cost per order of sweeping one deep price level: a market order through
+// Orderbook, against the intrusive doubly linked list the level's FIFO
+// replaced (reproduced here as ListOrder/ListLevel). Orders sit at random
+// slots of a 64 MB slab, as in a pool that has churned for a while, and
+// the caches are flushed before each sweep; optionally half the orders are
+// cancelled first.
+//   level_sweep [total orders per depth]
+#include "orderbook.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t SLAB = 1 << 20; // orders, 64 MB
+
+// The previous layout: the level's orders linked through their own slots
+struct alignas(64) ListOrder {
+  uint64_t quantity;
+  uint64_t quantity_remaining;
+  uint64_t account_id;
+  uint64_t order_id;
+  ListOrder *next = nullptr;
+  ListOrder *prev = nullptr;
+  void *level = nullptr;
+};
+
+struct ListLevel {
+  Volume volume{0};
+  uint32_t size{0};
+  ListOrder sentinel;
+
+  ListLevel() { sentinel.next = sentinel.prev = &sentinel; }
+
+  void push_back(ListOrder *o) {
+    o->next = &sentinel;
+    o->prev = sentinel.prev;
+    sentinel.prev->next = o;
+    sentinel.prev = o;
+    size++;
+    volume += o->quantity_remaining;
+  }
+
+  void pop(ListOrder *o) {
+    o->prev->next = o->next;
+    o->next->prev = o->prev;
+    o->next = o->prev = nullptr;
+    size--;
+    volume -= o->quantity_remaining;
+  }
+};
+
+// The old fill loop: trade, then unlink filled orders; the order ids stand
+// in for the pool deallocation
+uint64_t sweep(ListLevel &level, Volume quantity) {
+  uint64_t ids = 0;
+  ListOrder *resting = level.sentinel.next;
+  while (quantity > 0 && resting != &level.sentinel) {
+    Volume traded = std::min(quantity, resting->quantity_remaining);
+    quantity -= traded;
+    resting->quantity_remaining -= traded;
+    level.volume -= traded;
+    ListOrder *next = resting->next;
+    if (resting->quantity_remaining == 0) {
+      level.pop(resting);
+      ids += resting->order_id;
+    }
+    resting = next;
+  }
+  return ids;
+}
+
+void flush_caches() {
+  static std::vector<uint8_t> junk(64 << 20);
+  for (size_t i = 0; i < junk.size(); i += 64)
+    junk[i]++;
+}
+
+double run_list(ListOrder *slab, size_t depth, size_t rounds, bool holes,
+                std::mt19937_64 &rng, uint64_t &sink) {
+  std::vector<size_t> slots(SLAB);
+  std::iota(slots.begin(), slots.end(), 0);
+  double seconds = 0;
+  for (size_t r = 0; r < rounds; r++) {
+    // A fresh random pick of `depth` slots (partial Fisher-Yates)
+    for (size_t i = 0; i < depth; i++)
+      std::swap(slots[i], slots[i + rng() % (SLAB - i)]);
+    ListLevel level;
+    for (size_t i = 0; i < depth; i++) {
+      ListOrder *o = &slab[slots[i]];
+      o->quantity = o->quantity_remaining = 1;
+      o->order_id = i + 1;
+      level.push_back(o);
+    }
+    if (holes)
+      for (size_t i = 0; i < depth; i += 2)
+        level.pop(&slab[slots[i]]);
+
+    flush_caches();
+    auto t0 = std::chrono::steady_clock::now();
+    sink += sweep(level, level.volume);
+    seconds += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t0)
+                   .count();
+  }
+  return seconds;
+}
+
+// A book whose order pool has churned through SLAB orders: the free list
+// hands slots back in random order
+class ChurnedBook {
+  Orderbook book_;
+  OrderId next_id_{1};
+  static constexpr Price PRICE = 1000;
+
+public:
+  explicit ChurnedBook(std::mt19937_64 &rng) {
+    std::vector<OrderId> ids(SLAB);
+    for (auto &id : ids) {
+      id = next_id_++;
+      book_.addOrder(id, PRICE / 2, 1, true, 1);
+    }
+    std::shuffle(ids.begin(), ids.end(), rng);
+    for (OrderId id : ids)
+      book_.removeOrder(id);
+  }
+
+  double run(size_t depth, size_t rounds, bool holes, uint64_t &sink) {
+    double seconds = 0;
+    for (size_t r = 0; r < rounds; r++) {
+      OrderId first = next_id_;
+      for (size_t i = 0; i < depth; i++)
+        book_.addOrder(next_id_++, PRICE, 1, true, 1);
+      if (holes)
+        for (size_t i = 0; i < depth; i += 2)
+          book_.removeOrder(first + i);
+
+      Volume volume = book_.bestBid()->second;
+      flush_caches();
+      auto t0 = std::chrono::steady_clock::now();
+      sink += volume - book_.matchMarketOrder(false, volume);
+      seconds += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count();
+    }
+    return seconds;
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t total = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+  auto list_slab = std::make_unique<ListOrder[]>(SLAB);
+  std::mt19937_64 rng(42);
+  ChurnedBook book(rng);
+  uint64_t sink = 0;
+
+  std::printf("%8s %8s %12s %12s %8s\n", "depth", "holes", "list ns/ord",
+              "fifo ns/ord", "speedup");
+  for (size_t depth : {64, 1024, 16384, 131072}) {
+    for (bool holes : {false, true}) {
+      // Capped: every round flushes the caches
+      size_t rounds = std::clamp<size_t>(total / depth, 1, 256);
+      size_t swept = rounds * (holes ? depth / 2 : depth);
+      double list =
+          run_list(list_slab.get(), depth, rounds, holes, rng, sink);
+      double fifo = book.run(depth, rounds, holes, sink);
+      std::printf("%8zu %8s %12.1f %12.1f %7.2fx\n", depth,
+                  holes ? "half" : "none", list / swept * 1e9,
+                  fifo / swept * 1e9, list / fifo);
+    }
+  }
+  std::printf("(checksum %lu)\n", sink);
+}
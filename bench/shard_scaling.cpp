@@ -0,0 +1,108 @@
+// Total matching throughput against shard count. The replay file is fanned
+// out to `symbols` instruments (every symbol gets the same order stream) and
+// pushed through the same ingress ring -> ShardRouter -> shard ring path the
+// server uses, with shard i pinned to core i + 1.
+#include "TSCClock.h"
+#include "affinity.h"
+#include "order.h"
+#include "shard.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static OrderQueue staging;
+static OrderTags staging_tags; // untagged: bench orders have no session
+
+static std::vector<Client::Order> load(const char *path, size_t max) {
+  std::vector<Client::Order> orders(max);
+  FILE *f = std::fopen(path, "rb");
+  if (!f) {
+    std::perror(path);
+    std::exit(EXIT_FAILURE);
+  }
+  orders.resize(std::fread(orders.data(), sizeof(Client::Order), max, f));
+  std::fclose(f);
+  return orders;
+}
+
+static double run(unsigned n_shards, const std::vector<Client::Order> &src,
+                  unsigned symbols, uint64_t total, TSCClock clock) {
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::vector<Shard *> ptrs;
+  for (unsigned i = 0; i < n_shards; i++) {
+    shards.push_back(std::make_unique<Shard>(i));
+    shards.back()->set_verbose(false);
+    ptrs.push_back(shards.back().get());
+  }
+  ShardRouter router(ptrs);
+  std::atomic<bool> closed{false};
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (auto &s : shards) {
+    threads.emplace_back(&Shard::run, s.get(), std::ref(s->queue_),
+                         std::ref(s->tags_), std::cref(closed), clock);
+    pin_to_core(threads.back(), static_cast<int>(s->index()) + 1);
+  }
+
+  // Order k of symbol s is src[k] stamped with instrument s
+  uint64_t produced = 0;
+  while (produced < total) {
+    auto region = staging.claim(total - produced);
+    for (size_t i = 0; i < region.size(); i++, produced++) {
+      region[i] = src[(produced / symbols) % src.size()];
+      region[i].instrument = static_cast<InstrumentId>(produced % symbols);
+    }
+    staging.publish(region.size());
+    router.route(staging, staging_tags);
+  }
+  while (!staging.peek(1).empty())
+    router.route(staging, staging_tags);
+  closed.store(true, std::memory_order_release);
+
+  for (auto &t : threads)
+    t.join();
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count();
+
+  uint64_t processed = 0;
+  for (auto &s : shards)
+    processed += s->processed();
+  if (processed != total)
+    std::fprintf(stderr, "processed %lu of %lu orders\n", processed, total);
+  return secs;
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "client/orders.bin";
+  unsigned symbols = argc > 2 ? std::atoi(argv[2]) : 64;
+  uint64_t total = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 8'000'000;
+  unsigned max_shards = argc > 4 ? std::atoi(argv[4])
+                                 : std::max(1u, std::thread::hardware_concurrency() - 1);
+  symbols = std::max(1u, std::min(symbols, 65536u));
+
+  auto src = load(path, total / symbols + 1);
+  if (src.empty()) {
+    std::fprintf(stderr, "%s: no orders\n", path);
+    return EXIT_FAILURE;
+  }
+  TSCClock clock;
+
+  std::printf("%u symbols, %lu orders\n", symbols, total);
+  std::printf("%-8s %10s %14s %8s\n", "shards", "seconds", "orders/s",
+              "speedup");
+  double base = 0;
+  for (unsigned n = 1; n <= max_shards; n *= 2) {
+    double secs = run(n, src, symbols, total, clock);
+    double rate = total / secs;
+    if (n == 1)
+      base = rate;
+    std::printf("%-8u %10.3f %14.0f %7.2fx\n", n, secs, rate, rate / base);
+  }
+}
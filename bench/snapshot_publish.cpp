@@ -0,0 +1,76 @@
+// Cost of publishing one book's top levels to shared memory, measured on
+// the matching thread's side, alone and with a reader spinning on the same
+// slot in another thread.
+#include "TSCClock.h"
+#include "book_snapshot.h"
+#include "orderbook.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+static double run(SnapshotWriter &writer, Orderbook &book, uint64_t n) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < n; i++) {
+    // Change the top level so every publish writes fresh data
+    book.addOrder(1'000'000 + i, 100, 1, true, 1);
+    writer.publish(0, book);
+    book.removeOrder(1'000'000 + i);
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           t0)
+                 .count();
+  return s;
+}
+
+int main(int argc, char **argv) {
+  uint64_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5'000'000;
+  std::string name = "/fastbook_bench_" + std::to_string(getpid());
+  SnapshotWriter writer(name);
+  if (!writer.ok())
+    return EXIT_FAILURE;
+
+  Orderbook book;
+  for (uint64_t i = 0; i < 2 * SNAPSHOT_DEPTH; i++) {
+    book.addOrder(2 * i + 1, 100 - i, 10, true, 1);
+    book.addOrder(2 * i + 2, 101 + i, 10, false, 1);
+  }
+
+  // Baseline: the same add/cancel without the publish
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < n; i++) {
+    book.addOrder(1'000'000 + i, 100, 1, true, 1);
+    book.removeOrder(1'000'000 + i);
+  }
+  double base = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count();
+
+  double alone = run(writer, book, n);
+
+  std::atomic<bool> stop{false};
+  uint64_t reads = 0, retries = 0;
+  std::thread reader_thread([&] {
+    SnapshotReader reader(name);
+    Client::BookSnapshot snap;
+    while (!stop.load(std::memory_order_relaxed)) {
+      reader.read(0, snap);
+      reads++;
+    }
+    retries = reader.retries();
+  });
+  double contended = run(writer, book, n);
+  stop = true;
+  reader_thread.join();
+
+  std::printf("depth=%zu publishes=%lu\n", SNAPSHOT_DEPTH, n);
+  std::printf("%-22s %8.1f ns per publish\n", "alone",
+              (alone - base) / n * 1e9);
+  std::printf("%-22s %8.1f ns per publish\n", "with spinning reader",
+              (contended - base) / n * 1e9);
+  std::printf("reader: %lu reads, %lu retries (%.2f%%)\n", reads, retries,
+              reads ? 100.0 * retries / reads : 0.0);
+}
@@ -0,0 +1,74 @@
+// Producer/consumer throughput of SPSCQueue: the per-item enqueue/dequeue
+// path against the batched try_enqueue_n / peek+consume path.
+#include "order.h"
+#include "spsc_queue.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <thread>
+#include <vector>
+
+using Queue = SPSCQueue<Client::Order, 65536>;
+
+static Queue queue;
+constexpr size_t BATCH = 256;
+
+template <typename Producer, typename Consumer>
+double run(const char *name, uint64_t n, Producer produce, Consumer consume) {
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread consumer([&] { consume(n); });
+  produce(n);
+  consumer.join();
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           t0)
+                 .count();
+  std::printf("%-10s %8.2f M msgs/s\n", name, n / s / 1e6);
+  return s;
+}
+
+int main(int argc, char **argv) {
+  uint64_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50'000'000;
+  std::vector<Client::Order> src(BATCH);
+  for (size_t i = 0; i < BATCH; i++)
+    src[i].order_id = i;
+
+  run(
+      "per-item", n,
+      [&](uint64_t total) {
+        for (uint64_t i = 0; i < total; i++)
+          while (!queue.enqueue(src[i % BATCH]))
+            ;
+      },
+      [&](uint64_t total) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < total;) {
+          if (auto o = queue.dequeue()) {
+            sum += o->order_id;
+            i++;
+          }
+        }
+        std::printf("           checksum=%lu\n", sum);
+      });
+
+  run(
+      "batched", n,
+      [&](uint64_t total) {
+        for (uint64_t i = 0; i < total;) {
+          size_t off = i % BATCH;
+          size_t want = std::min<uint64_t>(BATCH - off, total - i);
+          i += queue.try_enqueue_n(std::span(src.data() + off, want));
+        }
+      },
+      [&](uint64_t total) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < total;) {
+          auto batch = queue.peek(BATCH);
+          for (const auto &o : batch)
+            sum += o.order_id;
+          queue.consume(batch.size());
+          i += batch.size();
+        }
+        std::printf("           checksum=%lu\n", sum);
+      });
+}
@@ -0,0 +1,55 @@
+// Prints the engine's shared-memory top of book for one instrument.
+//   book_top /fastbook [instrument] [--watch]
+#include "book_snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static void print(InstrumentId instrument, const Client::BookSnapshot &s) {
+  std::printf("instrument %u, update %lu\n", instrument, s.updates);
+  std::printf("%12s %12s %6s | %-12s %-12s %-6s\n", "bid vol", "bid",
+              "orders", "ask", "ask vol", "orders");
+  uint64_t rows = std::max(s.bid_count, s.ask_count);
+  for (uint64_t i = 0; i < rows; i++) {
+    if (i < s.bid_count)
+      std::printf("%12lu %12lu %6lu | ", s.bids[i].volume, s.bids[i].price,
+                  s.bids[i].orders);
+    else
+      std::printf("%12s %12s %6s | ", "", "", "");
+    if (i < s.ask_count)
+      std::printf("%-12lu %-12lu %-6lu\n", s.asks[i].price, s.asks[i].volume,
+                  s.asks[i].orders);
+    else
+      std::printf("\n");
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s /NAME [instrument] [--watch]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  InstrumentId instrument = argc > 2 ? std::atoi(argv[2]) : 0;
+  bool watch = argc > 3 && std::strcmp(argv[3], "--watch") == 0;
+
+  SnapshotReader reader(argv[1]);
+  if (!reader.ok())
+    return EXIT_FAILURE;
+
+  Client::BookSnapshot snap;
+  uint64_t last = ~uint64_t{0};
+  do {
+    if (!reader.read(instrument, snap)) {
+      std::fprintf(stderr, "instrument %u has no snapshot slot\n", instrument);
+      return EXIT_FAILURE;
+    }
+    if (snap.updates != last) {
+      last = snap.updates;
+      print(instrument, snap);
+    }
+    if (watch)
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  } while (watch);
+}
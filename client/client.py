@@ -1,8 +1,14 @@
 import socket
+import struct
+import threading
 import time
 
 FILENAME = "client/orders.bin"
 
+# type, side, instrument, session, order_id, price, quantity, leaves
+REPORT = struct.Struct("<BBHIQQQQ")
+REPORT_TYPES = ("ack", "fill", "cancelled", "rejected")
+
 
 def wait_for_server(host='127.0.0.1', port=8080):
     print(f"Waiting for server on port {port}...")
@@ -15,12 +21,31 @@ def wait_for_server(host='127.0.0.1', port=8080):
             time.sleep(0.025)
 
 
+def read_reports(sock, counts):
+    # Drains execution reports until the engine closes the session
+    pending = b""
+    while True:
+        chunk = sock.recv(1 << 20)
+        if not chunk:
+            break
+        pending += chunk
+        whole = len(pending) - len(pending) % REPORT.size
+        for fields in REPORT.iter_unpack(pending[:whole]):
+            counts[fields[0]] += 1
+        pending = pending[whole:]
+
+
 def fire_orders(sock):
     with open(FILENAME, "rb") as f:
         data = f.read()
 
     send = sock.sendall
 
+    # Reports must be read while sending, or the engine's writes back up
+    counts = [0] * len(REPORT_TYPES)
+    reader = threading.Thread(target=read_reports, args=(sock, counts))
+    reader.start()
+
     t0 = time.time()
     send(data)
     t1 = time.time()
@@ -30,6 +55,13 @@ def fire_orders(sock):
     print(f"Replayed {N:,} orders in {
           elapsed:.3f}s → {N/elapsed:,.0f} orders/sec")
 
+    # Half-close so the engine sees the end of the stream but can still
+    # send reports for orders in flight
+    sock.shutdown(socket.SHUT_WR)
+    reader.join()
+    print("Reports: " + ", ".join(
+        f"{name}={n:,}" for name, n in zip(REPORT_TYPES, counts)))
+
     sock.close()
 
 
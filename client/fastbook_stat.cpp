@@ -0,0 +1,65 @@
+// Prints the engine's live stats from shared memory (--stats=/NAME).
+//   fastbook_stat /NAME [--watch]
+#include "stats_reporter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static void print(const Client::EngineStats &s) {
+  std::printf("update %lu, up %.1fs, last %.0f ms\n", s.updates,
+              s.uptime_ns / 1e9, s.interval_ns / 1e6);
+  std::printf("ingress: %lu msgs, %.2f M msgs/s, %lu syscalls\n",
+              s.ingress_msgs, s.ingress_msgs_per_sec / 1e6,
+              s.ingress_syscalls);
+  std::printf("network core %ld%s, fifo %lu, memory %s\n", s.network_core,
+              s.network_core_isolated ? " (isolated)" : "",
+              s.network_fifo_priority,
+              s.memory_locked ? "locked" : "pageable");
+  std::printf("%5s %12s %8s %10s %10s %6s %8s %10s %8s %8s %8s %8s\n",
+              "shard", "orders", "M/s", "matched", "cancelled", "books",
+              "levels", "resting", "p50", "p99", "p999", "max");
+  for (uint64_t i = 0; i < s.shards; i++) {
+    const Client::StatsShard &h = s.shard[i];
+    std::printf("%5lu %12lu %8.2f %10lu %10lu %6lu %8lu %10lu %8lu %8lu "
+                "%8lu %8lu\n",
+                i, h.orders, h.orders_per_sec / 1e6, h.matched, h.cancelled,
+                h.books, h.levels, h.resting, h.p50_ns, h.p99_ns, h.p999_ns,
+                h.max_ns);
+  }
+  std::printf("%5s %12s %12s %12s %12s %6s %5s  (stage p99, ns)\n",
+              "shard", "network", "queue", "book", "ring hw", "core",
+              "fifo");
+  for (uint64_t i = 0; i < s.shards; i++) {
+    const Client::StatsShard &h = s.shard[i];
+    std::printf("%5lu %12lu %12lu %12lu %12lu %5ld%s %5lu\n", i,
+                h.network_p99_ns, h.queue_p99_ns, h.book_p99_ns,
+                h.queue_high_water, h.core, h.core_isolated ? "i" : " ",
+                h.fifo_priority);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s /NAME [--watch]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  bool watch = argc > 2 && std::strcmp(argv[2], "--watch") == 0;
+
+  StatsReader reader(argv[1]);
+  if (!reader.ok())
+    return EXIT_FAILURE;
+
+  Client::EngineStats stats;
+  uint64_t last = ~uint64_t{0};
+  do {
+    reader.read(stats);
+    if (stats.updates != last) {
+      last = stats.updates;
+      print(stats);
+    }
+    if (watch)
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  } while (watch);
+}
@@ -0,0 +1,147 @@
+// Writes a seeded synthetic order stream in the wire format the engine
+// reads, generating chunks on all cores. Same distributions as
+// gen_orders.py; see --help for the knobs.
+//   gen_orders --orders=100000000 --seed=7 --out=client/orders.bin
+#include "order_gen.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Matches "--name=<number>" and stores the value; false if `arg` is another
+// option. A malformed number is reported as an unknown option.
+template <typename T>
+bool parse(std::string_view arg, std::string_view prefix, T &out) {
+  if (arg.substr(0, prefix.size()) != prefix)
+    return false;
+  std::string_view value = arg.substr(prefix.size());
+  auto [end, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), out);
+  return ec == std::errc{} && end == value.data() + value.size();
+}
+
+[[noreturn]] void usage(const char *prog) {
+  OrderGenParams d;
+  std::fprintf(
+      stderr,
+      "Usage: %s [options]\n"
+      "  --orders=N           orders to write (default: 10000000)\n"
+      "  --out=FILE           binary output (default: client/orders.bin)\n"
+      "  --csv=FILE           also write the orders as CSV (slow)\n"
+      "  --seed=N             (default: %lu)\n"
+      "  --threads=N          generator threads (default: all cores)\n"
+      "  --chunk=N            orders per seeded chunk (default: %lu)\n"
+      "  --fair-price=N       mid the prices are drawn around (default: "
+      "%lu)\n"
+      "  --price-decay=X      Laplace rate of |price - mid| (default: %g)\n"
+      "  --qty-median=X       lognormal quantity median (default: %g)\n"
+      "  --qty-sigma=X        lognormal quantity shape (default: %g)\n"
+      "  --buy-ratio=X        share of buys (default: %g)\n"
+      "  --p-limit=X          share of limit orders (default: %g)\n"
+      "  --p-market=X         share of market orders; cancels take the "
+      "rest (default: %g)\n"
+      "  --far-threshold=N    ticks from mid beyond which a limit is far "
+      "(default: %lu)\n"
+      "  --far-cancel=X       share of cancels aimed at far orders "
+      "(default: %g)\n"
+      "  --accounts=N         account ids 1..N (default: %u)\n"
+      "  --instrument=N       instrument of every order (default: %u)\n",
+      prog, d.seed, d.chunk, d.fair_price, d.price_decay, d.qty_median,
+      d.qty_sigma, d.buy_ratio, d.p_limit, d.p_market, d.far_threshold,
+      d.far_cancel, d.accounts, d.instrument);
+  std::exit(EXIT_FAILURE);
+}
+
+bool valid(const OrderGenParams &p) {
+  auto share = [](double x) { return x >= 0 && x <= 1; };
+  return share(p.buy_ratio) && share(p.p_limit) && share(p.p_market) &&
+         share(p.far_cancel) && p.p_limit + p.p_market > 0 &&
+         p.p_limit + p.p_market <= 1 && p.price_decay > 0 &&
+         p.qty_median > 0 && p.qty_sigma >= 0 && p.accounts > 0 &&
+         p.chunk > 0;
+}
+
+bool write_csv(const char *path, std::span<const Client::Order> orders) {
+  FILE *f = std::fopen(path, "w");
+  if (!f) {
+    std::perror(path);
+    return false;
+  }
+  std::setvbuf(f, nullptr, _IOFBF, 1 << 20);
+  std::fprintf(f, "side,type,acct,price,quantity,order_id\n");
+  for (const Client::Order &o : orders)
+    std::fprintf(f, "%u,%u,%u,%lu,%lu,%lu\n", static_cast<unsigned>(o.side),
+                 static_cast<unsigned>(o.order_type), o.account_id, o.price,
+                 o.quantity, o.order_id);
+  return std::fclose(f) == 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  OrderGenParams params;
+  uint64_t orders = 10'000'000;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string out = "client/orders.bin";
+  std::string csv;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (parse(arg, "--orders=", orders) ||
+        parse(arg, "--seed=", params.seed) ||
+        parse(arg, "--threads=", threads) ||
+        parse(arg, "--chunk=", params.chunk) ||
+        parse(arg, "--fair-price=", params.fair_price) ||
+        parse(arg, "--price-decay=", params.price_decay) ||
+        parse(arg, "--qty-median=", params.qty_median) ||
+        parse(arg, "--qty-sigma=", params.qty_sigma) ||
+        parse(arg, "--buy-ratio=", params.buy_ratio) ||
+        parse(arg, "--p-limit=", params.p_limit) ||
+        parse(arg, "--p-market=", params.p_market) ||
+        parse(arg, "--far-threshold=", params.far_threshold) ||
+        parse(arg, "--far-cancel=", params.far_cancel) ||
+        parse(arg, "--accounts=", params.accounts) ||
+        parse(arg, "--instrument=", params.instrument))
+      continue;
+    if (arg.substr(0, 6) == "--out=")
+      out = arg.substr(6);
+    else if (arg.substr(0, 6) == "--csv=")
+      csv = arg.substr(6);
+    else
+      usage(argv[0]);
+  }
+  if (!valid(params) || orders == 0)
+    usage(argv[0]);
+
+  const size_t bytes = orders * sizeof(Client::Order);
+  int fd = open(out.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || ftruncate(fd, bytes) != 0) {
+    std::perror(out.c_str());
+    return EXIT_FAILURE;
+  }
+  void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    std::perror("mmap");
+    return EXIT_FAILURE;
+  }
+  std::span<Client::Order> stream(static_cast<Client::Order *>(p), orders);
+
+  double seconds = generate_orders(params, stream, threads);
+  std::printf("Generated %lu orders around mid=%lu in %.2fs (%.1f M "
+              "orders/s), seed %lu, %u threads -> %s\n",
+              orders, params.fair_price, seconds, orders / seconds / 1e6,
+              params.seed, threads, out.c_str());
+
+  bool ok = csv.empty() || write_csv(csv.c_str(), stream);
+  munmap(p, bytes);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
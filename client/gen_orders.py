@@ -11,6 +11,7 @@ SPREAD_TICKS = 2
 BUY_RATIO = 0.5
 TICK_SIZE = 1
 ACCOUNT_ID_MAX = 100_000
+INSTRUMENT = 0             # single-book replay; shard_bench fans it out
 
 # distribution params
 BUY_RATIO = 0.52           # slight imbalance
@@ -134,7 +135,7 @@ def generate_orders(bin_path, csv_path):
                         live_ids.remove(oid)
                     side, price, qty, account_id = 0, 0, 0, 0
 
-            payload = pack("<BBxxLQQQ", side, evt,
+            payload = pack("<BBHLQQQ", side, evt, INSTRUMENT,
                            account_id, price, qty, oid)
             fbin.write(payload)
             w.writerow([side, evt, account_id, price, qty, oid])
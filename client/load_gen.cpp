@@ -0,0 +1,375 @@
+// Open-loop load generator: replays an order file over one or more TCP
+// sessions on a fixed schedule, whether or not the engine keeps up, and
+// times each order from its scheduled send to its response.
+//   load_gen --rate=200000 --connections=4 --orders=2000000
+//
+// Latency is reported twice. "corrected" runs from the time the schedule
+// said to send, so a stall that delays later sends (a full socket buffer,
+// a slow engine) counts against every order it held back, which is what a
+// production client arriving at that rate would see. "raw" runs from the
+// actual send, as a closed-loop client would measure it.
+//
+// Connection c replays the file on instrument c and owns that book, so its
+// reports can be paired with its orders (see response_matcher.h). Start the
+// engine fresh for each run.
+#include "exec_report.h"
+#include "order.h"
+#include "replay.h"
+#include "response_matcher.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <emmintrin.h>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t SEND_BATCH = 64; // most orders coalesced into one send()
+constexpr uint64_t SPIN_NS = 20'000; // sleep until this close, then spin
+
+// Matches "--name=<number>" and stores the value; false if `arg` is another
+// option. A malformed number is reported as an unknown option.
+template <typename T>
+bool parse(std::string_view arg, std::string_view prefix, T &out) {
+  if (arg.substr(0, prefix.size()) != prefix)
+    return false;
+  std::string_view value = arg.substr(prefix.size());
+  auto [end, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), out);
+  return ec == std::errc{} && end == value.data() + value.size();
+}
+
+[[noreturn]] void usage(const char *prog) {
+  std::fprintf(
+      stderr,
+      "Usage: %s [options]\n"
+      "  --file=FILE          orders to replay (default: client/orders.bin)\n"
+      "  --connect=IP:PORT    engine address (default: 127.0.0.1:8080)\n"
+      "  --connections=N      sessions, each replaying the file on its own "
+      "instrument (default: 1)\n"
+      "  --orders=N           orders per session (default: whole file)\n"
+      "  --rate=R             orders/s offered across all sessions; 0 "
+      "sends unpaced (default: 100000)\n"
+      "  --poisson            exponential inter-arrival times at --rate\n"
+      "  --schedule=FILE      recorded send times: one little-endian uint64 "
+      "ns offset per order\n"
+      "  --seed=N             --poisson seed (default: 1)\n"
+      "  --latencies=FILE     write every order's timestamps as CSV\n",
+      prog);
+  std::exit(EXIT_FAILURE);
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Session {
+  int fd{-1};
+  InstrumentId instrument{0};
+  // Nanoseconds since the run started, per order; received is 0 until the
+  // order is answered
+  std::vector<uint64_t> intended, sent, received;
+  uint64_t reports[4]{};
+  uint64_t mismatched{0};
+  uint64_t max_lag{0}; // furthest a send fell behind its schedule
+};
+
+uint64_t since(Clock::time_point t0) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              t0)
+      .count();
+}
+
+void wait_until(Clock::time_point t0, uint64_t at) {
+  uint64_t now = since(t0);
+  if (at > now + SPIN_NS) {
+    auto wake = t0 + std::chrono::nanoseconds(at - SPIN_NS);
+    timespec ts{};
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  wake.time_since_epoch())
+                  .count();
+    ts.tv_sec = ns / 1'000'000'000;
+    ts.tv_nsec = ns % 1'000'000'000;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+  }
+  while (since(t0) < at)
+    _mm_pause();
+}
+
+bool send_all(int fd, const void *data, size_t len) {
+  auto p = static_cast<const char *>(data);
+  while (len > 0) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      perror("send");
+      return false;
+    }
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+// Sends orders on schedule, batching those already due into one send()
+void sender(Session &s, std::span<const Client::Order> orders,
+            Clock::time_point t0, bool paced) {
+  Client::Order batch[SEND_BATCH];
+  for (size_t i = 0; i < orders.size();) {
+    if (paced)
+      wait_until(t0, s.intended[i]);
+    uint64_t now = since(t0);
+    size_t k = 0;
+    for (; i + k < orders.size() && k < SEND_BATCH &&
+           (!paced || s.intended[i + k] <= now);
+         k++) {
+      batch[k] = orders[i + k];
+      batch[k].instrument = s.instrument;
+      if (!paced)
+        s.intended[i + k] = now;
+      s.sent[i + k] = now;
+      s.max_lag = std::max(s.max_lag, now - s.intended[i + k]);
+    }
+    if (!send_all(s.fd, batch, k * sizeof(Client::Order)))
+      break;
+    i += k;
+  }
+  // The engine sees the end of the stream but still reports orders in
+  // flight, then closes
+  shutdown(s.fd, SHUT_WR);
+}
+
+void receiver(Session &s, std::span<const Client::Order> orders,
+              Clock::time_point t0) {
+  ResponseMatcher matcher(orders);
+  auto buf = std::make_unique<uint8_t[]>(1 << 20);
+  size_t have = 0;
+  ssize_t n;
+  while ((n = recv(s.fd, buf.get() + have, (1 << 20) - have, 0)) > 0) {
+    uint64_t now = since(t0);
+    have += n;
+    size_t whole = have - have % sizeof(Client::ExecReport);
+    for (size_t off = 0; off < whole; off += sizeof(Client::ExecReport)) {
+      Client::ExecReport r;
+      std::memcpy(&r, buf.get() + off, sizeof(r));
+      s.reports[static_cast<size_t>(r.type) & 3]++;
+      size_t i = matcher.on_report(r);
+      if (i != ResponseMatcher::NOT_A_RESPONSE)
+        s.received[i] = now;
+    }
+    std::memmove(buf.get(), buf.get() + whole, have - whole);
+    have -= whole;
+  }
+  s.mismatched = matcher.mismatched();
+  close(s.fd);
+}
+
+int connect_to(const std::string &host, uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+      connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    perror("connect");
+    close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+void print_percentiles(const char *name, const char *kind,
+                       std::vector<uint64_t> &ns) {
+  if (ns.empty())
+    return;
+  std::sort(ns.begin(), ns.end());
+  auto at = [&](double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p * ns.size()));
+    return ns[std::max<size_t>(rank, 1) - 1] / 1e3;
+  };
+  std::printf("%-7s %-9s %10zu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+              kind, ns.size(), at(0.5), at(0.9), at(0.99), at(0.999),
+              at(0.9999), ns.back() / 1e3);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string file = "client/orders.bin";
+  std::string host = "127.0.0.1";
+  uint16_t port = 8080;
+  unsigned connections = 1;
+  uint64_t per_session = 0;
+  double rate = 100'000;
+  bool poisson = false;
+  uint64_t seed = 1;
+  std::string schedule_path, latencies_path;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (parse(arg, "--connections=", connections) ||
+        parse(arg, "--orders=", per_session) || parse(arg, "--rate=", rate) ||
+        parse(arg, "--seed=", seed))
+      continue;
+    if (arg.substr(0, 7) == "--file=") {
+      file = arg.substr(7);
+    } else if (arg.substr(0, 10) == "--connect=") {
+      std::string_view ep = arg.substr(10);
+      size_t colon = ep.rfind(':');
+      if (colon == std::string_view::npos ||
+          !parse(ep, ep.substr(0, colon + 1), port))
+        usage(argv[0]);
+      host = ep.substr(0, colon);
+    } else if (arg == "--poisson") {
+      poisson = true;
+    } else if (arg.substr(0, 11) == "--schedule=") {
+      schedule_path = arg.substr(11);
+    } else if (arg.substr(0, 12) == "--latencies=") {
+      latencies_path = arg.substr(12);
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (connections == 0 || rate < 0 || (poisson && rate == 0))
+    usage(argv[0]);
+
+  OrderFile order_file(file);
+  if (!order_file.ok())
+    return EXIT_FAILURE;
+  auto orders = order_file.orders();
+  if (per_session && per_session < orders.size())
+    orders = orders.first(per_session);
+  const size_t n = orders.size();
+
+  // Schedules: evenly spaced and staggered across sessions, exponential,
+  // or recorded
+  std::vector<uint64_t> offsets;
+  if (!schedule_path.empty()) {
+    FILE *f = std::fopen(schedule_path.c_str(), "rb");
+    if (!f) {
+      std::perror(schedule_path.c_str());
+      return EXIT_FAILURE;
+    }
+    offsets.resize(n);
+    offsets.resize(std::fread(offsets.data(), sizeof(uint64_t), n, f));
+    std::fclose(f);
+    if (offsets.size() < n) {
+      std::fprintf(stderr, "%s holds %zu send times for %zu orders\n",
+                   schedule_path.c_str(), offsets.size(), n);
+      return EXIT_FAILURE;
+    }
+  }
+  const bool paced = !offsets.empty() || rate > 0;
+
+  std::vector<Session> sessions(connections);
+  for (unsigned c = 0; c < connections; c++) {
+    Session &s = sessions[c];
+    s.instrument = static_cast<InstrumentId>(c);
+    s.intended.resize(n);
+    s.sent.resize(n);
+    s.received.assign(n, 0);
+    const double gap_ns = rate > 0 ? 1e9 * connections / rate : 0;
+    std::mt19937_64 rng(seed + c);
+    std::exponential_distribution<double> exp(1.0 / (gap_ns ? gap_ns : 1));
+    double t = gap_ns * c / connections;
+    for (size_t i = 0; i < n; i++) {
+      if (!offsets.empty())
+        s.intended[i] = offsets[i];
+      else
+        s.intended[i] = static_cast<uint64_t>(t);
+      t += poisson ? exp(rng) : gap_ns;
+    }
+    s.fd = connect_to(host, port);
+    if (s.fd < 0)
+      return EXIT_FAILURE;
+  }
+
+  // Leave the engine time to register the sessions before the clock starts
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const Clock::time_point t0 = Clock::now();
+  std::vector<std::thread> threads;
+  for (Session &s : sessions) {
+    threads.emplace_back(receiver, std::ref(s), orders, t0);
+    threads.emplace_back(sender, std::ref(s), orders, t0, paced);
+  }
+  for (auto &t : threads)
+    t.join();
+
+  uint64_t last_sent = 0, answered = 0, mismatched = 0, max_lag = 0;
+  uint64_t reports[4]{};
+  for (const Session &s : sessions) {
+    last_sent = std::max(last_sent, s.sent.back());
+    answered += std::count_if(s.received.begin(), s.received.end(),
+                              [](uint64_t r) { return r != 0; });
+    mismatched += s.mismatched;
+    max_lag = std::max(max_lag, s.max_lag);
+    for (int k = 0; k < 4; k++)
+      reports[k] += s.reports[k];
+  }
+  const uint64_t total = n * connections;
+  const char *pacing = !offsets.empty() ? "recorded"
+                       : !paced         ? "unpaced"
+                       : poisson        ? "poisson"
+                                        : "uniform";
+  std::printf("[LoadGen] %lu orders over %u sessions, offered at %.0f/s "
+              "(%s), sent in %.3fs (%.0f/s)\n",
+              total, connections, rate, pacing, last_sent / 1e9,
+              total / (last_sent / 1e9));
+  std::printf("[LoadGen] answered %lu/%lu, mismatched %lu, max send lag "
+              "%.1fus; reports ack=%lu fill=%lu cancelled=%lu "
+              "rejected=%lu\n",
+              answered, total, mismatched, max_lag / 1e3, reports[0],
+              reports[1], reports[2], reports[3]);
+
+  // Percentiles of answered orders, all and per order type
+  std::printf("%-7s %-9s %10s %9s %9s %9s %9s %9s %9s\n", "type", "latency",
+              "count", "p50 us", "p90 us", "p99 us", "p99.9 us", "p99.99 us",
+              "max us");
+  const char *names[] = {"limit", "market", "cancel"};
+  for (int type = -1; type < 3; type++) {
+    std::vector<uint64_t> corrected, raw;
+    for (const Session &s : sessions)
+      for (size_t i = 0; i < n; i++) {
+        if (!s.received[i] ||
+            (type >= 0 && static_cast<int>(orders[i].order_type) != type))
+          continue;
+        corrected.push_back(s.received[i] - s.intended[i]);
+        raw.push_back(s.received[i] - s.sent[i]);
+      }
+    const char *name = type < 0 ? "all" : names[type];
+    print_percentiles(name, "corrected", corrected);
+    print_percentiles(name, "raw", raw);
+  }
+
+  if (!latencies_path.empty()) {
+    FILE *f = std::fopen(latencies_path.c_str(), "w");
+    if (!f) {
+      std::perror(latencies_path.c_str());
+      return EXIT_FAILURE;
+    }
+    std::setvbuf(f, nullptr, _IOFBF, 1 << 20);
+    std::fprintf(f, "session,seq,type,intended_ns,sent_ns,received_ns\n");
+    for (unsigned c = 0; c < connections; c++)
+      for (size_t i = 0; i < n; i++)
+        std::fprintf(f, "%u,%zu,%u,%lu,%lu,%lu\n", c, i,
+                     static_cast<unsigned>(orders[i].order_type),
+                     sessions[c].intended[i], sessions[c].sent[i],
+                     sessions[c].received[i]);
+    std::fclose(f);
+  }
+  return mismatched == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -40,7 +40,7 @@ int main() {
   auto t1 = std::chrono::steady_clock::now();
 
   double seconds = std::chrono::duration<double>(t1 - t0).count();
-  size_t N = size / 25;
+  size_t N = size / 32; // sizeof(Client::Order)
 
   std::cout << "Replayed " << N << " orders in " << seconds << "s → "
             << (N / seconds) << " orders/sec\n";
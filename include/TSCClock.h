@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <emmintrin.h>
@@ -10,35 +11,42 @@
 
 using namespace std;
 
-class TSCClock {
-private:
-  double nanoseconds_per_cycle_;
-
-public:
-  TSCClock() {
-    cout << "TSC: Calibrating hardware clock... (1 second)\n";
+// Where the TSC frequency came from, and whether the TSC can be trusted
+// across cores and power states
+struct TscCalibration {
+  double hz{0};
+  const char *source{""}; // "cpuid 0x15", "cpuid 0x16", "hypervisor",
+                          // "tsc_freq_khz" or "measured"
+  bool invariant{false};  // CPUID 0x80000007 EDX bit 8
+};
 
-    auto os_start = chrono::high_resolution_clock::now();
-    // pipeline fence
-    _mm_lfence();
+// Converts TSC cycles to nanoseconds. Every TSCClock shares one process-wide
+// calibration, done by the first constructor without sleeping: the
+// frequency is read from CPUID leaf 0x15/0x16, the hypervisor's timing leaf
+// or the kernel's tsc_freq_khz, and only measured (for 20 ms) when none of
+// those is available. A clock is an empty handle, so copying it is free.
+//
+// Conversion is a fixed-point multiply by a shared multiplier, which
+// run_tsc_drift_correction() refines in the background.
+class TSCClock {
+  static constexpr unsigned SHIFT = 32;
+  __extension__ typedef unsigned __int128 uint128;
+  inline static std::atomic<uint64_t> mult_{0}; // ns per cycle << SHIFT
 
-    uint64_t tsc_start = __rdtsc();
-    this_thread::sleep_for(std::chrono::seconds(1));
-    auto os_end = chrono::high_resolution_clock::now();
+  static const TscCalibration &shared();
 
-    unsigned int aux;
-    uint64_t tsc_end = __rdtscp(&aux);
+public:
+  TSCClock() { shared(); }
 
-    uint64_t os_nanoseconds =
-        chrono::duration_cast<chrono::nanoseconds>(os_end - os_start).count();
-    uint64_t elapsed_cycles = tsc_end - tsc_start;
+  static const TscCalibration &calibration() { return shared(); }
 
-    nanoseconds_per_cycle_ =
-        static_cast<double>(os_nanoseconds) / elapsed_cycles;
+  // TSC frequency measured against CLOCK_MONOTONIC_RAW over `window`
+  static double measure_hz(std::chrono::nanoseconds window);
 
-    cout << "TSC: Calibration completed: 1 cycle = " << nanoseconds_per_cycle_
-         << " nanoseconds\n";
-  }
+  // Re-derives the frequency from the TSC and CLOCK_MONOTONIC_RAW time
+  // elapsed since calibration (once that is at least 100 ms) and installs
+  // it; returns the frequency in use
+  static double correct_drift();
 
   inline __attribute__((always_inline)) uint64_t start() const {
     _mm_lfence();
@@ -49,7 +57,39 @@ public:
     unsigned int aux;
     return __rdtscp(&aux);
   }
+
   inline uint64_t cycles_to_nanoseconds(uint64_t cycles) const {
-    return static_cast<uint64_t>(cycles * nanoseconds_per_cycle_);
+    return static_cast<uint64_t>(
+        (static_cast<uint128>(cycles) *
+         mult_.load(std::memory_order_relaxed)) >>
+        SHIFT);
+  }
+
+  // Fixed-point multiplier for a frequency, as cycles_to_nanoseconds() uses
+  static constexpr uint64_t mult_for(double hz) {
+    return static_cast<uint64_t>(1e9 / hz * double(uint64_t{1} << SHIFT) +
+                                 0.5);
   }
 };
+
+// Background thread: calls TSCClock::correct_drift() every `interval` until
+// `done` is set
+void run_tsc_drift_correction(std::chrono::milliseconds interval,
+                              const std::atomic<bool> &done);
+
+// TSC stamps that follow a run of orders through the pipeline: when the
+// network thread had their bytes in hand, and when it published them to
+// the order ring. Zero when nothing stamped them.
+struct OrderStamps {
+  uint64_t received{0};
+  uint64_t enqueued{0};
+};
+
+// A pipeline stamp; always 0 (unstamped) without telemetry
+inline __attribute__((always_inline)) uint64_t pipeline_stamp() {
+#ifdef ENABLE_TELEMETRY
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
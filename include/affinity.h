@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Pins a thread to a single CPU. Returns false (and leaves the thread
+// floating) if the core does not exist or the call is not permitted.
+inline bool pin_to_core(pthread_t thread, int core) {
+  int cores = static_cast<int>(std::thread::hardware_concurrency());
+  if (core < 0 || (cores > 0 && core >= cores)) {
+    std::fprintf(stderr, "[Affinity] core %d not available (%d online)\n",
+                 core, cores);
+    return false;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (err != 0) {
+    std::fprintf(stderr, "[Affinity] pin to core %d failed: %s\n", core,
+                 std::strerror(err));
+    return false;
+  }
+  return true;
+}
+
+inline bool pin_to_core(std::thread &thread, int core) {
+  return pin_to_core(thread.native_handle(), core);
+}
+
+// Moves a thread to SCHED_FIFO at `priority` (1-99). Needs CAP_SYS_NICE or
+// an RLIMIT_RTPRIO allowance; returns false and leaves it alone otherwise.
+// Only for pinned threads: a spinning FIFO thread never yields its core.
+inline bool set_fifo(pthread_t thread, int priority) {
+  sched_param param{};
+  param.sched_priority = priority;
+  int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+  if (err != 0) {
+    std::fprintf(stderr, "[Affinity] SCHED_FIFO %d failed: %s\n", priority,
+                 std::strerror(err));
+    return false;
+  }
+  return true;
+}
+
+// Locks every current and future page in RAM, so no page of the books or
+// rings is faulted in (or swapped out) on the hot path. Refuses under a
+// finite RLIMIT_MEMLOCK (unless root): later allocations past the limit
+// would fail instead of faulting.
+inline bool lock_memory() {
+  rlimit limit{};
+  if (geteuid() != 0 && getrlimit(RLIMIT_MEMLOCK, &limit) == 0 &&
+      limit.rlim_cur != RLIM_INFINITY) {
+    limit.rlim_cur = limit.rlim_max;
+    if (limit.rlim_max != RLIM_INFINITY ||
+        setrlimit(RLIMIT_MEMLOCK, &limit) != 0) {
+      std::fprintf(stderr, "[Affinity] mlockall skipped: RLIMIT_MEMLOCK is "
+                           "finite (raise ulimit -l)\n");
+      return false;
+    }
+  }
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    std::fprintf(stderr, "[Affinity] mlockall failed: %s\n",
+                 std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+// Parses a kernel CPU list such as "2-5,7"; stops at the first malformed
+// entry
+inline std::vector<int> parse_cpu_list(std::string_view list) {
+  std::vector<int> cores;
+  const char *p = list.data(), *end = list.data() + list.size();
+  while (p < end) {
+    int first = 0, last = 0;
+    auto r = std::from_chars(p, end, first);
+    if (r.ec != std::errc{})
+      break;
+    last = first;
+    if (r.ptr < end && *r.ptr == '-') {
+      r = std::from_chars(r.ptr + 1, end, last);
+      if (r.ec != std::errc{})
+        break;
+    }
+    for (int c = first; c <= last; c++)
+      cores.push_back(c);
+    if (r.ptr < end && *r.ptr != ',')
+      break;
+    p = r.ptr + 1;
+  }
+  return cores;
+}
+
+// Cores kept free of ordinary tasks (isolcpus=) or of the scheduler tick
+// (nohz_full=), per sysfs
+inline std::vector<int> isolated_cores(const char *which = "isolated") {
+  std::string path = std::string("/sys/devices/system/cpu/") + which;
+  FILE *f = std::fopen(path.c_str(), "r");
+  if (!f)
+    return {};
+  char line[1024] = {};
+  bool read = std::fgets(line, sizeof(line), f) != nullptr;
+  std::fclose(f);
+  if (!read)
+    return {};
+  std::string_view list(line);
+  while (!list.empty() && (list.back() == '\n' || list.back() == ' '))
+    list.remove_suffix(1);
+  return parse_cpu_list(list);
+}
+
+// Where a hot thread ended up, as reported at startup and in the stats
+// segment
+struct ThreadPlacement {
+  int core{-1};          // -1: floating
+  bool isolated{false};  // the core is in isolcpus= or nohz_full=
+  int fifo_priority{0};  // 0: default scheduling class
+};
+
+// Pins `thread` to `core` (if >= 0), then, only if pinned, moves it to
+// SCHED_FIFO at `fifo_priority` (if > 0). Reports what took effect and
+// warns when the core is shared with the rest of the system.
+inline ThreadPlacement place_thread(pthread_t thread, const char *name,
+                                    int core, int fifo_priority) {
+  ThreadPlacement placed;
+  if (core < 0 || !pin_to_core(thread, core))
+    return placed;
+  placed.core = core;
+
+  for (const char *which : {"isolated", "nohz_full"})
+    for (int c : isolated_cores(which))
+      placed.isolated |= c == core;
+  if (!placed.isolated)
+    std::fprintf(stderr, "[Affinity] %s: core %d is not isolated "
+                 "(isolcpus=/nohz_full=); other tasks may run on it\n",
+                 name, core);
+
+  if (fifo_priority > 0 && set_fifo(thread, fifo_priority))
+    placed.fifo_priority = fifo_priority;
+  return placed;
+}
+
+// "core 3, isolated, SCHED_FIFO 50", or "floating"
+inline std::string describe(const ThreadPlacement &p) {
+  if (p.core < 0)
+    return "floating";
+  std::string out = "core " + std::to_string(p.core);
+  out += p.isolated ? ", isolated" : ", shared";
+  if (p.fifo_priority > 0)
+    out += ", SCHED_FIFO " + std::to_string(p.fifo_priority);
+  return out;
+}
+
+// A thread's placement as telemetry: recorded once by main, readable from
+// any thread
+struct PlacementGauge {
+  std::atomic<int> core{-1};
+  std::atomic<bool> isolated{false};
+  std::atomic<int> fifo_priority{0};
+
+  void record(const ThreadPlacement &p) noexcept {
+    core.store(p.core, std::memory_order_relaxed);
+    isolated.store(p.isolated, std::memory_order_relaxed);
+    fifo_priority.store(p.fifo_priority, std::memory_order_relaxed);
+  }
+
+  ThreadPlacement load() const noexcept {
+    return {core.load(std::memory_order_relaxed),
+            isolated.load(std::memory_order_relaxed),
+            fifo_priority.load(std::memory_order_relaxed)};
+  }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "depth_feed.h"
+#include "exec_report.h"
+#include "huge_arena.h"
+#include "orderbook.h"
+#include "telemetry.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// The order books owned by one matching thread, indexed by instrument id.
+// Books are created on the first order for their symbol and share the
+// thread's telemetry, execution-report sink and depth tracker. Each book assigns its own
+// order ids, so a symbol's stream matches identically whichever shard it
+// lands on.
+class BookRegistry {
+public:
+  struct Book {
+    Orderbook book;
+    OrderId next_order_id{1};
+    bool touched{false}; // dispatched to since the last batch end
+
+    Book(Telemetry &telemetry, ExecSink *exec, DepthTracker *depth,
+         InstrumentId instrument, size_t order_slab, size_t level_slab,
+         HugeArena *arena = nullptr)
+        : book(telemetry, order_slab, level_slab, arena, LADDER_TICKS) {
+      book.set_exec_sink(exec);
+      book.set_depth_tracker(depth, instrument);
+    }
+  };
+
+  // Initial pool sizes per book; small because a thread may hold thousands
+  static constexpr size_t ORDER_SLAB = 1 << 12;
+  static constexpr size_t LEVEL_SLAB = 1 << 8;
+  // Tick window per side: 32 KB of level pointers, allocated on first use
+  static constexpr size_t LADDER_TICKS = 1 << 12;
+
+private:
+  Telemetry &telemetry_;
+  ExecSink *exec_;
+  DepthTracker *depth_;
+  HugeArena *arena_; // pool slabs, when not null
+  std::vector<std::unique_ptr<Book>> books_;
+  size_t count_{0};
+
+public:
+  explicit BookRegistry(Telemetry &telemetry, ExecSink *exec = nullptr,
+                        DepthTracker *depth = nullptr,
+                        HugeArena *arena = nullptr)
+      : telemetry_(telemetry), exec_(exec), depth_(depth), arena_(arena),
+        books_(size_t(std::numeric_limits<InstrumentId>::max()) + 1) {}
+
+  Book &get(InstrumentId instrument) {
+    auto &slot = books_[instrument];
+    if (!slot) [[unlikely]] {
+      slot = std::make_unique<Book>(telemetry_, exec_, depth_, instrument,
+                                    ORDER_SLAB, LEVEL_SLAB, arena_);
+      count_++;
+    }
+    return *slot;
+  }
+
+  // nullptr if no order for `instrument` has been seen
+  const Book *find(InstrumentId instrument) const noexcept {
+    return books_[instrument].get();
+  }
+
+  size_t size() const noexcept { return count_; }
+
+  template <typename F> void for_each(F &&fn) const {
+    for (size_t i = 0; i < books_.size(); i++) {
+      if (books_[i])
+        fn(static_cast<InstrumentId>(i), *books_[i]);
+    }
+  }
+};
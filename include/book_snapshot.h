@@ -0,0 +1,116 @@
+#pragma once
+
+#include "orderbook.h"
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+// Levels published per side
+constexpr size_t SNAPSHOT_DEPTH = 10;
+// Default slot count: one per InstrumentId (32 MB). A writer built with
+// fewer drops publishes for higher ids and counts them.
+constexpr size_t SNAPSHOT_SLOTS =
+    size_t(std::numeric_limits<InstrumentId>::max()) + 1;
+
+namespace Client {
+
+// Layout of the shared-memory segment: a header, then one BookSnapshot per
+// instrument id. Every field is a 64-bit word so both sides can copy it with
+// (relaxed) atomic accesses.
+struct SnapshotLevel {
+  uint64_t price;
+  uint64_t volume;
+  uint64_t orders;
+};
+
+struct alignas(64) BookSnapshot {
+  uint64_t seq;     // seqlock: odd while the matcher is writing
+  uint64_t updates; // publishes so far
+  uint64_t bid_count;
+  uint64_t ask_count;
+  SnapshotLevel bids[SNAPSHOT_DEPTH]; // best first
+  SnapshotLevel asks[SNAPSHOT_DEPTH];
+};
+
+struct alignas(64) SnapshotHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t depth;
+  uint64_t slots;
+};
+
+constexpr uint64_t SNAPSHOT_MAGIC = 0x46424f4f4b534e50; // "FBOOKSNP"
+constexpr uint64_t SNAPSHOT_VERSION = 1;
+
+static_assert(sizeof(BookSnapshot) % 64 == 0,
+              "BookSnapshot must fill whole cache lines");
+
+}; // namespace Client
+
+// Matcher side: owns a POSIX shared-memory segment and publishes books'
+// top levels into it. Each instrument has one writer (the shard that owns
+// it), so a slot's seqlock never sees two writers and the writer never
+// waits on readers.
+class SnapshotWriter {
+  std::string name_;
+  void *base_{nullptr};
+  size_t bytes_{0};
+  Client::BookSnapshot *slots_{nullptr};
+  size_t slots_count_{0};
+  std::atomic<uint64_t> dropped_{0};
+
+public:
+  // Creates the segment `name`, e.g. "/fastbook", with `slots` instrument
+  // slots (at most SNAPSHOT_SLOTS). An existing segment is reused: grown
+  // if needed but never truncated, since a reader still mapping it would
+  // fault, and its slots are cleared under their seqlocks.
+  explicit SnapshotWriter(const std::string &name,
+                          size_t slots = SNAPSHOT_SLOTS);
+  // Unmaps and unlinks; readers already attached keep their mapping
+  ~SnapshotWriter();
+
+  SnapshotWriter(const SnapshotWriter &) = delete;
+  SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+  bool ok() const noexcept { return slots_ != nullptr; }
+  const std::string &name() const noexcept { return name_; }
+  size_t slots() const noexcept { return slots_count_; }
+
+  // Copies the top SNAPSHOT_DEPTH levels of each side of `book`
+  void publish(InstrumentId instrument, const Orderbook &book) noexcept;
+
+  // Publishes dropped because the instrument id had no slot
+  uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+  void dump() const noexcept;
+};
+
+// Reader side, for risk/UI processes. Lock-free: a read that overlaps a
+// publish simply retries, and the writer never learns readers exist.
+class SnapshotReader {
+  void *base_{nullptr};
+  size_t bytes_{0};
+  const Client::BookSnapshot *slots_{nullptr};
+  uint64_t slots_count_{0};
+  uint64_t retries_{0};
+
+public:
+  explicit SnapshotReader(const std::string &name);
+  ~SnapshotReader();
+
+  SnapshotReader(const SnapshotReader &) = delete;
+  SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+  bool ok() const noexcept { return slots_ != nullptr; }
+
+  // Copies a consistent snapshot of `instrument` into `out`; false if the
+  // instrument has no slot
+  bool read(InstrumentId instrument, Client::BookSnapshot &out) noexcept;
+
+  // Reads that had to start over because a publish overlapped them
+  uint64_t retries() const noexcept { return retries_; }
+};
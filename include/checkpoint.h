@@ -0,0 +1,182 @@
+#pragma once
+
+#include "book_registry.h"
+#include "huge_arena.h"
+#include "journal.h"
+#include "types.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <sched.h>
+#include <span>
+#include <string>
+#include <sys/types.h>
+
+namespace Client {
+
+// A checkpoint file is a header, then for each book a CheckpointBook
+// followed by its levels, bids then asks, best first. Each level is
+// followed by its orders in time priority. Every record is a multiple of
+// 8 bytes, so a mapped file can be read in place.
+struct CheckpointHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t generation; // engine run that wrote the file
+  uint64_t shard;
+  uint64_t shards;          // files in the set
+  uint64_t journal_records; // the shard's journal records this covers
+  uint64_t books;
+  uint64_t levels;
+  uint64_t orders;
+  uint64_t bytes; // whole file, header included
+};
+
+struct CheckpointBook {
+  uint64_t next_order_id;
+  uint64_t levels;
+  uint64_t orders;
+  uint16_t instrument;
+  uint8_t reserved[6];
+};
+
+struct CheckpointLevel {
+  uint64_t price;
+  uint32_t orders;
+  Side side;
+  uint8_t reserved[3];
+};
+
+struct CheckpointOrder {
+  uint64_t order_id;
+  uint64_t quantity;
+  uint64_t remaining;
+  uint64_t account_id;
+};
+
+constexpr uint64_t CHECKPOINT_MAGIC = 0x4642434b50543031; // "FBCKPT01"
+constexpr uint64_t CHECKPOINT_VERSION = 1;
+
+static_assert(sizeof(CheckpointHeader) == 80);
+static_assert(sizeof(CheckpointBook) == 32);
+static_assert(sizeof(CheckpointLevel) == 16);
+static_assert(sizeof(CheckpointOrder) == 32);
+
+}; // namespace Client
+
+// Writes every book in `books` to `path`, going through `tmp` and a rename
+// so `path` only ever holds a whole file. Staging goes through `buffer` and
+// nothing is allocated or printed, so it is safe in a forked child of a
+// multithreaded process. The book/level/order counts of `header` are
+// filled in here.
+bool write_checkpoint(const char *path, const char *tmp,
+                      Client::CheckpointHeader header,
+                      const BookRegistry &books, std::span<uint8_t> buffer);
+
+struct CheckpointOptions {
+  uint64_t every{0}; // orders between background checkpoints; 0: exit only
+  // Where the books live; a hugetlb arena gates each fork (see below)
+  const HugeArena *arena{nullptr};
+};
+
+// One shard's checkpoints, written as <generation>-<shard>.checkpoint.
+//
+// While running, the matching thread fork()s every `every` orders and the
+// child writes the copy-on-write image of the books, so the fork itself
+// (page-table copy) is the only stall taken up front. The child drops the
+// matcher's core pinning and priority. At exit the final checkpoint is
+// written in-line.
+//
+// Copy-on-write is not free while the child runs: the first matcher write
+// to each page still shared with it copies that page. Under a hugetlb
+// arena that is a 2 MB copy (tens to hundreds of microseconds) per huge
+// page touched, taken from the reserved pool. If the pool runs dry the
+// kernel keeps the matcher going by unmapping the page from the child,
+// which dies of SIGBUS. So a fork only goes ahead while the pool has a
+// free page for every huge page the arena uses; otherwise that checkpoint
+// is skipped (and counted) and the next one tried `every` orders later.
+class Checkpointer {
+  std::string path_;
+  std::string tmp_;
+  Client::CheckpointHeader header_{};
+  CheckpointOptions opts_;
+  std::unique_ptr<uint8_t[]> buffer_;
+  cpu_set_t affinity_; // the process's, captured before the matcher pins
+
+  pid_t child_{-1};
+  uint64_t next_at_;
+  std::chrono::steady_clock::time_point child_start_;
+
+  uint64_t forks_{0};
+  uint64_t written_{0};
+  uint64_t failed_{0};
+  uint64_t skipped_{0}; // no copy-on-write headroom
+  uint64_t fork_ns_total_{0};
+  uint64_t fork_ns_max_{0};
+  uint64_t last_write_ns_{0};
+  uint64_t last_orders_{0};
+
+  void reap(bool wait);
+  bool cow_headroom() const noexcept;
+
+public:
+  static constexpr size_t BUFFER_BYTES = 1 << 20;
+
+  // Construct on a thread that is not pinned: the background child runs
+  // with that thread's affinity.
+  Checkpointer(const std::string &dir, uint64_t generation, size_t shard,
+               size_t shards, CheckpointOptions opts = {});
+  // Waits for a background write still in progress
+  ~Checkpointer();
+
+  Checkpointer(const Checkpointer &) = delete;
+  Checkpointer &operator=(const Checkpointer &) = delete;
+
+  const std::string &path() const noexcept { return path_; }
+
+  // Matching thread, between batches: reaps a finished child and forks the
+  // next one once `processed` has advanced by `every`. The first call forks
+  // straight away, so even a shard that never sees an order completes the
+  // set.
+  void poll(const BookRegistry &books, uint64_t processed,
+            uint64_t journal_records);
+
+  // Writes a checkpoint now, on the calling thread
+  bool write(const BookRegistry &books, uint64_t journal_records);
+
+  // Blocks until a background write in progress has finished
+  void wait() { reap(true); }
+
+  uint64_t forks() const noexcept { return forks_; }
+  uint64_t written() const noexcept { return written_; }
+  uint64_t failed() const noexcept { return failed_; }
+  uint64_t skipped() const noexcept { return skipped_; }
+  uint64_t fork_stall_max_ns() const noexcept { return fork_ns_max_; }
+  // Of the last write, forked (fork to exit) or in-line
+  uint64_t last_write_ns() const noexcept { return last_write_ns_; }
+  void dump() const noexcept;
+};
+
+struct CheckpointRestoreStats {
+  uint64_t generation{0};
+  uint64_t files{0};
+  uint64_t books{0};
+  uint64_t levels{0};
+  uint64_t orders{0};
+  uint64_t duplicates{0}; // orders whose id was already resting
+  double seconds{0};
+};
+
+// Loads the newest complete, well-formed checkpoint set in `dir`, putting
+// each book into the registry `books_for` returns for its instrument. Sets
+// `from` to the journal position the set covers; with no usable set,
+// nothing is loaded and `from` is left alone.
+CheckpointRestoreStats
+restore_checkpoints(
+    const std::string &dir,
+    const std::function<BookRegistry &(InstrumentId)> &books_for,
+    JournalPosition &from);
+
+// Generation number for a new run writing to `dir`
+uint64_t next_checkpoint_generation(const std::string &dir);
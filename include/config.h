@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class IngressBackend : uint8_t { Read = 0, Uring = 1 };
+
+// Startup options for the engine binary. Everything that needs privileges
+// or changes what a client sees (pinning, the arena, reports, live stats)
+// is off until asked for.
+struct EngineConfig {
+  IngressBackend ingress{IngressBackend::Read};
+  bool sqpoll{false}; // io_uring: let a kernel thread poll the submission queue
+  bool exit_when_idle{false}; // stop once the last session disconnects
+  unsigned shards{1};         // matching threads; instruments split by id
+  int first_core{-1};         // shard i on core first_core + i; -1: floating
+  int net_core{-1};           // network thread's core, -1: floating
+  int fifo_priority{0};       // SCHED_FIFO for pinned hot threads; 0: off
+  bool mlock{false};          // mlockall() before allocating
+  unsigned arena_mb{0};       // prefaulted huge page arena; 0: heap only
+  bool exec_reports{false};   // send execution reports back to sessions
+  std::string depth_host;     // UDP L2 feed destination
+  uint16_t depth_port{0};     // 0: no depth feed
+  std::string snapshot;       // shared-memory segment name, empty = off
+  unsigned snapshot_slots{1 << 16}; // instrument ids the segment holds
+  std::string journal;        // journal directory, empty = off
+  unsigned journal_sync_ms{10};
+  unsigned journal_segment_mb{64};
+  std::string checkpoint;         // checkpoint directory, empty = off
+  uint64_t checkpoint_every{0};   // orders per shard; 0: only at exit
+  std::string replay;             // order file to match instead of serving
+  bool replay_direct{false};      // replay without the SPSC ring
+  std::string latency_csv;        // latency histograms at exit, empty = off
+  unsigned stats_interval_ms{0}; // live stats cadence; 0: no reporter
+  std::string stats;                // stats shared-memory segment, empty = off
+};
+
+// Parses --flag / --flag=value arguments. Prints usage and exits on
+// anything it does not recognise.
+EngineConfig parse_args(int argc, char **argv);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "level.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Orderbook;
+
+namespace Client {
+
+#pragma pack(push, 1)
+// One price level's state after a batch. Volume 0 means the level is gone.
+struct DepthUpdate {
+  InstrumentId instrument;
+  Side side;
+  uint8_t flags;   // DEPTH_END_OF_BATCH on the last update of a batch
+  uint32_t orders; // resting orders at the level
+  uint64_t price;
+  uint64_t volume;
+};
+
+// Leads every feed datagram, followed by `count` DepthUpdates
+struct DepthPacketHeader {
+  uint64_t seq;   // per shard, +1 per datagram; a jump means loss
+  uint16_t shard; // matching thread the updates came from
+  uint16_t count;
+  uint32_t reserved;
+};
+#pragma pack(pop)
+
+constexpr uint8_t DEPTH_END_OF_BATCH = 1;
+
+static_assert(sizeof(DepthUpdate) == 24, "DepthUpdate size is not 24 bytes");
+static_assert(sizeof(DepthPacketHeader) == 16,
+              "DepthPacketHeader size is not 16 bytes");
+
+}; // namespace Client
+
+// Capacity of each matcher -> publisher depth ring
+constexpr size_t DEPTH_QUEUE_SIZE = 65536;
+using DepthQueue = SPSCQueue<Client::DepthUpdate, DEPTH_QUEUE_SIZE>;
+
+// Matcher-side half of the L2 feed. Books mark each level they change;
+// a level changed many times in one batch is listed once. flush() then
+// reads the current state of every listed level and pushes one update per
+// level, so publish cost follows the number of levels touched, not the
+// number of messages.
+class DepthTracker {
+  struct Change {
+    Orderbook *book;
+    InstrumentId instrument;
+    Side side;
+    Price price;
+  };
+
+  DepthQueue &ring_;
+  Telemetry &telemetry_;
+  std::vector<Change> changes_;
+  std::vector<Client::DepthUpdate> out_;
+  uint64_t events_{0};
+
+public:
+  DepthTracker(DepthQueue &ring, Telemetry &telemetry)
+      : ring_(ring), telemetry_(telemetry) {}
+
+  // `level` on `side` of `book` changed volume or was emptied
+  inline void touch(Orderbook *book, InstrumentId instrument, Side side,
+                    Level &level) {
+    events_++;
+    if (level.dirty)
+      return;
+    level.dirty = true;
+    changes_.push_back({book, instrument, side, level.price});
+  }
+
+  bool pending() const noexcept { return !changes_.empty(); }
+
+  // Publishes the batch's conflated updates; returns how many. Spins while
+  // the ring is full rather than leave the feed inconsistent.
+  size_t flush();
+};
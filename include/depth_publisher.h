@@ -0,0 +1,58 @@
+#pragma once
+
+#include "depth_feed.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+// Opens a UDP socket connected to host:port for the depth feed; -1 (after
+// printing why) on failure.
+int open_depth_feed(const std::string &host, uint16_t port);
+
+// Publisher thread of the L2 feed: drains every shard's depth ring and
+// sends the updates as UDP datagrams, many datagrams per sendmmsg(). Each
+// datagram carries one shard's updates behind a DepthPacketHeader, and the
+// update bytes are sent straight out of ring memory.
+class DepthPublisher {
+  // Updates per datagram, keeping datagrams inside a 1500-byte MTU
+  static constexpr size_t UPDATES_PER_DATAGRAM =
+      (1472 - sizeof(Client::DepthPacketHeader)) / sizeof(Client::DepthUpdate);
+  static constexpr size_t MAX_DATAGRAMS = 64; // per sendmmsg()
+  static constexpr size_t PUBLISH_BATCH = UPDATES_PER_DATAGRAM * MAX_DATAGRAMS;
+
+  std::vector<DepthQueue *> rings_;
+  std::vector<uint64_t> seq_; // next datagram seq per shard
+  int fd_;
+
+  std::vector<Client::DepthPacketHeader> headers_;
+  std::vector<iovec> iov_;
+  std::vector<mmsghdr> msgs_;
+
+  uint64_t updates_{0};
+  uint64_t datagrams_{0};
+  uint64_t syscalls_{0};
+  uint64_t dropped_{0}; // datagrams the kernel refused
+
+  void publish(size_t shard, const Client::DepthUpdate *first, size_t n);
+
+public:
+  // Takes ownership of `fd`, a connected datagram socket
+  DepthPublisher(std::vector<DepthQueue *> rings, int fd);
+  ~DepthPublisher();
+
+  DepthPublisher(const DepthPublisher &) = delete;
+  DepthPublisher &operator=(const DepthPublisher &) = delete;
+
+  // Runs until `done` is set and every ring is drained
+  void run(const std::atomic<bool> &done);
+
+  uint64_t updates() const noexcept { return updates_; }
+  uint64_t datagrams() const noexcept { return datagrams_; }
+  uint64_t syscalls() const noexcept { return syscalls_; }
+  uint64_t dropped() const noexcept { return dropped_; }
+  void dump() const noexcept;
+};
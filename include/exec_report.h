@@ -0,0 +1,90 @@
+#pragma once
+
+#include "TSCClock.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <emmintrin.h>
+#include <optional>
+
+enum class ExecType : uint8_t {
+  Ack = 0,       // limit order accepted
+  Fill = 1,      // partial or full execution
+  Cancelled = 2, // cancel done, or unfilled market remainder
+  Rejected = 3,  // unknown cancel target, or market order with no liquidity
+};
+
+namespace Client {
+
+#pragma pack(push, 1)
+struct ExecReport {
+  ExecType type;
+  Side side;
+  InstrumentId instrument;
+  uint32_t session;  // engine routing tag; clients may ignore it
+  uint64_t order_id; // engine order id; the client's for market orders
+  uint64_t price;    // execution price for fills, limit price otherwise
+  uint64_t quantity; // traded quantity for fills, order quantity otherwise
+  uint64_t leaves;   // quantity still open after this report
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ExecReport) == 40, "ExecReport size is not 40 bytes");
+
+}; // namespace Client
+
+// Capacity of each matcher -> writer report ring
+constexpr size_t EXEC_QUEUE_SIZE = 65536;
+using ExecQueue = SPSCQueue<Client::ExecReport, EXEC_QUEUE_SIZE>;
+
+// Matcher-side end of the egress path. The match loop sets the session and
+// instrument of the order it is working on; the book then emits reports
+// straight into the outbound ring. Reports for session 0 (replays) are not
+// emitted. A full ring spins the matcher rather than lose a fill.
+class ExecSink {
+  ExecQueue &ring_;
+  Telemetry &telemetry_;
+  std::optional<TSCClock> clock_;
+  uint32_t session_{0};
+  InstrumentId instrument_{0};
+
+public:
+  ExecSink(ExecQueue &ring, Telemetry &telemetry)
+      : ring_(ring), telemetry_(telemetry) {}
+
+  // Enables per-report cost measurement
+  void set_clock(TSCClock clock) { clock_ = clock; }
+
+  inline void begin(uint32_t session, InstrumentId instrument) noexcept {
+    session_ = session;
+    instrument_ = instrument;
+  }
+
+  uint32_t session() const noexcept { return session_; }
+
+  inline void emit(ExecType type, uint32_t session, OrderId order_id,
+                   Side side, Price price, Volume quantity, Volume leaves) {
+    if (session == 0)
+      return;
+
+#ifdef ENABLE_TELEMETRY
+    uint64_t start = clock_ ? clock_->start() : 0;
+#endif
+    Client::ExecReport report{type,     side,     instrument_, session,
+                              order_id, price,    quantity,    leaves};
+    if (!ring_.enqueue(report)) [[unlikely]] {
+      telemetry_.record_exec_ring_full();
+      while (!ring_.enqueue(report))
+        _mm_pause();
+    }
+#ifdef ENABLE_TELEMETRY
+    uint64_t ns =
+        clock_ ? clock_->cycles_to_nanoseconds(clock_->stop() - start) : 0;
+    telemetry_.record_exec(ns);
+#else
+    telemetry_.record_exec(0);
+#endif
+  }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "exec_report.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+#include <unordered_map>
+#include <vector>
+
+// Egress thread: drains the matchers' report rings and writes each session's
+// reports with one sendmsg() per session per round. Runs of consecutive
+// reports for the same session are sent straight out of the ring memory as
+// a single iovec, so reports are copied only if the socket pushes back.
+//
+// The network thread registers sessions with open()/close(). The writer
+// works on its own dup() of each socket, so closing the session on the
+// network thread can never redirect reports to a recycled descriptor.
+class ExecWriter {
+  struct Control {
+    uint32_t tag;
+    int fd; // -1: session closed
+  };
+
+  struct Conn {
+    int fd;
+    bool dead{false};
+    // Set by close(): reports for orders still in flight are delivered
+    // until then
+    std::chrono::steady_clock::time_point close_at{};
+    std::vector<iovec> iov;       // this round's ring runs
+    std::vector<uint8_t> backlog; // bytes the socket refused
+  };
+
+  // Bytes kept per session while its client is not reading; beyond this
+  // reports are dropped
+  static constexpr size_t MAX_BACKLOG = 1 << 20;
+  static constexpr size_t WRITE_BATCH = 4096; // reports per ring per round
+  static constexpr unsigned BACKLOG_RETRY_SPINS = 1024; // idle rounds
+  // How long a closed session, and run() after shutdown, keep delivering
+  // before dropping what is left
+  static constexpr std::chrono::seconds LINGER{1};
+
+  std::vector<ExecQueue *> rings_;
+  SPSCQueue<Control, 1024> control_;
+  std::unordered_map<uint32_t, Conn> conns_;
+  std::vector<Conn *> dirty_;
+
+  uint64_t bytes_{0};
+  uint64_t syscalls_{0};
+  uint64_t dropped_{0};
+
+  void apply_control();
+  void enqueue_run(uint32_t tag, const Client::ExecReport *first, size_t n);
+  void flush(Conn &conn);
+  void send_backlog(Conn &conn);
+  void buffer(Conn &conn, const iovec *iov, size_t n, size_t skip);
+  void release(Conn &conn);
+  bool backlogged() const noexcept;
+  void reap(std::chrono::steady_clock::time_point now);
+
+public:
+  explicit ExecWriter(std::vector<ExecQueue *> rings);
+  ~ExecWriter();
+
+  ExecWriter(const ExecWriter &) = delete;
+  ExecWriter &operator=(const ExecWriter &) = delete;
+
+  // Network thread: start/stop delivering reports tagged `tag` to `fd`. A
+  // session that stops sending may still have orders in the matchers, so
+  // close() keeps its socket open for LINGER before releasing it.
+  void open(uint32_t tag, int fd);
+  void close(uint32_t tag);
+
+  // Writer thread: runs until `done` is set and every ring is drained. Any
+  // backlog still unsent after LINGER is dropped.
+  void run(const std::atomic<bool> &done);
+
+  // Reports handed to the kernel
+  uint64_t reports() const noexcept {
+    return bytes_ / sizeof(Client::ExecReport);
+  }
+  uint64_t dropped() const noexcept { return dropped_; }
+  uint64_t syscalls() const noexcept { return syscalls_; }
+  void dump() const noexcept;
+};
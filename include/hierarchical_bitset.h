@@ -0,0 +1,110 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Three-level occupancy bitset. Every bit of a summary word marks a non-zero
+// word in the level below, so first/last/next/prev set-bit lookups touch at
+// most one word per level regardless of how sparse the set is.
+template <size_t Bits> class HierarchicalBitset {
+  static_assert((Bits & (Bits - 1)) == 0, "Bits must be a power of 2");
+  static_assert(Bits >= 64 && Bits <= 64 * 64 * 64,
+                "Bits must fit in three 64-bit levels");
+
+  static constexpr size_t L0_WORDS = Bits / 64;
+  static constexpr size_t L1_WORDS = (L0_WORDS + 63) / 64;
+
+  std::array<uint64_t, L0_WORDS> l0_{};
+  std::array<uint64_t, L1_WORDS> l1_{};
+  uint64_t l2_{0};
+
+  static inline size_t lowest(uint64_t w) noexcept { return __builtin_ctzll(w); }
+  static inline size_t highest(uint64_t w) noexcept {
+    return 63 - __builtin_clzll(w);
+  }
+
+public:
+  static constexpr size_t npos = ~size_t{0};
+
+  bool none() const noexcept { return l2_ == 0; }
+
+  bool test(size_t i) const noexcept { return (l0_[i >> 6] >> (i & 63)) & 1; }
+
+  void set(size_t i) noexcept {
+    l0_[i >> 6] |= 1ULL << (i & 63);
+    l1_[i >> 12] |= 1ULL << ((i >> 6) & 63);
+    l2_ |= 1ULL << (i >> 12);
+  }
+
+  void reset(size_t i) noexcept {
+    if ((l0_[i >> 6] &= ~(1ULL << (i & 63))) != 0)
+      return;
+    if ((l1_[i >> 12] &= ~(1ULL << ((i >> 6) & 63))) != 0)
+      return;
+    l2_ &= ~(1ULL << (i >> 12));
+  }
+
+  // Lowest set bit >= i, or npos
+  size_t find_next(size_t i) const noexcept {
+    if (i >= Bits)
+      return npos;
+
+    size_t w = i >> 6;
+    uint64_t bits = l0_[w] & (~0ULL << (i & 63));
+    if (bits)
+      return (w << 6) + lowest(bits);
+
+    size_t w1 = w + 1;
+    if (w1 >= L0_WORDS)
+      return npos;
+
+    size_t s = w1 >> 6;
+    uint64_t summary = l1_[s] & (~0ULL << (w1 & 63));
+    if (!summary) {
+      size_t s1 = s + 1;
+      if (s1 >= L1_WORDS)
+        return npos;
+      uint64_t top = l2_ & (~0ULL << s1);
+      if (!top)
+        return npos;
+      s = lowest(top);
+      summary = l1_[s];
+    }
+
+    w = (s << 6) + lowest(summary);
+    return (w << 6) + lowest(l0_[w]);
+  }
+
+  // Highest set bit <= i, or npos
+  size_t find_prev(size_t i) const noexcept {
+    if (i >= Bits)
+      i = Bits - 1;
+
+    size_t w = i >> 6;
+    uint64_t bits = l0_[w] & (~0ULL >> (63 - (i & 63)));
+    if (bits)
+      return (w << 6) + highest(bits);
+
+    if (w == 0)
+      return npos;
+
+    size_t w1 = w - 1;
+    size_t s = w1 >> 6;
+    uint64_t summary = l1_[s] & (~0ULL >> (63 - (w1 & 63)));
+    if (!summary) {
+      if (s == 0)
+        return npos;
+      uint64_t top = l2_ & (~0ULL >> (64 - s));
+      if (!top)
+        return npos;
+      s = highest(top);
+      summary = l1_[s];
+    }
+
+    w = (s << 6) + highest(summary);
+    return (w << 6) + highest(l0_[w]);
+  }
+
+  size_t find_first() const noexcept { return find_next(0); }
+  size_t find_last() const noexcept { return find_prev(Bits - 1); }
+};
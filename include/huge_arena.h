@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+// How an arena's memory is backed, best first
+enum class ArenaBacking : uint8_t {
+  None,    // no arena: every allocation goes to the heap
+  HugeTLB, // MAP_HUGETLB, from the reserved 2 MB page pool
+  THP,     // ordinary pages with MADV_HUGEPAGE, left to khugepaged
+  Small,   // 4 KB pages; THP unavailable
+};
+
+const char *to_string(ArenaBacking backing) noexcept;
+
+// Reserved huge pages nobody holds yet (HugePages_Free less HugePages_Rsvd
+// in `meminfo`), or -1 if it cannot be read. Syscalls only, no allocation.
+long free_huge_pages(const char *meminfo = "/proc/meminfo") noexcept;
+
+// One up-front reservation for the slabs and rings the hot threads touch.
+// The whole range is mapped and prefaulted when the engine starts, so a pool
+// growing mid-session bumps a pointer instead of calling malloc and taking
+// thousands of page faults, and the TLB covers it in 2 MB entries. Tries
+// MAP_HUGETLB, then transparent huge pages, then plain pages; a capacity of
+// 0 or a failed mapping leaves the arena empty and callers on the heap.
+//
+// Allocation is a lock-free bump shared by every thread; nothing is handed
+// back before the arena goes away.
+class HugeArena {
+  std::byte *base_{nullptr};
+  size_t capacity_{0};
+  ArenaBacking backing_{ArenaBacking::None};
+  double prefault_seconds_{0};
+  std::atomic<size_t> used_{0};
+  std::atomic<uint64_t> misses_{0};
+
+public:
+  static constexpr size_t HUGE_PAGE = size_t{2} << 20;
+
+  // Reserves and prefaults `bytes`, rounded up to whole huge pages
+  explicit HugeArena(size_t bytes);
+  ~HugeArena();
+
+  HugeArena(const HugeArena &) = delete;
+  HugeArena &operator=(const HugeArena &) = delete;
+
+  // `bytes` aligned to `align` (a power of two), or nullptr once the arena
+  // cannot fit it; the caller then falls back to the heap
+  void *allocate(size_t bytes, size_t align) noexcept;
+
+  bool ok() const noexcept { return base_ != nullptr; }
+  bool contains(const void *p) const noexcept {
+    auto *b = static_cast<const std::byte *>(p);
+    return base_ && b >= base_ && b < base_ + capacity_;
+  }
+  ArenaBacking backing() const noexcept { return backing_; }
+  size_t capacity() const noexcept { return capacity_; }
+  size_t used() const noexcept {
+    return std::min(used_.load(std::memory_order_relaxed), capacity_);
+  }
+  // Allocations that did not fit and went to the heap
+  uint64_t misses() const noexcept {
+    return misses_.load(std::memory_order_relaxed);
+  }
+  double prefault_seconds() const noexcept { return prefault_seconds_; }
+
+  // Huge pages a fork()ed child can make the parent copy from the reserved
+  // pool: every 2 MB page in use, when hugetlb-backed. THP and 4 KB pages
+  // copy into ordinary memory, so they need none.
+  size_t cow_pages() const noexcept {
+    return backing_ == ArenaBacking::HugeTLB
+               ? (used() + HUGE_PAGE - 1) / HUGE_PAGE
+               : 0;
+  }
+
+  void dump() const;
+};
+
+// Frees what make_arena_array / arena_new handed out: destroys the objects
+// and returns heap fallbacks to the heap; arena memory stays with the arena.
+template <typename T> struct ArenaDelete {
+  size_t count{0};
+  bool heap{true};
+
+  void operator()(T *p) const noexcept {
+    std::destroy_n(p, count);
+    if (heap)
+      ::operator delete(p, std::align_val_t(alignof(T)));
+  }
+};
+
+template <typename T>
+using ArenaArray = std::unique_ptr<T[], ArenaDelete<T>>;
+template <typename T> using ArenaPtr = std::unique_ptr<T, ArenaDelete<T>>;
+
+namespace arena_detail {
+template <typename T>
+std::pair<void *, bool> storage(HugeArena *arena, size_t count) {
+  void *p = arena ? arena->allocate(count * sizeof(T), alignof(T)) : nullptr;
+  if (p)
+    return {p, false};
+  return {::operator new(count * sizeof(T), std::align_val_t(alignof(T))),
+          true};
+}
+} // namespace arena_detail
+
+// `count` value-initialised Ts from `arena`, or from the heap when it is
+// null or full
+template <typename T>
+ArenaArray<T> make_arena_array(HugeArena *arena, size_t count) {
+  auto [p, heap] = arena_detail::storage<T>(arena, count);
+  T *first = static_cast<T *>(p);
+  std::uninitialized_value_construct_n(first, count);
+  return ArenaArray<T>(first, ArenaDelete<T>{count, heap});
+}
+
+// One T built in `arena` (or on the heap) from `args`
+template <typename T, typename... Args>
+ArenaPtr<T> arena_new(HugeArena *arena, Args &&...args) {
+  auto [p, heap] = arena_detail::storage<T>(arena, 1);
+  T *object;
+  try {
+    object = ::new (p) T(std::forward<Args>(args)...);
+  } catch (...) {
+    if (heap)
+      ::operator delete(p, std::align_val_t(alignof(T)));
+    throw;
+  }
+  return ArenaPtr<T>(object, ArenaDelete<T>{1, heap});
+}
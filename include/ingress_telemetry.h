@@ -1,6 +1,6 @@
 #pragma once
-#include <algorithm>
-#include <array>
+#include "affinity.h"
+#include "latency_histogram.h"
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
@@ -8,19 +8,34 @@
 struct Ingress_Telemetry {
   std::atomic<uint64_t> total_msgs{0};
   std::atomic<uint64_t> total_latency_ns{0};
+  std::atomic<uint64_t> syscalls{0};
 
-  static constexpr uint64_t BIN_WIDTH_NS = 100;
-  static constexpr uint64_t MAX_TRACK_NS = 10'000'000;
-  static constexpr uint64_t NUM_BINS = MAX_TRACK_NS / BIN_WIDTH_NS + 1;
-  std::array<std::atomic<uint64_t>, NUM_BINS> hist{};
+  LatencyHistogram hist; // per message, or per batch for record_batch()
+  PlacementGauge placement; // of the network thread
 
   void record_latency(uint64_t ns) noexcept {
-    size_t idx = std::min<size_t>(ns / BIN_WIDTH_NS, NUM_BINS - 1);
-    hist[idx].fetch_add(1, std::memory_order_relaxed);
+    hist.record(ns);
     total_latency_ns.fetch_add(ns, std ::memory_order_relaxed);
     total_msgs.fetch_add(1, std::memory_order_relaxed);
   }
 
+  // One read() batch of `msgs` messages took `ns` end to end. Latency
+  // totals stay per-message so avg_latency_ns() is the amortized cost.
+  void record_batch(uint64_t ns, uint64_t msgs) noexcept {
+    hist.record(ns);
+    total_latency_ns.fetch_add(ns, std::memory_order_relaxed);
+    total_msgs.fetch_add(msgs, std::memory_order_relaxed);
+  }
+
+  void record_syscalls(uint64_t n) noexcept {
+    syscalls.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  double syscalls_per_million() const noexcept {
+    auto total = total_msgs.load();
+    return total ? 1e6 * double(syscalls.load()) / total : 0.0;
+  }
+
   double avg_latency_ns() const noexcept {
     auto total = total_msgs.load();
     return total ? double(total_latency_ns.load()) / total : 0.0;
@@ -31,5 +46,9 @@ struct Ingress_Telemetry {
     std::printf("messages=%lu avg_latency=%.2f ns throughput=%.2f msg/s\n",
                 total_msgs.load(), avg_latency_ns(),
                 total_msgs.load() / elapsed_s);
+    std::printf("syscalls=%lu (%.1f per 1M msgs)\n", syscalls.load(),
+                syscalls_per_million());
+    std::printf("placement: %s\n", describe(placement.load()).c_str());
+    hist.print("batch");
   }
 };
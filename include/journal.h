@@ -0,0 +1,146 @@
+#pragma once
+
+#include "order.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+struct JournalOptions {
+  size_t segment_bytes{64 << 20}; // per file, header included
+};
+
+namespace Client {
+
+// First 64 bytes of every segment file; wire-format orders follow
+struct alignas(64) JournalHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t generation; // engine run that wrote the segment
+  uint64_t shard;
+  uint64_t seq;      // order within the shard's run, from 1; 0 = never used
+  uint64_t capacity; // records the file has room for
+  uint64_t count;    // records written; bumped after every append
+  uint64_t synced;   // records msync'd; set only once they are on disk
+};
+
+constexpr uint64_t JOURNAL_MAGIC = 0x46424a524e4c3031; // "FBJRNL01"
+constexpr uint64_t JOURNAL_VERSION = 1;
+
+}; // namespace Client
+
+// Write-ahead journal of one shard's input. The matcher appends each batch
+// in wire format to a pre-allocated, memory-mapped segment before matching
+// it, so a process crash loses nothing it has acted on; the cost on the
+// matching thread is a memcpy into mapped memory and one counter store.
+//
+// Everything slow happens on the sync thread (run_journal_sync): msync of
+// the written range at a fixed cadence, creating and pre-faulting the next
+// segment, and unmapping full ones. Segments are handed over through an
+// atomic spare slot and an SPSC queue, so neither side ever blocks the
+// other. If the spare is not ready when a segment fills, the matcher
+// creates one itself and the roll is counted.
+class Journal {
+public:
+  struct Segment {
+    int fd;
+    std::string path;
+    uint8_t *base;
+    size_t bytes;
+    Client::JournalHeader *header;
+    Client::Order *records;
+    uint64_t synced{0}; // records known durable (sync thread only)
+  };
+
+private:
+  std::string dir_;
+  uint64_t generation_;
+  size_t shard_;
+  JournalOptions opts_;
+  uint64_t capacity_; // records per segment
+  std::atomic<uint64_t> created_{0};
+
+  // Matcher side
+  Segment *current_{nullptr};
+  uint64_t count_{0};
+  uint64_t activated_{0};
+  uint64_t appended_{0};
+  uint64_t inline_rolls_{0};
+
+  // Hand-over
+  std::atomic<Segment *> active_{nullptr}; // read by the sync thread
+  std::atomic<Segment *> spare_{nullptr};
+  SPSCQueue<Segment *, 64> sealed_;
+
+  // Sync side
+  uint64_t syncs_{0};
+  uint64_t sync_ns_{0};
+
+  Segment *create_segment();
+  void activate(Segment *next);
+  void sync(Segment &segment, uint64_t count);
+  void release(Segment *segment);
+
+public:
+  // Starts generation `generation` of shard `shard`'s journal in `dir`
+  Journal(const std::string &dir, uint64_t generation, size_t shard,
+          JournalOptions opts = {});
+  // Syncs and unmaps everything; call after both threads have stopped
+  ~Journal();
+
+  Journal(const Journal &) = delete;
+  Journal &operator=(const Journal &) = delete;
+
+  bool ok() const noexcept { return current_ != nullptr; }
+
+  // Matching thread: journals `orders` ahead of matching them
+  void append(std::span<const Client::Order> orders);
+
+  // Sync thread: one round of msync / spare preparation / cleanup. With
+  // `final`, syncs everything and prepares nothing.
+  void maintain(bool final = false);
+
+  uint64_t appended() const noexcept { return appended_; }
+  uint64_t segments() const noexcept { return activated_; }
+  uint64_t inline_rolls() const noexcept { return inline_rolls_; }
+  uint64_t syncs() const noexcept { return syncs_; }
+  void dump() const noexcept;
+};
+
+// Background thread: maintains every journal each `interval` until `done`,
+// then runs a final sync.
+void run_journal_sync(std::vector<Journal *> journals,
+                      std::chrono::milliseconds interval,
+                      const std::atomic<bool> &done);
+
+struct JournalReplayStats {
+  uint64_t records{0};
+  uint64_t segments{0};
+  uint64_t skipped{0}; // records already covered by `from`
+  double seconds{0};
+};
+
+// How far into the journal a restored state already is: every generation
+// before `generation`, plus the first `applied[shard]` records of each
+// shard in `generation` itself. The default covers nothing.
+struct JournalPosition {
+  uint64_t generation{0};
+  std::vector<uint64_t> applied; // indexed by shard
+};
+
+// Feeds every journaled order in `dir` past `from` to `fn`, one segment at
+// a time: oldest generation first, and within a generation each shard's
+// segments in order. Instruments never share a shard within a generation,
+// so every instrument's orders come back in the order they were matched.
+JournalReplayStats
+replay_journal(const std::string &dir,
+               const std::function<void(std::span<const Client::Order>)> &fn,
+               const JournalPosition &from = {});
+
+// Generation number for a new run writing to `dir`
+uint64_t next_journal_generation(const std::string &dir);
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Log-linear latency histogram (HdrHistogram layout): values below 2^SUB_BITS
+// ns get a bucket each, and every power of two above that is split into
+// 2^SUB_BITS equal buckets, so a bucket is never wider than 1/32 of its
+// lower bound. 896 buckets (7 KB) cover 1 ns to 4.3 s; slower samples land
+// in the last bucket and still count towards max().
+//
+// One thread records, with plain load/add/store rather than locked adds;
+// other threads may read (and merge) at any time and see each counter
+// whole, if slightly behind.
+class LatencyHistogram {
+public:
+  static constexpr unsigned SUB_BITS = 5;
+  static constexpr unsigned MAX_BITS = 32; // values >= 2^32 ns overflow
+  static constexpr uint64_t SUB_COUNT = uint64_t{1} << SUB_BITS;
+  static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+  static constexpr size_t bucket_of(uint64_t ns) noexcept {
+    if (ns < SUB_COUNT)
+      return ns;
+    unsigned msb = std::bit_width(ns) - 1;
+    if (msb >= MAX_BITS)
+      return BUCKETS - 1;
+    unsigned shift = msb - SUB_BITS + 1;
+    return shift * SUB_COUNT + ((ns >> (shift - 1)) & (SUB_COUNT - 1));
+  }
+
+  // Smallest value that lands in bucket `b`
+  static constexpr uint64_t lower_bound(size_t b) noexcept {
+    if (b < SUB_COUNT)
+      return b;
+    size_t shift = b / SUB_COUNT;
+    return (SUB_COUNT + b % SUB_COUNT) << (shift - 1);
+  }
+
+  // Largest value that lands in bucket `b` (the last is open-ended)
+  static constexpr uint64_t upper_bound(size_t b) noexcept {
+    return b + 1 < BUCKETS ? lower_bound(b + 1) - 1 : UINT64_MAX;
+  }
+
+  void record(uint64_t ns) noexcept {
+    bump(counts_[bucket_of(ns)], 1);
+    bump(total_, 1);
+    bump(sum_, ns);
+    if (ns > max_.load(std::memory_order_relaxed))
+      max_.store(ns, std::memory_order_relaxed);
+  }
+
+  // Adds `other`'s samples to this one. Not safe against a concurrent
+  // record() on this histogram; merge into a reader-side copy instead.
+  void merge(const LatencyHistogram &other) noexcept {
+    for (size_t b = 0; b < BUCKETS; b++)
+      if (uint64_t n = other.count(b))
+        bump(counts_[b], n);
+    bump(total_, other.total());
+    bump(sum_, other.sum());
+    if (other.max() > max())
+      max_.store(other.max(), std::memory_order_relaxed);
+  }
+
+  // Reader side: takes out `earlier`, an older merged copy of the same
+  // histogram, leaving the samples recorded in between. max() becomes the
+  // top of the highest bucket left.
+  void subtract(const LatencyHistogram &earlier) noexcept {
+    size_t top = 0;
+    for (size_t b = 0; b < BUCKETS; b++) {
+      uint64_t n = count(b) - earlier.count(b);
+      counts_[b].store(n, std::memory_order_relaxed);
+      if (n)
+        top = b;
+    }
+    total_.store(total() - earlier.total(), std::memory_order_relaxed);
+    sum_.store(sum() - earlier.sum(), std::memory_order_relaxed);
+    max_.store(total() ? std::min(upper_bound(top), max()) : 0,
+               std::memory_order_relaxed);
+  }
+
+  uint64_t count(size_t b) const noexcept {
+    return counts_[b].load(std::memory_order_relaxed);
+  }
+  uint64_t total() const noexcept {
+    return total_.load(std::memory_order_relaxed);
+  }
+  uint64_t sum() const noexcept {
+    return sum_.load(std::memory_order_relaxed);
+  }
+  uint64_t max() const noexcept {
+    return max_.load(std::memory_order_relaxed);
+  }
+  double mean() const noexcept {
+    uint64_t n = total();
+    return n ? double(sum()) / n : 0.0;
+  }
+
+  // Upper bound of the bucket holding the q-quantile (0 < q <= 1), capped
+  // at max(); 0 when empty
+  uint64_t percentile(double q) const noexcept {
+    uint64_t n = total();
+    if (n == 0)
+      return 0;
+    uint64_t rank =
+        std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * n)));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; b++) {
+      seen += count(b);
+      if (seen >= rank)
+        return std::min(upper_bound(b), max());
+    }
+    return max();
+  }
+
+  // One "p50=... p90=... p99=... p999=... max=..." line, values in ns
+  void print(const char *label) const noexcept {
+    std::printf("%-9s n=%-10lu p50=%lu ns  p90=%lu ns  p99=%lu ns  "
+                "p999=%lu ns  max=%lu ns\n",
+                label, total(), percentile(0.50), percentile(0.90),
+                percentile(0.99), percentile(0.999), max());
+  }
+
+  // Non-empty buckets as "label,lower_ns,upper_ns,count" rows
+  void write_csv(FILE *f, const char *label) const noexcept {
+    for (size_t b = 0; b < BUCKETS; b++)
+      if (uint64_t n = count(b))
+        std::fprintf(f, "%s,%lu,%lu,%lu\n", label, lower_bound(b),
+                     b + 1 < BUCKETS ? upper_bound(b) : max(), n);
+  }
+
+private:
+  static void bump(std::atomic<uint64_t> &c, uint64_t n) noexcept {
+    c.store(c.load(std::memory_order_relaxed) + n,
+            std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+  std::atomic<uint64_t> total_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
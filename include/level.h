@@ -0,0 +1,190 @@
+#pragma once
+#include "huge_arena.h"
+#include "order_pool.h"
+#include "types.h"
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A resting order's slot in its level's queue: the quantity matching reads
+// and writes, and the pooled order behind it. A cancelled order leaves a
+// hole (null order) until the queue is compacted.
+struct LevelEntry {
+  Matching::Order *order;
+  Volume remaining; // mirrors order->quantity_remaining
+};
+
+static_assert(sizeof(LevelEntry) == 16, "LevelEntry is not 16 bytes");
+
+// A block of one level's queue. A level chains its blocks oldest first;
+// an order's slot is its block's id and its offset within the block.
+struct alignas(64) FifoChunk {
+  static constexpr uint32_t ENTRIES = 14;
+  static constexpr uint32_t OFFSET_BITS = 4; // slot = id << 4 | offset
+
+  LevelEntry entries[ENTRIES];
+  FifoChunk *next;
+  FifoChunk *prev;
+  uint32_t id;
+
+  uint32_t slot(uint32_t offset) const noexcept {
+    return id << OFFSET_BITS | offset;
+  }
+};
+
+static_assert(sizeof(FifoChunk) == 256, "FifoChunk is not 256 bytes");
+
+// The queue blocks of every level in one LevelPool: arrays of chunks from
+// the arena (or the heap once it is full), recycled through an intrusive
+// free list, so a queue grows and shrinks without reaching malloc. Chunk
+// ids index the arrays, which never move.
+class FifoChunks {
+  HugeArena *arena_;
+  size_t slab_size_; // chunks per array, a power of two
+  unsigned slab_shift_;
+  std::vector<ArenaArray<FifoChunk>> slabs_;
+  FifoChunk *free_{nullptr};
+
+  void allocate_slab() {
+    assert(slabs_.size() * slab_size_ <
+               (size_t{1} << (32 - FifoChunk::OFFSET_BITS)) &&
+           "Chunk ids exhausted");
+    slabs_.push_back(make_arena_array<FifoChunk>(arena_, slab_size_));
+    auto &slab = slabs_.back();
+    uint32_t first = static_cast<uint32_t>((slabs_.size() - 1) * slab_size_);
+    // Chained in address order, so a new level's queue starts low
+    for (size_t i = slab_size_; i-- > 0;) {
+      slab[i].id = first + static_cast<uint32_t>(i);
+      slab[i].next = free_;
+      free_ = &slab[i];
+    }
+  }
+
+public:
+  FifoChunks(HugeArena *arena, size_t slab_size)
+      : arena_(arena), slab_size_(std::bit_ceil(slab_size)),
+        slab_shift_(std::countr_zero(slab_size_)) {
+    allocate_slab();
+  }
+
+  FifoChunk *acquire() {
+    if (free_ == nullptr) [[unlikely]]
+      allocate_slab();
+    FifoChunk *chunk = free_;
+    free_ = chunk->next;
+    return chunk;
+  }
+
+  // Returns the chain first..last to the free list
+  void release(FifoChunk *first, FifoChunk *last) noexcept {
+    last->next = free_;
+    free_ = first;
+  }
+
+  LevelEntry &entry(uint32_t slot) noexcept {
+    uint32_t id = slot >> FifoChunk::OFFSET_BITS;
+    return slabs_[id >> slab_shift_][id & (slab_size_ - 1)]
+        .entries[slot & ((1u << FifoChunk::OFFSET_BITS) - 1)];
+  }
+
+  size_t capacity() const noexcept { return slabs_.size() * slab_size_; }
+};
+
+// The orders at one price, in time priority. They are kept in chained
+// blocks of 16-byte entries rather than linked through the orders, so a
+// sweep walks the entries in order and can prefetch the orders it is about
+// to fill instead of chasing one pointer per order. Fills consume from the
+// front; cancels punch holes that the front and back skip, and push_back
+// squeezes them out once they make up half the queue. Blocks come from
+// the pool's FifoChunks and go back to it as the queue drains.
+struct alignas(64) Level {
+  Price price{};
+  Volume volume{};
+  FifoChunk *first{nullptr}; // null while empty
+  FifoChunk *last{nullptr};
+  FifoChunks *chunks{nullptr}; // set by the LevelPool
+  uint32_t size{0};
+  uint32_t head{0};  // first live entry in `first`
+  uint32_t tail{0};  // entries used in `last`
+  uint32_t span{0};  // entries from head to tail, holes included
+  uint32_t index{0}; // LevelPool index + 1, for compact orders
+  Side side{Side::Bid};
+  bool dirty{false}; // changed since the last depth flush
+
+  Level() = default;
+  Level(Price p) : price(p) {}
+  Level(Price p, Volume v) : price(p), volume(v) {}
+
+  // Re-initialises a recycled level for a new price. An empty level has
+  // already handed its chunks back.
+  void reset(Price p, Side s) {
+    assert(first == nullptr && "Level still holds queue chunks");
+    price = p;
+    side = s;
+    volume = 0;
+    size = 0;
+    dirty = false;
+  }
+
+  bool empty() const { return size == 0; }
+
+  // How the orders resting here refer to it
+  Matching::LevelRef ref() noexcept {
+#ifdef COMPACT_ORDERS
+    return index;
+#else
+    return this;
+#endif
+  }
+
+  void push_back(Matching::Order *o);
+  void pop(Matching::Order *o);
+  // The oldest live entry; the level must not be empty
+  LevelEntry &front_entry() const { return first->entries[head]; }
+  Matching::Order *front() const {
+    return empty() ? nullptr : front_entry().order;
+  }
+  Matching::Order *back() const {
+    return empty() ? nullptr : last->entries[tail - 1].order;
+  }
+
+  // The order `n` entries behind the front (a hole gives null), or null
+  // past the back; n < FifoChunk::ENTRIES
+  Matching::Order *ahead(uint32_t n) const {
+    if (empty())
+      return nullptr;
+    const FifoChunk *chunk = first;
+    uint32_t at = head + n;
+    if (at >= FifoChunk::ENTRIES) {
+      chunk = chunk->next;
+      at -= FifoChunk::ENTRIES;
+      if (chunk == nullptr)
+        return nullptr;
+    }
+    if (chunk == last && at >= tail)
+      return nullptr;
+    return chunk->entries[at].order;
+  }
+
+  // Visits the resting orders in time priority
+  template <typename F> void for_each(F &&fn) const {
+    for (const FifoChunk *c = first; c != nullptr; c = c->next) {
+      uint32_t end = c == last ? tail : FifoChunk::ENTRIES;
+      for (uint32_t i = c == first ? head : 0; i < end; i++)
+        if (c->entries[i].order)
+          fn(*c->entries[i].order);
+    }
+  }
+
+  std::string toString() const;
+
+private:
+  void grow();
+  void compact();
+};
+
+static_assert(alignof(Level) == 64, "Level alignment is not 64 bytes");
+static_assert(sizeof(Level) % 64 == 0, "Level size is not a multiple of 64");
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "huge_arena.h"
+#include "level.h"
+#include "telemetry.h"
+#include "types.h"
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Slab allocator for price levels. Emptied levels go back on a LIFO free
+// list and are re-initialised in place, so level churn around the mid never
+// reaches malloc/free. Slabs are arrays of 64-byte aligned Levels, and the
+// levels' queues draw their blocks from the pool's FifoChunks, which start
+// with one chunk per level of the first slab.
+class LevelPool {
+  Telemetry &telemetry_;
+  size_t slab_size_;
+  size_t slab_offset_;
+  size_t in_use_;
+  HugeArena *arena_;
+  std::vector<ArenaArray<Level>> slabs_;
+  std::vector<Level *> free_list_;
+  FifoChunks chunks_;
+
+private:
+  inline void allocate_slab() {
+    slabs_.push_back(make_arena_array<Level>(arena_, slab_size_));
+    for (size_t i = 0; i < slab_size_; i++) {
+      Level &level = slabs_.back()[i];
+      level.index =
+          static_cast<uint32_t>((slabs_.size() - 1) * slab_size_ + i + 1);
+      level.chunks = &chunks_;
+    }
+    slab_offset_ = 0;
+    // Sized for every level ever handed out, so deallocate never reallocates
+    free_list_.reserve(slabs_.size() * slab_size_);
+    publish_occupancy();
+  }
+
+  inline void publish_occupancy() noexcept {
+    telemetry_.record_level_pool(in_use_, slabs_.size() * slab_size_);
+  }
+
+public:
+  // Slabs come from `arena` while it has room, then from the heap
+  explicit LevelPool(Telemetry &telemetry, size_t slab_size = 1 << 12, // 4096
+                     HugeArena *arena = nullptr)
+      : telemetry_(telemetry), slab_size_(slab_size), slab_offset_(0),
+        in_use_(0), arena_(arena), chunks_(arena, slab_size) {
+    assert(slab_size > 0 && "Slab size should be non-zero");
+    allocate_slab();
+  }
+
+  // Levels point at chunks_
+  LevelPool(const LevelPool &) = delete;
+  LevelPool &operator=(const LevelPool &) = delete;
+
+  // Hands out an empty level for `price` (from freelist or bump)
+  Level *allocate(Price price, Side side) {
+    Level *level;
+    if (!free_list_.empty()) {
+      level = free_list_.back();
+      free_list_.pop_back();
+    } else {
+      if (slab_offset_ == slab_size_) {
+        allocate_slab();
+      }
+      level = &slabs_.back()[slab_offset_++];
+    }
+
+    level->reset(price, side);
+    in_use_++;
+    publish_occupancy();
+    return level;
+  }
+
+  void deallocate(Level *level) {
+    assert(level->empty() && "Level still holds orders");
+    free_list_.push_back(level);
+    in_use_--;
+    publish_occupancy();
+  }
+
+  // The level an order's `level` refers to
+  Level *at(Matching::LevelRef ref) noexcept {
+#ifdef COMPACT_ORDERS
+    return &slabs_[(ref - 1) / slab_size_][(ref - 1) % slab_size_];
+#else
+    return ref;
+#endif
+  }
+
+  size_t in_use() const noexcept { return in_use_; }
+  size_t capacity() const noexcept { return slabs_.size() * slab_size_; }
+  size_t chunk_capacity() const noexcept { return chunks_.capacity(); }
+};
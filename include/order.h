@@ -11,7 +11,7 @@ namespace Client {
 struct Order {
   Side side;
   OrderType order_type;
-  char padding[2];
+  InstrumentId instrument; // 0 in single-book replays
   uint32_t account_id;
   uint64_t price;
   uint64_t quantity;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "order.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// The synthetic order stream client/gen_orders.py writes, with every knob
+// exposed. Defaults reproduce the script's distributions.
+struct OrderGenParams {
+  uint64_t seed{42};
+  Price fair_price{100'000};  // prices are drawn around this fixed mid
+  double price_decay{0.003};  // Laplace rate of |price - mid|, per tick
+  double qty_median{8};       // lognormal quantity
+  double qty_sigma{1.0};      // lognormal shape; larger is heavier-tailed
+  double buy_ratio{0.52};     // of limit and market orders
+  double p_limit{0.6};        // event mix; cancels take the rest
+  double p_market{0.1};
+  Price far_threshold{50};    // ticks from mid beyond which a limit is "far"
+  double far_cancel{0.8};     // share of cancels aimed at far orders
+  uint32_t accounts{100'000}; // account ids are uniform in 1..accounts
+  InstrumentId instrument{0};
+  uint64_t chunk{1 << 20};    // orders per independently seeded chunk
+};
+
+// Writes chunk `index` of the stream, orders [index * chunk, + out.size()),
+// into `out` (at most `chunk` orders). A chunk draws from its own generator
+// seeded by (seed, index), takes order ids from index * chunk + 1 up, and
+// cancels only orders it placed itself, so chunks need no shared state and
+// the stream is the same whichever thread writes each chunk.
+void generate_chunk(const OrderGenParams &params, uint64_t index,
+                    std::span<Client::Order> out);
+
+// Fills `out` with the first out.size() orders of the stream, handing
+// chunks to `threads` workers. Returns the seconds taken.
+double generate_orders(const OrderGenParams &params,
+                       std::span<Client::Order> out, unsigned threads);
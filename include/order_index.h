@@ -0,0 +1,290 @@
+#pragma once
+
+#include "telemetry.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+namespace Matching {
+
+// Order ID -> pool index map using linear probing over a flat power-of-two
+// table. Deletes use backward-shift, so the live table never holds
+// tombstones.
+//
+// Growth is incremental: when the load factor passes 3/4 a table twice the
+// size is calloc'd (zero pages are faulted lazily, so there is no memset
+// stall) and every insert migrates a few buckets of the old table. Lookups
+// probe the new table first and fall back to the old one until it drains.
+// Erases in the draining table leave tombstones, which vanish with it.
+//
+// Probe counts and the load factor are kept in plain fields by the one
+// thread that owns the index and reach the telemetry only on publish(),
+// called at batch end, so the lookup path carries no atomic traffic. An
+// index given no telemetry (the compact pool's account table) publishes
+// nothing.
+class OrderIndex {
+  struct Slot {
+    uint64_t key;
+    uint64_t value; // pool index + 1; EMPTY and TOMBSTONE are reserved
+  };
+
+  static constexpr uint64_t EMPTY = 0;
+  static constexpr uint64_t TOMBSTONE = ~uint64_t{0};
+  static constexpr size_t MIGRATE_STEP = 16; // old buckets moved per insert
+
+  struct FreeDeleter {
+    void operator()(Slot *p) const noexcept { std::free(p); }
+  };
+  using Table = std::unique_ptr<Slot[], FreeDeleter>;
+
+  Telemetry *telemetry_; // may be null
+
+  Table table_;
+  size_t mask_;
+  size_t count_{0};
+
+  Table old_;
+  size_t old_mask_{0};
+  size_t old_count_{0};
+  size_t migrate_cursor_{0};
+
+  // Not yet published
+  mutable uint64_t lookups_{0};
+  mutable uint64_t probes_{0};
+  mutable uint64_t max_probe_{0};
+  uint64_t rehashes_{0};
+
+  static Table make_table(size_t capacity) {
+    auto *slots = static_cast<Slot *>(std::calloc(capacity, sizeof(Slot)));
+    assert(slots != nullptr && "OrderIndex table allocation failed");
+    return Table(slots);
+  }
+
+  static inline size_t hash(uint64_t key) noexcept {
+    // Fibonacci hashing spreads sequential order ids across the table
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 17);
+  }
+
+  static inline bool live(const Slot &s) noexcept {
+    return s.value != EMPTY && s.value != TOMBSTONE;
+  }
+
+  // Returns the slot holding `key` in the old table, or nullptr
+  Slot *probe_old(uint64_t key, uint64_t &probes) const noexcept {
+    if (!old_)
+      return nullptr;
+    for (size_t i = hash(key) & old_mask_;; i = (i + 1) & old_mask_) {
+      probes++;
+      Slot &s = old_[i];
+      if (s.value == EMPTY)
+        return nullptr;
+      if (s.value != TOMBSTONE && s.key == key)
+        return &s;
+    }
+  }
+
+  // Places a key known to be absent into the live table
+  void place(uint64_t key, uint64_t value) noexcept {
+    size_t i = hash(key) & mask_;
+    while (table_[i].value != EMPTY)
+      i = (i + 1) & mask_;
+    table_[i] = {key, value};
+    count_++;
+  }
+
+  void migrate_step() noexcept {
+    size_t end = std::min(migrate_cursor_ + MIGRATE_STEP, old_mask_ + 1);
+    for (; migrate_cursor_ < end; migrate_cursor_++) {
+      Slot &s = old_[migrate_cursor_];
+      if (live(s)) {
+        place(s.key, s.value);
+        // Tombstoned rather than emptied so later keys of the run stay
+        // reachable; a live copy here would outlive an erase in the new table
+        s.value = TOMBSTONE;
+        old_count_--;
+      }
+    }
+
+    if (migrate_cursor_ > old_mask_) {
+      assert(old_count_ == 0);
+      old_.reset();
+      old_mask_ = 0;
+    }
+  }
+
+  void grow() {
+    rehashes_++;
+    old_ = std::move(table_);
+    old_mask_ = mask_;
+    old_count_ = count_;
+    migrate_cursor_ = 0;
+
+    mask_ = (mask_ + 1) * 2 - 1;
+    table_ = make_table(mask_ + 1);
+    count_ = 0;
+  }
+
+  void erase_at(size_t i) noexcept {
+    // Backward-shift: pull later entries of the run into the hole unless
+    // that would move them before their home bucket.
+    size_t j = i;
+    while (true) {
+      j = (j + 1) & mask_;
+      if (table_[j].value == EMPTY)
+        break;
+      size_t home = hash(table_[j].key) & mask_;
+      if (((j - home) & mask_) >= ((j - i) & mask_)) {
+        table_[i] = table_[j];
+        i = j;
+      }
+    }
+    table_[i].value = EMPTY;
+    count_--;
+  }
+
+  void count_probes(uint64_t probes) const noexcept {
+    lookups_++;
+    probes_ += probes;
+    max_probe_ = std::max(max_probe_, probes);
+  }
+
+public:
+  static constexpr uint64_t npos = ~uint64_t{0};
+
+  explicit OrderIndex(Telemetry *telemetry, size_t capacity = 1 << 18)
+      : telemetry_(telemetry), table_(make_table(capacity)),
+        mask_(capacity - 1) {
+    assert((capacity & (capacity - 1)) == 0 &&
+           "Index capacity should be power of 2");
+    publish();
+  }
+
+  size_t size() const noexcept { return count_ + old_count_; }
+  size_t capacity() const noexcept { return mask_ + 1; }
+  bool rehashing() const noexcept { return old_ != nullptr; }
+
+  // Sizes the table for `n` more keys up front, finishing any migration in
+  // progress, so a bulk load never grows the table piecemeal
+  void reserve(size_t n) {
+    size_t want = mask_ + 1;
+    while ((size() + n) * 4 > want * 3)
+      want *= 2;
+    if (want == mask_ + 1)
+      return;
+
+    while (rehashing())
+      migrate_step();
+    Table old = std::move(table_);
+    size_t old_mask = mask_;
+    mask_ = want - 1;
+    table_ = make_table(want);
+    count_ = 0;
+    for (size_t i = 0; i <= old_mask; i++) {
+      if (live(old[i]))
+        place(old[i].key, old[i].value);
+    }
+  }
+
+  // Pulls the home bucket of `key` into cache ahead of an insert or lookup
+  void prefetch(uint64_t key) const noexcept {
+    __builtin_prefetch(&table_[hash(key) & mask_], 1);
+  }
+
+  // Returns the value stored for `key`, or npos
+  uint64_t find(uint64_t key) const noexcept {
+    uint64_t probes = 0;
+    uint64_t result = npos;
+    for (size_t i = hash(key) & mask_;; i = (i + 1) & mask_) {
+      probes++;
+      const Slot &s = table_[i];
+      if (s.value == EMPTY)
+        break;
+      if (s.key == key) {
+        result = s.value - 1;
+        break;
+      }
+    }
+    if (result == npos) {
+      if (Slot *s = probe_old(key, probes))
+        result = s->value - 1;
+    }
+    count_probes(probes);
+    return result;
+  }
+
+  // Inserts key -> value unless the key is already present. Returns the
+  // stored value and whether an insert happened, in a single probe sequence.
+  std::pair<uint64_t, bool> insert(uint64_t key, uint64_t value) {
+    assert(value + 1 != TOMBSTONE && value + 1 != EMPTY);
+    if (rehashing())
+      migrate_step();
+    else if ((count_ + 1) * 4 > (mask_ + 1) * 3)
+      grow();
+
+    uint64_t probes = 0;
+    size_t i = hash(key) & mask_;
+    for (;; i = (i + 1) & mask_) {
+      probes++;
+      Slot &s = table_[i];
+      if (s.value == EMPTY)
+        break;
+      if (s.key == key) {
+        count_probes(probes);
+        return {s.value - 1, false};
+      }
+    }
+
+    if (Slot *s = probe_old(key, probes)) {
+      count_probes(probes);
+      return {s->value - 1, false};
+    }
+
+    table_[i] = {key, value + 1};
+    count_++;
+    count_probes(probes);
+    return {value, true};
+  }
+
+  // Removes `key` and returns its value, or npos if absent
+  uint64_t erase(uint64_t key) noexcept {
+    uint64_t probes = 0;
+    uint64_t result = npos;
+    for (size_t i = hash(key) & mask_;; i = (i + 1) & mask_) {
+      probes++;
+      Slot &s = table_[i];
+      if (s.value == EMPTY)
+        break;
+      if (s.key == key) {
+        result = s.value - 1;
+        erase_at(i);
+        break;
+      }
+    }
+
+    if (result == npos) {
+      if (Slot *s = probe_old(key, probes)) {
+        result = s->value - 1;
+        s->value = TOMBSTONE;
+        old_count_--;
+      }
+    }
+
+    count_probes(probes);
+    return result;
+  }
+
+  // Adds the probe counts since the last call to the telemetry and stores
+  // the current load
+  void publish() noexcept {
+    if (!telemetry_)
+      return;
+    telemetry_->record_index_probes(lookups_, probes_, max_probe_, rehashes_);
+    telemetry_->record_index_load(size(), mask_ + 1);
+    lookups_ = probes_ = max_probe_ = rehashes_ = 0;
+  }
+};
+}; // namespace Matching
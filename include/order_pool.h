@@ -1,52 +1,74 @@
 #pragma once
 
+#include "huge_arena.h"
+#include "order_index.h"
 #include "telemetry.h"
 #include "types.h"
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
 struct Level; // forward declaration
 
 namespace Matching {
 
-enum class NodeType : uint8_t {
-  Sentinel,
-  Order,
+#ifdef COMPACT_ORDERS
+// Two orders per cache line: 32-bit quantities, the level as a LevelPool
+// index and the account interned per pool. Limit orders whose quantity or
+// price does not fit are rejected before they reach a pool (see fits()).
+using Quantity = uint32_t;
+using LevelRef = uint32_t;   // LevelPool index + 1; 0 while not resting
+using AccountRef = uint32_t; // index into the pool's account table
+constexpr size_t ORDER_BYTES = 32;
+#else
+using Quantity = uint64_t;
+using LevelRef = Level *; // null while not resting
+using AccountRef = AccountId;
+constexpr size_t ORDER_BYTES = 64;
+#endif
+
+// A pooled order. Its side and price are those of the level it rests on.
+struct alignas(ORDER_BYTES) Order {
+  OrderId order_id;            // 8 bytes Unique order ID
+  Quantity quantity;           // Order quantity
+  Quantity quantity_remaining; // Order quantity remaining
+  AccountRef account;          // See OrderPool::account()
+  uint32_t session{0};         // 4 bytes ExecReport routing tag of the owner
+  uint32_t slot{0};            // 4 bytes Its entry in the level's fifo
+  LevelRef level{};            // Level it rests on, if any
 };
 
-struct alignas(64) Order {
-  uint64_t quantity;           // 8 Bytes Order quantity
-  uint64_t quantity_remaining; // 8 Bytes Order quantity remaining
-  AccountId account_id;        // 8 Bytes Account identifier
-  uint64_t order_id;           // 8 bytes Unique order ID
+static_assert(alignof(Order) == ORDER_BYTES, "Order is not cache-aligned");
+static_assert(sizeof(Order) == ORDER_BYTES, "Order outgrew its layout");
 
-  Order *next = nullptr; // 8 bytes
-  Order *prev = nullptr; // 8 bytes
-
-  Level *level = nullptr; // 8 bytes
-
-  Side side;                      // 1 byte Buy or sell side
-  NodeType type{NodeType::Order}; // 1 byte
-  OrderType order_type;
-
-  char padding[5];
-};
-
-static_assert(alignof(Order) == 64, "Order struct alignment is not 64 bytes");
-static_assert(sizeof(Order) == 64, "Order struct size is not 64 bytes");
+// Whether a resting order of `quantity` at `price` fits the order layout
+constexpr bool fits([[maybe_unused]] Volume quantity,
+                    [[maybe_unused]] Price price) noexcept {
+#ifdef COMPACT_ORDERS
+  return quantity <= std::numeric_limits<Quantity>::max() &&
+         price <= std::numeric_limits<Tick>::max();
+#else
+  return true;
+#endif
+}
 
 class OrderPool {
   Telemetry &telemetry_;
   size_t slab_size_;
   size_t slab_offset_;
   uint64_t next_index_;
-  std::vector<std::unique_ptr<Order[]>> slabs_;
-  std::unordered_map<uint64_t, uint64_t> id_to_index_;
+  HugeArena *arena_;
+  std::vector<ArenaArray<Order>> slabs_;
+  OrderIndex id_to_index_;
   std::vector<uint64_t> free_list_;
+#ifdef COMPACT_ORDERS
+  std::vector<AccountId> accounts_; // by AccountRef
+  OrderIndex account_refs_{nullptr, 1 << 12}; // AccountId -> AccountRef
+  AccountRef last_account_{0}; // consecutive orders often share an account
+#endif
 
 private:
   inline Order &get(uint64_t idx) noexcept {
@@ -55,32 +77,51 @@ private:
     return slabs_[slab_idx][offset];
   }
 
+  inline AccountRef intern(AccountId account_id) {
+#ifdef COMPACT_ORDERS
+    if (!accounts_.empty() && accounts_[last_account_] == account_id)
+      return last_account_;
+    auto [ref, inserted] = account_refs_.insert(account_id, accounts_.size());
+    if (inserted) {
+      assert(accounts_.size() <= std::numeric_limits<AccountRef>::max());
+      accounts_.push_back(account_id);
+    }
+    return last_account_ = static_cast<AccountRef>(ref);
+#else
+    return account_id;
+#endif
+  }
+
   inline void allocate_slab() noexcept {
-    slabs_.push_back(std::make_unique<Order[]>(slab_size_));
+    slabs_.push_back(make_arena_array<Order>(arena_, slab_size_));
     slab_offset_ = 0;
   }
 
 public:
-  explicit OrderPool(Telemetry &telemetry, size_t slab_size = 1 << 17) // 131072
-      : telemetry_(telemetry), slab_size_(slab_size), next_index_(0) {
+  // Slabs come from `arena` while it has room, then from the heap
+  explicit OrderPool(Telemetry &telemetry, size_t slab_size = 1 << 17, // 131072
+                     HugeArena *arena = nullptr)
+      : telemetry_(telemetry), slab_size_(slab_size), next_index_(0),
+        arena_(arena), id_to_index_(&telemetry, slab_size * 2) {
     assert((slab_size & (slab_size - 1)) == 0 &&
            "Slab size should be power of 2");
     allocate_slab();
   }
 
-  // Allocate a new order (from freelist or bump)
-  Order *allocate(uint64_t order_id, uint64_t quantity, bool is_buy,
-                  uint64_t account_id) {
-    uint64_t idx;
-    auto existingOrder = this->find(order_id);
-    if (existingOrder != nullptr) {
-      return existingOrder;
+  // Allocate a new order (from freelist or bump). The quantity must fit
+  // (see fits()).
+  Order *allocate(uint64_t order_id, uint64_t quantity, uint64_t account_id) {
+    // Claim the next slot in the index first; a duplicate id returns the
+    // existing order without touching the free list or slab.
+    uint64_t idx = free_list_.empty() ? next_index_ : free_list_.back();
+    auto [existing, inserted] = id_to_index_.insert(order_id, idx);
+    if (!inserted) {
+      return &get(existing);
     }
 
     if (!free_list_.empty()) {
       // reuse slot from free list
       telemetry_.record_alloc(false);
-      idx = free_list_.back();
       free_list_.pop_back();
     } else {
       telemetry_.record_alloc(true);
@@ -88,37 +129,55 @@ public:
       if (slab_offset_ == slab_size_) {
         allocate_slab();
       }
-      idx = next_index_++;
+      next_index_++;
       slab_offset_++;
     }
 
     Order &o = get(idx);
-    o.quantity = quantity;
-    o.quantity_remaining = quantity;
-    o.side = is_buy ? Side::Bid : Side::Ask;
-    o.account_id = account_id;
+    o.quantity = static_cast<Quantity>(quantity);
+    o.quantity_remaining = static_cast<Quantity>(quantity);
+    o.account = intern(account_id);
     o.order_id = order_id;
-
-    id_to_index_[order_id] = idx;
     return &o;
   }
 
+  AccountId account(const Order &o) const noexcept {
+#ifdef COMPACT_ORDERS
+    return accounts_[o.account];
+#else
+    return o.account;
+#endif
+  }
+
+  // Makes room in the index for `orders` more orders ahead of a bulk load
+  void reserve(size_t orders) {
+    id_to_index_.reserve(orders);
+    slabs_.reserve(slabs_.size() + orders / slab_size_ + 1);
+  }
+
+  void prefetch(uint64_t order_id) const noexcept {
+    id_to_index_.prefetch(order_id);
+  }
+
+  // Hands the id index's probe counts to the telemetry (see OrderIndex)
+  void publish_stats() noexcept { id_to_index_.publish(); }
+
+  // Orders allocated and not yet deallocated
+  size_t size() const noexcept { return id_to_index_.size(); }
+
   // Lookup by external ID
   Order *find(uint64_t order_id) {
-    auto it = id_to_index_.find(order_id);
-    if (it == id_to_index_.end())
+    uint64_t idx = id_to_index_.find(order_id);
+    if (idx == OrderIndex::npos)
       return nullptr;
-    return &get(it->second);
+    return &get(idx);
   }
 
   void deallocate(uint64_t order_id) {
-    auto it = id_to_index_.find(order_id);
-    if (it == id_to_index_.end())
+    uint64_t idx = id_to_index_.erase(order_id);
+    if (idx == OrderIndex::npos)
       return;
 
-    uint64_t idx = it->second;
-    id_to_index_.erase(it);
-
     free_list_.push_back(idx);
   }
 };
@@ -1,56 +1,76 @@
 #pragma once
+#include "depth_feed.h"
+#include "exec_report.h"
+#include "level.h"
+#include "level_pool.h"
 #include "order_pool.h"
+#include "price_ladder.h"
 #include "telemetry.h"
 #include "types.h"
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <sys/types.h>
 #include <utility>
+#include <vector>
 
 struct MatchResult {
   uint64_t total_traded;
   Volume remaining;
 };
 
-struct Level {
-  Price price{};
-  Volume volume{};
-  uint32_t size{0};
-  Matching::Order sentinel;
+using BestLevel = std::optional<std::pair<Price, Volume>>;
 
-  Level() {
-    sentinel.prev = &sentinel;
-    sentinel.next = &sentinel;
-    sentinel.type = Matching::NodeType::Sentinel;
-  }
+// Width of the O(1) tick window each side keeps around its best price
+static constexpr size_t LADDER_WINDOW_TICKS = 1 << 14;
+using Ladder = PriceLadder<Level, LADDER_WINDOW_TICKS>;
 
-  Level(Price p) : price(p) {
-    sentinel.prev = &sentinel;
-    sentinel.next = &sentinel;
-    sentinel.type = Matching::NodeType::Sentinel;
-  }
+struct Orderbook {
+private:
+  std::unique_ptr<Telemetry> own_telemetry_; // null when shared
 
-  Level(Price p, Volume v) : price(p), volume(v) {
-    sentinel.prev = &sentinel;
-    sentinel.next = &sentinel;
-    sentinel.type = Matching::NodeType::Sentinel;
+public:
+  Telemetry &telemetry_;
+  Matching::OrderPool orderpool_;
+  LevelPool levelpool_;
+
+  Orderbook()
+      : own_telemetry_(std::make_unique<Telemetry>()),
+        telemetry_(*own_telemetry_), orderpool_(telemetry_),
+        levelpool_(telemetry_), mBidLevels(Side::Bid), mAskLevels(Side::Ask) {}
+
+  // One of many books on a matching thread: counters go to the thread's
+  // shared telemetry and the pools start small, growing slab by slab, in
+  // `arena` when there is one. Each side's tick window is `ladder_ticks`
+  // wide (see PriceLadder).
+  Orderbook(Telemetry &shared, size_t order_slab, size_t level_slab,
+            HugeArena *arena = nullptr,
+            size_t ladder_ticks = LADDER_WINDOW_TICKS)
+      : telemetry_(shared), orderpool_(telemetry_, order_slab, arena),
+        levelpool_(telemetry_, level_slab, arena),
+        mBidLevels(Side::Bid, ladder_ticks, arena),
+        mAskLevels(Side::Ask, ladder_ticks, arena) {}
+
+  // Emits execution reports for every ack, fill, cancel and reject; null
+  // (the default) keeps the book silent.
+  void set_exec_sink(ExecSink *sink) noexcept { exec_ = sink; }
+
+  // Marks every level this book changes in `tracker` under `instrument`;
+  // null (the default) disables depth tracking.
+  void set_depth_tracker(DepthTracker *tracker,
+                         InstrumentId instrument) noexcept {
+    depth_ = tracker;
+    instrument_ = instrument;
   }
 
-  bool empty() const { return sentinel.next == &sentinel; }
-
-  void push_back(Matching::Order *o);
-  void pop(Matching::Order *o);
-  Matching::Order *front() const { return empty() ? nullptr : sentinel.next; };
-  std::string toString() const;
-};
-
-using BestLevel = std::optional<std::pair<Price, Volume>>;
-
-struct Orderbook {
-  Telemetry telemetry_;
-  Matching::OrderPool orderpool_;
+  // The level at `price`, or nullptr if that side has none
+  Level *level_at(Side side, Price price) const {
+    return (side == Side::Bid ? mBidLevels : mAskLevels).find(price);
+  }
 
-  Orderbook() : telemetry_(), orderpool_(telemetry_) {}
+  const Ladder &ladder(Side side) const noexcept {
+    return side == Side::Bid ? mBidLevels : mAskLevels;
+  }
 
   // Adds to orderbook
   void addOrder(uint64_t orderId, Price price, uint64_t quantity, bool is_buy,
@@ -58,8 +78,10 @@ struct Orderbook {
 
   void removeOrder(uint64_t orderId);
 
-  uint64_t matchLimitOrder(Matching::Order *incoming, Price price);
-  uint64_t matchMarketOrder(bool is_buy, uint64_t quantity);
+  uint64_t matchLimitOrder(Matching::Order *incoming, Side side, Price price);
+  // `order_id` is the client's own id, echoed in the order's reports
+  uint64_t matchMarketOrder(bool is_buy, uint64_t quantity,
+                            OrderId order_id = 0);
 
   [[nodiscard]] std::pair<BestLevel, BestLevel> getBestPrices() const;
 
@@ -69,21 +91,39 @@ struct Orderbook {
 
   [[nodiscard]] inline Volume totalBidVolume() const noexcept {
     Volume v = 0;
-    for (auto &lvl : mBidLevels)
-      v += lvl->volume;
+    mBidLevels.for_each([&](const Level &lvl) { v += lvl.volume; });
     return v;
   }
 
   [[nodiscard]] inline Volume totalAskVolume() const noexcept {
     Volume v = 0;
-    for (auto &lvl : mAskLevels)
-      v += lvl->volume;
+    mAskLevels.for_each([&](const Level &lvl) { v += lvl.volume; });
     return v;
   }
 
-  const auto &bids() const noexcept { return mBidLevels; }
+  // Visits up to `n` levels of one side, best first; returns how many
+  template <typename F> size_t top(Side side, size_t n, F &&fn) const {
+    return (side == Side::Bid ? mBidLevels : mAskLevels)
+        .for_each_best(n, std::forward<F>(fn));
+  }
+
+  // Bulk restore from a checkpoint (see checkpoint.h). Nothing is matched
+  // or reported: levels are rebuilt best first and each level's orders are
+  // appended in time priority. reserve() sizes the pools up front.
+  void reserve(size_t orders) { orderpool_.reserve(orders); }
+  void prefetch_order(OrderId order_id) const noexcept {
+    orderpool_.prefetch(order_id);
+  }
+  Level *restore_level(Side side, Price price);
+  // False if `order_id` is already resting, or the order does not fit the
+  // order layout
+  bool restore_order(Level &level, OrderId order_id, Volume quantity,
+                     Volume remaining, AccountId account_id);
 
-  const auto &asks() const noexcept { return mAskLevels; }
+  // Snapshots of each side ordered worst to best (best at back). These walk
+  // every level, so keep them off the hot path.
+  std::vector<const Level *> bids() const;
+  std::vector<const Level *> asks() const;
 
   std::string toString() const;
 
@@ -91,34 +131,51 @@ struct Orderbook {
     return mBidLevels.size() + mAskLevels.size();
   }
 
-  size_t resting_orders() const noexcept {
-    size_t total = 0;
-    for (auto &lvl : mAskLevels)
-      total += lvl->size;
-    for (auto &lvl : mAskLevels)
-      total += lvl->size;
-    return total;
+  AccountId account_of(const Matching::Order &o) const noexcept {
+    return orderpool_.account(o);
   }
 
+  // Publishes the stats kept off the hot path; the owner calls this at
+  // batch end
+  void publish_stats() noexcept { orderpool_.publish_stats(); }
+
+  // Every pooled order rests on a level once addOrder() returns
+  size_t resting_orders() const noexcept { return orderpool_.size(); }
+
   void dump_shape(const std::string &path, uint64_t bin_size) const;
 
 private:
-  //   bids sorted ASC (best at index -1), asks sorted DESC (best at index
-  //   -1).
-  std::vector<std::unique_ptr<Level>> mBidLevels;
-  std::vector<std::unique_ptr<Level>> mAskLevels;
+  Ladder mBidLevels;
+  Ladder mAskLevels;
+  ExecSink *exec_{nullptr};
+  DepthTracker *depth_{nullptr};
+  InstrumentId instrument_{0};
+
+  inline void report(ExecType type, uint32_t session, OrderId order_id,
+                     Side side, Price price, Volume quantity, Volume leaves) {
+    if (exec_)
+      exec_->emit(type, session, order_id, side, price, quantity, leaves);
+  }
+
+  inline void touch(Side side, Level &level) {
+    if (depth_)
+      depth_->touch(this, instrument_, side, level);
+  }
+
+  inline uint32_t current_session() const noexcept {
+    return exec_ ? exec_->session() : 0;
+  }
 
   // Adds to the specific orderbook side
   void addToLevel(Level &level, Matching::Order *order);
 
+  // Fills `quantity` against `level` in time priority, reporting each
+  // resting fill and passing (price, traded, left) to `fill_incoming`;
+  // returns what is left
+  template <typename F>
+  uint64_t fill(Level &level, uint64_t quantity, F &&fill_incoming);
+
   inline bool crossed(Price incoming, Price resting, Side s) noexcept {
     return (s == Side::Bid) ? (incoming >= resting) : (incoming <= resting);
   }
-
-  using BidIt = std::vector<std::unique_ptr<Level>>::iterator;
-  using AskIt = std::vector<std::unique_ptr<Level>>::iterator;
-
-  // finds the nearest or equal price level
-  BidIt findBidPos(Price price);
-  AskIt findAskPos(Price price);
 };
@@ -0,0 +1,307 @@
+#pragma once
+#include "hierarchical_bitset.h"
+#include "huge_arena.h"
+#include "types.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+
+// One side of the book. Levels within a tick window anchored near the best
+// price live in a flat circular array indexed by (price & (ticks - 1)) and
+// are tracked by a hierarchical occupancy bitset, so insert, erase and best
+// lookups are O(1). Prices outside the window (deep, far-from-mid orders)
+// fall back to a cold map whose nodes come from a pool, so levels moving in
+// and out of it recycle nodes rather than reach malloc.
+//
+// The ladder does not own its levels; callers allocate them (see LevelPool)
+// and reclaim them after erase.
+//
+// The window slides rather than re-centres: moving the base only touches
+// the slots whose prices leave the window (spilled to the cold map) and the
+// cold levels whose prices enter it. A new best just past the better edge
+// slides the window onto it at once. One so far past it that the slide
+// would spill levels is parked in the cold map instead, where best() still
+// sees it; the window follows only once operations on parked levels
+// outnumber the levels a slide would spill, so a far order placed and
+// cancelled over and over costs a map insert and erase, not a slide each
+// time. An erase that empties the window slides it onto the best cold
+// level.
+//
+// WindowTicks bounds the window; a ladder can be built narrower, and its
+// window array is only allocated on the first insert into it, so a book
+// that is created but barely traded stays small.
+template <typename T, size_t WindowTicks> class PriceLadder {
+  using Bitset = HierarchicalBitset<WindowTicks>;
+  static constexpr size_t npos = Bitset::npos;
+
+  bool is_bid_;
+  size_t ticks_;    // window width, a power of two at most WindowTicks
+  size_t mask_;
+  size_t headroom_; // room left on the "better" side of the best price so
+                    // it can drift towards the spread without a slide
+  HugeArena *arena_;
+  Price base_{0};       // lowest price in the window
+  size_t size_{0};
+  size_t in_window_{0}; // levels in the window; 0 only when the side is
+  uint64_t recenters_{0};
+  uint64_t parked_ops_{0}; // on parked levels since the window last moved
+  Bitset occupied_;        // by slot
+  ArenaArray<T *> window_; // by slot; null until the first level lands
+  std::pmr::unsynchronized_pool_resource cold_nodes_;
+  std::pmr::map<Price, T *> cold_{&cold_nodes_};
+
+  inline bool in_window(Price price) const noexcept {
+    return price - base_ < ticks_; // wraps when price < base_
+  }
+
+  inline bool better(Price a, Price b) const noexcept {
+    return is_bid_ ? a > b : a < b;
+  }
+
+  // Past the window's better edge: only parked levels sit there
+  inline bool beyond(Price price) const noexcept {
+    return is_bid_ ? price >= base_ + ticks_ : price < base_;
+  }
+
+  // Slots in price order run from start() to the end of the array, then
+  // wrap around to 0
+  inline size_t start() const noexcept { return base_ & mask_; }
+
+  inline Price price_at(size_t slot) const noexcept {
+    return base_ + ((slot - start()) & mask_);
+  }
+
+  size_t lowest_slot() const noexcept {
+    size_t i = occupied_.find_next(start());
+    return i != npos ? i : occupied_.find_first();
+  }
+
+  size_t highest_slot() const noexcept {
+    size_t s = start();
+    size_t i = s ? occupied_.find_prev(s - 1) : npos;
+    return i != npos ? i : occupied_.find_last();
+  }
+
+  // The occupied slot priced next above / below `slot`'s, or npos
+  size_t next_slot(size_t slot) const noexcept {
+    size_t s = start();
+    size_t i = occupied_.find_next(slot + 1);
+    if (slot < s)
+      return i < s ? i : npos;
+    if (i != npos)
+      return i;
+    i = occupied_.find_first();
+    return i < s ? i : npos;
+  }
+
+  size_t prev_slot(size_t slot) const noexcept {
+    size_t s = start();
+    size_t i = slot ? occupied_.find_prev(slot - 1) : npos;
+    if (slot >= s)
+      return i != npos && i >= s ? i : npos;
+    if (i != npos)
+      return i;
+    i = occupied_.find_last();
+    return i != npos && i >= s ? i : npos;
+  }
+
+  inline size_t best_slot() const noexcept {
+    return is_bid_ ? highest_slot() : lowest_slot();
+  }
+
+  // The best cold level if it is parked past the window, or null
+  T *parked() const noexcept {
+    if (cold_.empty())
+      return nullptr;
+    auto [price, level] = is_bid_ ? *cold_.rbegin() : *cold_.begin();
+    return beyond(price) ? level : nullptr;
+  }
+
+  void place(Price price, T *level) {
+    if (!window_) [[unlikely]]
+      window_ = make_arena_array<T *>(arena_, ticks_);
+    size_t slot = price & mask_;
+    window_[slot] = level;
+    occupied_.set(slot);
+    in_window_++;
+  }
+
+  // Calls fn(slot) for the occupied slots priced in [from, to), a range
+  // within the window, until it returns false
+  template <typename F> void for_slots(Price from, Price to, F &&fn) {
+    size_t first = from & mask_;
+    size_t end = first + (to - from);
+    for (size_t i = occupied_.find_next(first); i < std::min(end, ticks_);
+         i = occupied_.find_next(i + 1))
+      if (!fn(i))
+        return;
+    for (size_t i = occupied_.find_first(); end > ticks_ && i < end - ticks_;
+         i = occupied_.find_next(i + 1))
+      if (!fn(i))
+        return;
+  }
+
+  // Calls for_slots over the prices a window based at `base` would drop
+  template <typename F> void for_leaving(Price base, F &&fn) {
+    Price end = base_ + ticks_;
+    if (base >= end || base + ticks_ <= base_)
+      for_slots(base_, end, fn);
+    else if (base > base_)
+      for_slots(base_, base, fn);
+    else
+      for_slots(base + ticks_, end, fn);
+  }
+
+  // Base that puts `anchor` `headroom_` ticks from the better edge
+  Price anchored(Price anchor) const noexcept {
+    Price offset = is_bid_ ? ticks_ - headroom_ : headroom_;
+    return anchor > offset ? anchor - offset : 0;
+  }
+
+  void slide(Price base) {
+    for_leaving(base, [&](size_t slot) {
+      cold_.emplace(price_at(slot), window_[slot]);
+      window_[slot] = nullptr;
+      occupied_.reset(slot);
+      in_window_--;
+      return true;
+    });
+    base_ = base;
+
+    // Cold levels never hold window prices, so these all just entered
+    auto it = cold_.lower_bound(base_);
+    while (it != cold_.end() && in_window(it->first)) {
+      place(it->first, it->second);
+      it = cold_.erase(it);
+    }
+    parked_ops_ = 0;
+    recenters_++;
+  }
+
+  // Slides onto a new best past the better edge if that spills fewer
+  // levels than there have been parked operations. Counting is capped by
+  // that number and only tried when it reaches a power of two, so checks
+  // and slides together stay amortised O(1) per operation.
+  bool try_slide(Price price) {
+    parked_ops_++;
+    if (parked_ops_ & (parked_ops_ - 1))
+      return false;
+    Price base = anchored(price);
+    uint64_t leaving = 0;
+    for_leaving(base, [&](size_t) { return ++leaving < parked_ops_; });
+    if (leaving >= parked_ops_)
+      return false;
+    slide(base);
+    return true;
+  }
+
+public:
+  // A window of `ticks` (a power of two, 64..WindowTicks); allocated in
+  // `arena` if given
+  explicit PriceLadder(Side side, size_t ticks = WindowTicks,
+                       HugeArena *arena = nullptr)
+      : is_bid_(side == Side::Bid), ticks_(ticks), mask_(ticks - 1),
+        headroom_(ticks / 4), arena_(arena) {
+    assert(ticks >= 64 && ticks <= WindowTicks && (ticks & mask_) == 0 &&
+           "Bad ladder window");
+  }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_t size() const noexcept { return size_; }
+  uint64_t recenters() const noexcept { return recenters_; }
+  size_t window_ticks() const noexcept { return ticks_; }
+  bool window_allocated() const noexcept { return window_ != nullptr; }
+
+  T *find(Price price) const {
+    if (in_window(price))
+      return window_ ? window_[price & mask_] : nullptr;
+    auto it = cold_.find(price);
+    return it == cold_.end() ? nullptr : it->second;
+  }
+
+  T *best() const noexcept {
+    if (in_window_ == 0)
+      return nullptr;
+    if (T *level = parked()) [[unlikely]]
+      return level;
+    return window_[best_slot()];
+  }
+
+  T *insert(Price price, T *level) {
+    assert(find(price) == nullptr && "Level already exists");
+    size_++;
+
+    if (!in_window(price)) {
+      if (in_window_ == 0)
+        slide(anchored(price)); // the side was empty
+      else if (better(price, price_at(best_slot())))
+        try_slide(price);
+    }
+
+    if (in_window(price)) {
+      place(price, level);
+    } else {
+      cold_.emplace(price, level);
+    }
+    return level;
+  }
+
+  void erase(Price price) {
+    size_--;
+    if (!in_window(price)) {
+      if (beyond(price))
+        parked_ops_++;
+      cold_.erase(price);
+      return;
+    }
+
+    size_t slot = price & mask_;
+    occupied_.reset(slot);
+    window_[slot] = nullptr;
+    in_window_--;
+
+    if (in_window_ == 0 && !cold_.empty()) {
+      slide(anchored(is_bid_ ? cold_.rbegin()->first : cold_.begin()->first));
+    }
+  }
+
+  // Visits up to `n` levels from the best price outwards; returns how many:
+  // parked levels first, then the window, then the cold levels behind it.
+  template <typename F> size_t for_each_best(size_t n, F &&fn) const {
+    size_t seen = 0;
+    if (is_bid_) {
+      auto it = cold_.rbegin();
+      for (; it != cold_.rend() && beyond(it->first) && seen < n;
+           ++it, seen++)
+        fn(*it->second);
+      for (size_t i = highest_slot(); i != npos && seen < n;
+           i = prev_slot(i), seen++)
+        fn(*window_[i]);
+      for (; it != cold_.rend() && seen < n; ++it, seen++)
+        fn(*it->second);
+    } else {
+      auto it = cold_.begin();
+      for (; it != cold_.end() && beyond(it->first) && seen < n; ++it, seen++)
+        fn(*it->second);
+      for (size_t i = lowest_slot(); i != npos && seen < n;
+           i = next_slot(i), seen++)
+        fn(*window_[i]);
+      for (; it != cold_.end() && seen < n; ++it, seen++)
+        fn(*it->second);
+    }
+    return seen;
+  }
+
+  // Visits every level in ascending price order
+  template <typename F> void for_each(F &&fn) const {
+    auto it = cold_.begin();
+    for (; it != cold_.end() && it->first < base_; ++it)
+      fn(*it->second);
+    for (size_t i = lowest_slot(); i != npos; i = next_slot(i))
+      fn(*window_[i]);
+    for (; it != cold_.end(); ++it)
+      fn(*it->second);
+  }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "order.h"
+#include "shard.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// A file of wire-format orders (e.g. client/orders.bin), mapped read-only
+// and pre-faulted so replay never waits on the disk. A trailing partial
+// record is ignored.
+class OrderFile {
+  void *base_{nullptr};
+  size_t bytes_{0};
+
+public:
+  explicit OrderFile(const std::string &path);
+  ~OrderFile();
+
+  OrderFile(const OrderFile &) = delete;
+  OrderFile &operator=(const OrderFile &) = delete;
+
+  bool ok() const noexcept { return base_ != nullptr; }
+
+  std::span<const Client::Order> orders() const noexcept {
+    return {static_cast<const Client::Order *>(base_),
+            bytes_ / sizeof(Client::Order)};
+  }
+};
+
+struct ReplayFeedStats {
+  uint64_t orders{0};
+  uint64_t stalls{0}; // rounds the ring had no room
+};
+
+// Producer side of a queued replay, in place of the network thread: copies
+// `orders` into `queue` as fast as the matcher frees slots, tagged with no
+// session, and with a router moves them on to the shard rings. Returns once
+// everything is in `queue` or `stop` is set.
+ReplayFeedStats feed_orders(std::span<const Client::Order> orders,
+                            OrderQueue &queue, OrderTags &tags,
+                            ShardRouter *router,
+                            const std::atomic<bool> &stop);
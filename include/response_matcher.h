@@ -0,0 +1,94 @@
+#pragma once
+
+#include "exec_report.h"
+#include "order.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Client side: pairs one session's execution reports with the orders it
+// sent, so a load generator can time each order's round trip.
+//
+// Limit orders' reports carry engine order ids and market orders' reports
+// the client's own id, so pairing relies on order: the engine handles a
+// session's orders in the order they were sent, and the first report each
+// one produces is its response:
+//   limit  -> Ack (before any of its fills)
+//   market -> its first own fill, or Rejected if nothing traded
+//   cancel -> Cancelled, or Rejected for an unknown id
+// Later reports (a limit's fills, the rest of a market order's fills and its
+// Cancelled remainder, fills of resting orders) are not responses. A market
+// order's reports are told apart by its id, which must not also be the
+// engine id of one of the session's resting orders (true when client ids
+// count every order sent and the engine's count only the limits).
+//
+// This holds while the session is the only one trading its instruments and
+// all its orders are on one instrument or one shard; otherwise reports from
+// different books interleave and cancels may answer to another session.
+class ResponseMatcher {
+  std::span<const Client::Order> sent_;
+  size_t next_{0};
+  bool market_open_{false}; // more fills of an answered market order due
+  OrderId open_market_id_{0};
+  uint64_t mismatched_{0};
+
+public:
+  static constexpr size_t NOT_A_RESPONSE = ~size_t{0};
+
+  explicit ResponseMatcher(std::span<const Client::Order> sent)
+      : sent_(sent) {}
+
+  // Index in `sent` of the order `report` answers, or NOT_A_RESPONSE
+  size_t on_report(const Client::ExecReport &report) noexcept {
+    // A follow-up of the market order answered last
+    bool open = market_open_ && report.order_id == open_market_id_;
+    switch (report.type) {
+    case ExecType::Ack:
+      return answer(OrderType::Limit);
+    case ExecType::Rejected:
+      return answer(awaits_market(report) ? OrderType::Market
+                                          : OrderType::Cancel);
+    case ExecType::Cancelled:
+      if (open) { // unfilled market remainder
+        market_open_ = false;
+        return NOT_A_RESPONSE;
+      }
+      return answer(OrderType::Cancel);
+    case ExecType::Fill:
+      if (open) {
+        market_open_ = report.leaves > 0;
+        return NOT_A_RESPONSE;
+      }
+      if (!awaits_market(report))
+        return NOT_A_RESPONSE; // a resting order's fill
+      market_open_ = report.leaves > 0;
+      open_market_id_ = report.order_id;
+      return answer(OrderType::Market);
+    }
+    return NOT_A_RESPONSE;
+  }
+
+  // Orders answered so far; the next report answers sent[answered()]
+  size_t answered() const noexcept { return next_; }
+  // Responses of the wrong kind for the order they were paired with; any at
+  // all means the assumptions above do not hold for this session
+  uint64_t mismatched() const noexcept { return mismatched_; }
+
+private:
+  // Whether `report` is about the market order next in line
+  bool awaits_market(const Client::ExecReport &report) const noexcept {
+    return next_ < sent_.size() &&
+           sent_[next_].order_type == OrderType::Market &&
+           sent_[next_].order_id == report.order_id;
+  }
+
+  size_t answer(OrderType kind) noexcept {
+    if (next_ == sent_.size()) {
+      mismatched_++;
+      return NOT_A_RESPONSE;
+    }
+    if (sent_[next_].order_type != kind)
+      mismatched_++;
+    return next_++;
+  }
+};
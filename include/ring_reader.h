@@ -0,0 +1,99 @@
+#pragma once
+
+#include "session_tags.h"
+#include "spsc_queue.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sys/types.h>
+#include <type_traits>
+#include <unistd.h>
+
+// Reads a stream of fixed-size messages from a socket directly into the free
+// slots of an SPSC ring, so the bytes the kernel copies out are the bytes the
+// matcher reads. Only a message split across two reads is copied again: its
+// head (< sizeof(T) bytes) is stashed here and replayed into the next claimed
+// slot before the following read.
+template <typename T, size_t Size> class RingReader {
+  static_assert(std::is_trivially_copyable_v<T> && alignof(T) == 1,
+                "Messages must be packed wire structs");
+
+  SPSCQueue<T, Size> &queue_;
+  size_t max_batch_;
+  SessionTags<Size> *tags_;
+  uint32_t session_;
+  std::array<uint8_t, sizeof(T)> stash_{};
+  size_t stashed_{0};
+
+public:
+  static constexpr ssize_t RING_FULL = -2;
+
+  // With `tags`, every published message is attributed to `session`
+  explicit RingReader(SPSCQueue<T, Size> &queue, size_t max_batch = 2048,
+                      SessionTags<Size> *tags = nullptr, uint32_t session = 0)
+      : queue_(queue), max_batch_(max_batch), tags_(tags), session_(session) {}
+
+  // Returns read()'s result, or RING_FULL if no slot is free. On success
+  // `published` holds the number of complete messages made visible.
+  ssize_t read_into(int fd, size_t &published) {
+    published = 0;
+    auto region = queue_.claim(max_batch_);
+    if (region.empty())
+      return RING_FULL;
+
+    uint8_t *dst = reinterpret_cast<uint8_t *>(region.data());
+    std::memcpy(dst, stash_.data(), stashed_);
+
+    ssize_t n = read(fd, dst + stashed_, region.size_bytes() - stashed_);
+    if (n <= 0)
+      return n;
+    uint64_t received = pipeline_stamp();
+
+    size_t total = stashed_ + static_cast<size_t>(n);
+    published = total / sizeof(T);
+    stashed_ = total % sizeof(T);
+    std::memcpy(stash_.data(), dst + published * sizeof(T), stashed_);
+
+    if (tags_ && published)
+      tags_->tag(session_, published, {received, pipeline_stamp()});
+    queue_.publish(published);
+    return n;
+  }
+
+  // Same framing for bytes that already sit in memory (e.g. an io_uring
+  // provided buffer): copies as much as fits into free slots. Returns the
+  // number of input bytes taken; `published` counts completed messages.
+  size_t ingest(const uint8_t *data, size_t len, size_t &published) {
+    published = 0;
+    size_t taken = 0;
+    uint64_t received = pipeline_stamp();
+
+    while (taken < len) {
+      auto region = queue_.claim(max_batch_);
+      if (region.empty())
+        break;
+
+      uint8_t *dst = reinterpret_cast<uint8_t *>(region.data());
+      std::memcpy(dst, stash_.data(), stashed_);
+
+      size_t n = std::min(region.size_bytes() - stashed_, len - taken);
+      std::memcpy(dst + stashed_, data + taken, n);
+      taken += n;
+
+      size_t total = stashed_ + n;
+      size_t complete = total / sizeof(T);
+      stashed_ = total % sizeof(T);
+      std::memcpy(stash_.data(), dst + complete * sizeof(T), stashed_);
+
+      if (tags_ && complete)
+        tags_->tag(session_, complete, {received, pipeline_stamp()});
+      queue_.publish(complete);
+      published += complete;
+    }
+    return taken;
+  }
+
+  size_t pending_bytes() const noexcept { return stashed_; }
+};
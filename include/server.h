@@ -1,5 +1,20 @@
 #pragma once
 
 #include "TSCClock.h"
+#include "config.h"
+#include "ingress_telemetry.h"
+#include "shard.h"
 #include <atomic>
-void start_tcp_server(std::atomic<bool> &stop_flag, TSCClock hardware_clock);
+
+class ExecWriter;
+
+// Serves gateway sessions into order_queue (tagged in order_tags) until
+// stop_flag is set. With a router, the network thread also moves orders on
+// to the shard rings; without one, a single matcher consumes order_queue
+// directly. With a writer, each session is registered for execution reports.
+// The network thread records into `telemetry`; others may read it.
+void start_tcp_server(std::atomic<bool> &stop_flag, TSCClock hardware_clock,
+                      const EngineConfig &config,
+                      Ingress_Telemetry &telemetry,
+                      ShardRouter *router = nullptr,
+                      ExecWriter *writer = nullptr);
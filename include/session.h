@@ -0,0 +1,140 @@
+#pragma once
+
+#include "ring_reader.h"
+#include "session_tags.h"
+#include "spsc_queue.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Gateway connections owned by the network thread. Each session frames its
+// own byte stream through a private RingReader, so a message split across
+// reads is stashed per session and never interleaves with another gateway's
+// bytes in the shared order ring.
+//
+// Counters are plain integers: sessions are only touched by the network
+// thread.
+template <typename T, size_t Size> class SessionTable {
+public:
+  struct Session {
+    int fd;
+    uint32_t id;  // slot, reused after close
+    uint32_t tag; // unique for the table's lifetime; never 0
+    std::string peer;
+    RingReader<T, Size> reader;
+    std::chrono::steady_clock::time_point connected_at;
+
+    uint64_t msgs{0};
+    uint64_t bytes{0};
+    uint64_t reads{0};  // read() calls or io_uring completions
+    uint64_t stalls{0}; // deliveries that found the order ring full
+
+    Session(int fd_, uint32_t id_, uint32_t tag_, std::string peer_,
+            SPSCQueue<T, Size> &q, SessionTags<Size> *tags, size_t max_batch)
+        : fd(fd_), id(id_), tag(tag_), peer(std::move(peer_)),
+          reader(q, max_batch, tags, tag_),
+          connected_at(std::chrono::steady_clock::now()) {}
+
+    void record(size_t n_bytes, size_t n_msgs) noexcept {
+      reads++;
+      bytes += n_bytes;
+      msgs += n_msgs;
+    }
+
+    void dump() const noexcept {
+      double secs = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - connected_at)
+                        .count();
+      std::printf("[Session %u %s] msgs=%lu bytes=%lu reads=%lu stalls=%lu "
+                  "rate=%.0f msg/s\n",
+                  id, peer.c_str(), msgs, bytes, reads, stalls,
+                  secs > 0 ? msgs / secs : 0.0);
+    }
+  };
+
+private:
+  SPSCQueue<T, Size> &queue_;
+  SessionTags<Size> *tags_;
+  size_t max_batch_;
+  std::vector<std::unique_ptr<Session>> slots_;
+  std::vector<uint32_t> free_ids_;
+  size_t active_{0};
+  uint64_t opened_{0};
+
+public:
+  // `max_batch` caps the orders one session frames per read, which bounds
+  // how long the other sessions wait for their turn.
+  // With `tags`, each order is attributed to its session's tag so replies
+  // can find their way back.
+  explicit SessionTable(SPSCQueue<T, Size> &queue, size_t max_sessions = 64,
+                        size_t max_batch = 2048,
+                        SessionTags<Size> *tags = nullptr)
+      : queue_(queue), tags_(tags), max_batch_(max_batch),
+        slots_(max_sessions) {
+    free_ids_.reserve(max_sessions);
+    for (size_t i = max_sessions; i > 0; i--)
+      free_ids_.push_back(static_cast<uint32_t>(i - 1));
+  }
+
+  ~SessionTable() {
+    for (auto &s : slots_) {
+      if (s)
+        ::close(s->fd);
+    }
+  }
+
+  SessionTable(const SessionTable &) = delete;
+  SessionTable &operator=(const SessionTable &) = delete;
+
+  // Takes ownership of `fd`. Returns nullptr when every slot is in use;
+  // the caller still owns the fd in that case.
+  Session *open(int fd, std::string peer) {
+    if (free_ids_.empty())
+      return nullptr;
+    uint32_t id = free_ids_.back();
+    free_ids_.pop_back();
+    opened_++;
+    auto tag = static_cast<uint32_t>(opened_);
+    slots_[id] = std::make_unique<Session>(fd, id, tag, std::move(peer),
+                                           queue_, tags_, max_batch_);
+    active_++;
+    return slots_[id].get();
+  }
+
+  Session *get(uint32_t id) noexcept {
+    return id < slots_.size() ? slots_[id].get() : nullptr;
+  }
+
+  // Prints the session's counters, closes its socket and frees the slot.
+  // A partially received message is dropped with it.
+  void close(uint32_t id) {
+    Session *s = get(id);
+    if (!s)
+      return;
+    s->dump();
+    if (s->reader.pending_bytes() > 0)
+      std::printf("[Session %u] dropped %zu bytes of a partial order\n", id,
+                  s->reader.pending_bytes());
+    ::close(s->fd);
+    slots_[id].reset();
+    free_ids_.push_back(id);
+    active_--;
+  }
+
+  size_t active() const noexcept { return active_; }
+  size_t capacity() const noexcept { return slots_.size(); }
+  uint64_t opened() const noexcept { return opened_; }
+
+  template <typename F> void for_each(F &&fn) {
+    for (auto &s : slots_) {
+      if (s)
+        fn(*s);
+    }
+  }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "TSCClock.h"
+#include "spsc_queue.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+// Which gateway session each order in an SPSC order ring came from, without
+// touching the order bytes (they are read straight off the socket into the
+// ring). The producer records a mark only when the session changes, or
+// when a stamped batch starts; the consumer walks its orders in ring order
+// and picks the marks up as it reaches them. A mark thus doubles as the
+// envelope of its orders' pipeline stamps.
+//
+// A mark is pushed before the orders it covers are published, so by the
+// time the consumer sees an order its mark is visible too. Marks never
+// outnumber orders in flight, so a mark ring as large as the order ring
+// cannot overflow.
+template <size_t Size> class SessionTags {
+  struct Mark {
+    uint64_t seq; // ring position of the first order from `session`
+    uint32_t session;
+    OrderStamps stamps;
+  };
+  static constexpr uint64_t NO_MARK = ~uint64_t{0};
+
+  SPSCQueue<Mark, Size> marks_{};
+
+  // Producer side
+  uint64_t produced_{0};
+  uint32_t last_{0};
+  uint64_t last_enqueued_{0};
+
+  // Consumer side
+  alignas(64) uint64_t consumed_{0};
+  uint64_t next_seq_{NO_MARK};
+  uint32_t next_session_{0};
+  uint32_t current_{0};
+  OrderStamps next_stamps_{};
+  OrderStamps current_stamps_{};
+
+  void load_next() {
+    auto m = marks_.peek(1);
+    if (m.empty()) {
+      next_seq_ = NO_MARK;
+    } else {
+      next_seq_ = m[0].seq;
+      next_session_ = m[0].session;
+      next_stamps_ = m[0].stamps;
+    }
+  }
+
+public:
+  // Session tag 0 means "no session" (replays, tests)
+  static constexpr uint32_t NONE = 0;
+
+  // Producer: call before publishing `n` orders from `session`, with the
+  // batch's stamps if it has any
+  inline void tag(uint32_t session, size_t n, OrderStamps stamps = {}) {
+    if (session != last_ || stamps.enqueued != last_enqueued_) {
+      [[maybe_unused]] bool ok = marks_.enqueue({produced_, session, stamps});
+      assert(ok && "session mark ring overflow");
+      last_ = session;
+      last_enqueued_ = stamps.enqueued;
+    }
+    produced_ += n;
+  }
+
+  // Consumer: call once per batch of orders, before next()
+  inline void refresh() {
+    if (next_seq_ == NO_MARK)
+      load_next();
+  }
+
+  // Consumer: the session of the next order, called once per order
+  inline uint32_t next() {
+    if (consumed_ == next_seq_) [[unlikely]] {
+      current_ = next_session_;
+      current_stamps_ = next_stamps_;
+      marks_.consume(1);
+      load_next();
+    }
+    consumed_++;
+    return current_;
+  }
+
+  // Consumer: the stamps of the order last returned by next()
+  inline OrderStamps stamps() const noexcept { return current_stamps_; }
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "TSCClock.h"
+#include "book_registry.h"
+#include "book_snapshot.h"
+#include "checkpoint.h"
+#include "depth_feed.h"
+#include "exec_report.h"
+#include "huge_arena.h"
+#include "journal.h"
+#include "order.h"
+#include "session_tags.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Capacity of the network -> matcher order ring, and of each shard's ring
+constexpr size_t ORDER_QUEUE_SIZE = 65536;
+using OrderQueue = SPSCQueue<Client::Order, ORDER_QUEUE_SIZE>;
+using OrderTags = SessionTags<ORDER_QUEUE_SIZE>;
+
+// Optional outputs of a shard's books
+struct ShardOptions {
+  bool exec_reports{false}; // fill exec_queue_ for an ExecWriter
+  bool depth_feed{false};   // fill depth_queue_ for a DepthPublisher
+  SnapshotWriter *snapshot{nullptr}; // shared-memory top-of-book, if any
+  Journal *journal{nullptr};         // write-ahead journal of the input
+  Checkpointer *checkpoint{nullptr}; // binary book checkpoints
+  HugeArena *arena{nullptr};         // book pool slabs; heap when null
+};
+
+// Book totals a matcher publishes for out-of-band readers. A reader bumps
+// `asked`; the matcher recounts between batches and then sets `answered`,
+// so the hot loop pays one relaxed load per batch and walks its books only
+// when someone is looking.
+struct ShardGauges {
+  std::atomic<uint64_t> asked{0};
+  std::atomic<uint64_t> answered{0};
+  std::atomic<uint64_t> books{0};
+  std::atomic<uint64_t> levels{0};
+  std::atomic<uint64_t> resting{0};
+};
+
+// One matching thread and the books it owns. Instruments are partitioned
+// across shards by id, so a symbol is only ever touched by one thread.
+class Shard {
+  size_t index_;
+  uint64_t processed_{0};
+  bool verbose_{true}; // telemetry summary on exit
+  SnapshotWriter *snapshot_;
+  Journal *journal_;
+  Checkpointer *checkpoint_;
+  std::vector<std::pair<InstrumentId, BookRegistry::Book *>> touched_;
+
+  bool started_{false};
+  std::chrono::steady_clock::time_point started_at_; // first batch matched
+
+  // Input records journaled so far this run, i.e. what a checkpoint covers
+  uint64_t journaled() const noexcept {
+    return journal_ ? journal_->appended() : 0;
+  }
+
+  // The matching loop's pieces, shared by run() and replay(). Orders
+  // without `tags` belong to no session.
+  void begin(TSCClock hardware_clock);
+  void match_batch(std::span<const Client::Order> batch, OrderTags *tags,
+                   TSCClock hardware_clock);
+  void report_progress();
+  void count_gauges(uint64_t asked);
+
+  // Recounts the gauges if a reader has asked since the last count
+  inline void answer_gauges() {
+    uint64_t asked = gauges_.asked.load(std::memory_order_relaxed);
+    if (asked != gauges_.answered.load(std::memory_order_relaxed))
+        [[unlikely]]
+      count_gauges(asked);
+  }
+  void finish();
+
+public:
+  Telemetry telemetry_;
+  ShardGauges gauges_;
+  ExecQueue exec_queue_; // drained by the ExecWriter when reports are on
+  ExecSink exec_;
+  DepthQueue depth_queue_; // drained by the DepthPublisher when the feed is on
+  DepthTracker depth_;
+  BookRegistry books_;
+  OrderQueue queue_; // fed by ShardRouter when there is more than one shard
+  OrderTags tags_;   // session of each order in queue_
+
+  // Each enabled output's ring must be drained by its consumer thread, or
+  // the matcher stalls once the ring fills.
+  explicit Shard(size_t index, ShardOptions opts = {})
+      : index_(index), snapshot_(opts.snapshot), journal_(opts.journal),
+        checkpoint_(opts.checkpoint), exec_(exec_queue_, telemetry_),
+        depth_(depth_queue_, telemetry_),
+        books_(telemetry_, opts.exec_reports ? &exec_ : nullptr,
+               opts.depth_feed ? &depth_ : nullptr, opts.arena) {}
+
+  Shard(const Shard &) = delete;
+  Shard &operator=(const Shard &) = delete;
+
+  size_t index() const noexcept { return index_; }
+  uint64_t processed() const noexcept { return processed_; }
+
+  // Off silences the telemetry summary printed on exit
+  void set_verbose(bool verbose) noexcept { verbose_ = verbose; }
+
+  inline void dispatch(const Client::Order &order) {
+    BookRegistry::Book &b = books_.get(order.instrument);
+    bool is_buy = (order.side == Side::Bid);
+
+    if (!b.touched) {
+      b.touched = true;
+      touched_.emplace_back(order.instrument, &b);
+    }
+
+    if (order.order_type == OrderType::Limit) {
+      b.book.addOrder(b.next_order_id++, order.price, order.quantity, is_buy,
+                      order.account_id);
+    } else if (order.order_type == OrderType::Market) {
+      b.book.matchMarketOrder(is_buy, order.quantity, order.order_id);
+    } else {
+      b.book.removeOrder(order.order_id);
+    }
+  }
+
+  // Publishes the stats, and a snapshot, of every book dispatched to since
+  // the last call
+  void publish_touched(TSCClock hardware_clock);
+
+  // Matching loop: drains `input` (with the session of each order in
+  // `tags`) until `closed` is set and the ring is empty.
+  void run(OrderQueue &input, OrderTags &tags,
+           const std::atomic<bool> &closed, TSCClock hardware_clock);
+
+  // The same loop fed straight from memory (e.g. a mapped order file), in
+  // batches of the same size, with no ring and no sessions
+  void replay(std::span<const Client::Order> orders, TSCClock hardware_clock);
+};
+
+// Network-thread side of sharding: moves orders from the ingress ring to the
+// ring of the shard that owns their instrument.
+class ShardRouter {
+  // Slots claimed in one shard's ring during a route() call
+  struct Pending {
+    std::span<Client::Order> slots;
+    size_t used{0};
+  };
+
+  std::vector<Shard *> shards_;
+  std::vector<Pending> pending_; // by shard, reused across calls
+  uint64_t routed_{0};
+  uint64_t blocked_{0};
+
+  // The next free slot of `shard`'s ring, or nullptr if it is full
+  Client::Order *slot_for(size_t shard) {
+    Pending &p = pending_[shard];
+    if (p.used == p.slots.size()) {
+      // Used up (or hit the wrap point): hand over what is filled first
+      if (p.used > 0)
+        shards_[shard]->queue_.publish(p.used);
+      p.slots = shards_[shard]->queue_.claim(ROUTE_BATCH);
+      p.used = 0;
+      if (p.slots.empty())
+        return nullptr;
+    }
+    return &p.slots[p.used++];
+  }
+
+public:
+  // Orders moved per route() call
+  static constexpr size_t ROUTE_BATCH = 1024;
+
+  explicit ShardRouter(std::vector<Shard *> shards)
+      : shards_(std::move(shards)), pending_(shards_.size()) {}
+
+  size_t shards() const noexcept { return shards_.size(); }
+  uint64_t routed() const noexcept { return routed_; }
+  uint64_t blocked() const noexcept { return blocked_; }
+
+  inline size_t shard_of(InstrumentId instrument) const noexcept {
+    return instrument % shards_.size();
+  }
+
+  // Routes staged orders in arrival order, carrying each order's session
+  // and pipeline stamps over to the shard's tags. Stops at the first order
+  // whose shard ring is full, so orders for one symbol are never reordered.
+  // Returns the number routed.
+  size_t route(OrderQueue &staging, OrderTags &staging_tags) {
+    auto batch = staging.peek(ROUTE_BATCH);
+    staging_tags.refresh();
+    size_t n = 0;
+    for (; n < batch.size(); n++) {
+      const Client::Order &order = batch[n];
+      size_t shard = shard_of(order.instrument);
+      Client::Order *slot = slot_for(shard);
+      if (!slot) {
+        blocked_++;
+        break;
+      }
+      *slot = order;
+      uint32_t session = staging_tags.next();
+      shards_[shard]->tags_.tag(session, 1, staging_tags.stamps());
+    }
+    // One release store (and consumer wake-up) per shard per batch
+    for (size_t i = 0; i < pending_.size(); i++) {
+      Pending &p = pending_[i];
+      if (p.used > 0)
+        shards_[i]->queue_.publish(p.used);
+      p = {};
+    }
+    staging.consume(n);
+    routed_ += n;
+    return n;
+  }
+};
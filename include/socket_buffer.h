@@ -78,4 +78,24 @@ public:
 
     return bytes_fulfilled;
   }
+
+  // Batch path: slides any partial message to the front, then reads as much
+  // as the socket has into the free space. Returns read()'s result.
+  ssize_t fill(int fd) {
+    if (head_ > 0) {
+      size_t leftover = tail_ - head_;
+      memmove(buf_.data(), buf_.data() + head_, leftover);
+      head_ = 0;
+      tail_ = leftover;
+    }
+
+    ssize_t n = read(fd, buf_.data() + tail_, buf_.size() - tail_);
+    if (n > 0)
+      tail_ += n;
+    return n;
+  }
+
+  const uint8_t *data() const noexcept { return buf_.data() + head_; }
+  size_t size() const noexcept { return tail_ - head_; }
+  void consume(size_t bytes) noexcept { head_ += bytes; }
 };
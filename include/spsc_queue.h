@@ -1,7 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <optional>
+#include <span>
 
 using namespace std;
 
@@ -9,28 +11,82 @@ template <typename T, size_t Size> class SPSCQueue {
   static_assert((Size & (Size - 1)) == 0, "Size must be a power of 2");
 
   array<T, Size> buffer;
+
+  // Each side keeps a private copy of the peer's index next to its own and
+  // only re-reads the shared atomic when the copy says full/empty, so the
+  // peer's cache line is touched once per batch instead of once per item.
   alignas(64) atomic<size_t> head{0};
+  size_t tail_cache{0}; // producer-owned
   alignas(64) atomic<size_t> tail{0};
+  size_t head_cache{0}; // consumer-owned
+
+  // Slots free for the producer, refreshing the cached tail if needed
+  size_t writable(size_t current_head, size_t wanted) {
+    size_t free_slots = (tail_cache - current_head - 1) & (Size - 1);
+    if (free_slots < wanted) {
+      tail_cache = tail.load(memory_order_acquire);
+      free_slots = (tail_cache - current_head - 1) & (Size - 1);
+    }
+    return free_slots;
+  }
+
+  // Slots ready for the consumer, refreshing the cached head if needed
+  size_t readable(size_t current_tail, size_t wanted) {
+    size_t ready = (head_cache - current_tail) & (Size - 1);
+    if (ready < wanted) {
+      head_cache = head.load(memory_order_acquire);
+      ready = (head_cache - current_tail) & (Size - 1);
+    }
+    return ready;
+  }
 
 public:
   bool enqueue(const T &item) {
     size_t current_head = head.load(memory_order_relaxed);
-    size_t next_head = (current_head + 1) & (Size - 1);
-
-    if (next_head == tail.load(memory_order_acquire)) {
+    if (writable(current_head, 1) == 0) {
       // Queue full
       return false;
     }
 
     buffer[current_head] = item;
-    head.store(next_head, memory_order_release);
+    head.store((current_head + 1) & (Size - 1), memory_order_release);
     return true;
   }
 
+  // Enqueues as many items as fit and publishes them with a single release
+  // store. Returns the number enqueued.
+  size_t try_enqueue_n(span<const T> items) {
+    size_t current_head = head.load(memory_order_relaxed);
+    size_t n = min(items.size(), writable(current_head, items.size()));
+    if (n == 0)
+      return 0;
+
+    size_t first = min(n, Size - current_head);
+    copy_n(items.data(), first, buffer.data() + current_head);
+    copy_n(items.data() + first, n - first, buffer.data());
+
+    head.store((current_head + n) & (Size - 1), memory_order_release);
+    return n;
+  }
+
+  // Zero-copy producer path: the contiguous run of free slots at head (up to
+  // the ring's wrap point). Fill them in place, e.g. straight from read(),
+  // then publish(n). Unpublished slots are invisible to the consumer.
+  span<T> claim(size_t max = Size) {
+    size_t current_head = head.load(memory_order_relaxed);
+    size_t n = min({writable(current_head, max), Size - current_head, max});
+    return {buffer.data() + current_head, n};
+  }
+
+  void publish(size_t n) {
+    size_t current_head = head.load(memory_order_relaxed);
+    head.store((current_head + n) & (Size - 1), memory_order_release);
+  }
+
   optional<T> dequeue() {
     size_t current_tail = tail.load(memory_order_relaxed);
 
-    if (current_tail == head.load(memory_order_acquire)) {
+    if (readable(current_tail, 1) == 0) {
       // Queue empty
       return nullopt;
     }
@@ -39,4 +95,42 @@ public:
     tail.store((current_tail + 1) & (Size - 1), memory_order_release);
     return item;
   }
+
+  // Copies up to out.size() items and releases them with one store.
+  // Returns the number dequeued.
+  size_t dequeue_n(span<T> out) {
+    size_t current_tail = tail.load(memory_order_relaxed);
+    size_t n = min(out.size(), readable(current_tail, out.size()));
+    if (n == 0)
+      return 0;
+
+    size_t first = min(n, Size - current_tail);
+    copy_n(buffer.data() + current_tail, first, out.data());
+    copy_n(buffer.data(), n - first, out.data() + first);
+
+    tail.store((current_tail + n) & (Size - 1), memory_order_release);
+    return n;
+  }
+
+  // Zero-copy consumer path: view the contiguous run of ready items (up to
+  // the ring's wrap point), process them in place, then consume(n). Items
+  // stay owned by the consumer until consume publishes the new tail.
+  span<const T> peek(size_t max = Size) {
+    size_t current_tail = tail.load(memory_order_relaxed);
+    size_t n = min({readable(current_tail, max), Size - current_tail, max});
+    return {buffer.data() + current_tail, n};
+  }
+
+  void consume(size_t n) {
+    size_t current_tail = tail.load(memory_order_relaxed);
+    tail.store((current_tail + n) & (Size - 1), memory_order_release);
+  }
+
+  // Consumer side: items published and not yet consumed. Reads the shared
+  // head, so call it once per batch rather than once per item.
+  size_t occupancy() const {
+    return (head.load(memory_order_acquire) -
+            tail.load(memory_order_relaxed)) &
+           (Size - 1);
+  }
 };
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "ingress_telemetry.h"
+#include "latency_histogram.h"
+#include "shard.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shards with a line in the stats segment; later shards are not published
+constexpr size_t STATS_MAX_SHARDS = 64;
+
+namespace Client {
+
+// Layout of the stats segment: a header, then one EngineStats record under
+// a seqlock. Every field is a 64-bit word so both sides can copy it with
+// (relaxed) atomic accesses. Counters are totals since start; rates and
+// latency percentiles cover the last interval only.
+struct StatsShard {
+  uint64_t orders;
+  uint64_t matched;
+  uint64_t cancelled;
+  uint64_t stale_cancels;
+  uint64_t orders_per_sec;
+  uint64_t books;
+  uint64_t levels;
+  uint64_t resting;
+  uint64_t p50_ns;
+  uint64_t p90_ns;
+  uint64_t p99_ns;
+  uint64_t p999_ns;
+  uint64_t max_ns;
+  // p99 of each pipeline stage over the interval; 0 when nothing was
+  // stamped (telemetry off, direct replays)
+  uint64_t network_p99_ns;
+  uint64_t queue_p99_ns;
+  uint64_t book_p99_ns;
+  uint64_t queue_high_water; // deepest order ring backlog since start
+  int64_t core;              // matcher's core, -1 when floating
+  uint64_t core_isolated;
+  uint64_t fifo_priority; // 0: default scheduling class
+};
+
+struct alignas(64) EngineStats {
+  uint64_t seq;     // seqlock: odd while the reporter is writing
+  uint64_t updates; // samples so far
+  uint64_t uptime_ns;
+  uint64_t interval_ns; // since the previous sample
+  uint64_t ingress_msgs;
+  uint64_t ingress_msgs_per_sec;
+  uint64_t ingress_syscalls;
+  int64_t network_core; // -1 when floating or not serving
+  uint64_t network_core_isolated;
+  uint64_t network_fifo_priority;
+  uint64_t memory_locked;
+  uint64_t shards;
+  StatsShard shard[STATS_MAX_SHARDS];
+};
+
+struct alignas(64) StatsHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t max_shards;
+};
+
+constexpr uint64_t STATS_MAGIC = 0x4642535441545331; // "FBSTATS1"
+constexpr uint64_t STATS_VERSION = 3;
+
+}; // namespace Client
+
+struct StatsOptions {
+  std::chrono::milliseconds interval{1000};
+  bool print{true}; // a line per busy shard per interval on stdout
+  std::string shm;  // also publish to this segment, e.g. "/fastbook-stats"
+  bool memory_locked{false}; // reported as is
+};
+
+// Renders engine telemetry off the matching and network threads. Every
+// interval it asks each shard for its book gauges, reads the shards' and
+// the network thread's telemetry (each written by its own thread only),
+// and prints rates and the interval's latency percentiles and/or publishes
+// them to shared memory for fastbook_stat. The hot threads never format,
+// print or scan a histogram.
+class StatsReporter {
+  std::vector<Shard *> shards_;
+  const Ingress_Telemetry *ingress_;
+  StatsOptions opts_;
+
+  void *base_{nullptr};
+  size_t bytes_{0};
+  Client::EngineStats *segment_{nullptr};
+
+  Client::EngineStats current_{};
+  // Each shard's merged and per-stage latency at the previous sample
+  using Snapshot = std::unique_ptr<LatencyHistogram>;
+  std::vector<Snapshot> last_latency_;
+  std::vector<std::array<Snapshot, Telemetry::STAGES>> last_stages_;
+  std::vector<uint64_t> last_orders_;
+  uint64_t last_ingress_{0};
+  std::chrono::steady_clock::time_point started_, last_sample_;
+
+  void ask_gauges();
+  void publish() noexcept;
+
+public:
+  // `ingress` may be null (replays)
+  StatsReporter(std::vector<Shard *> shards, const Ingress_Telemetry *ingress,
+                StatsOptions opts);
+  // Unmaps and unlinks the segment; readers already attached keep theirs
+  ~StatsReporter();
+
+  StatsReporter(const StatsReporter &) = delete;
+  StatsReporter &operator=(const StatsReporter &) = delete;
+
+  // False if a segment was asked for and could not be created
+  bool ok() const noexcept { return opts_.shm.empty() || segment_; }
+
+  // Reporter thread: samples every interval until `done` is set
+  void run(const std::atomic<bool> &done);
+
+  // Takes one sample now, prints and publishes it
+  void sample();
+
+  const Client::EngineStats &last() const noexcept { return current_; }
+};
+
+// Reader side of the stats segment, for fastbook_stat. Lock-free: a read
+// that overlaps a publish retries.
+class StatsReader {
+  void *base_{nullptr};
+  size_t bytes_{0};
+  const Client::EngineStats *stats_{nullptr};
+
+public:
+  explicit StatsReader(const std::string &name);
+  ~StatsReader();
+
+  StatsReader(const StatsReader &) = delete;
+  StatsReader &operator=(const StatsReader &) = delete;
+
+  bool ok() const noexcept { return stats_ != nullptr; }
+
+  // Copies a consistent sample into `out`
+  void read(Client::EngineStats &out) noexcept;
+};
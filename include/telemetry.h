@@ -1,6 +1,9 @@
 #pragma once
 #include "TSCClock.h"
-#include <algorithm>
+#include "affinity.h"
+#include "latency_histogram.h"
+#include "types.h"
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
@@ -12,17 +15,64 @@ struct Telemetry {
   std::atomic<uint64_t> matched_orders{0};
   std::atomic<uint64_t> cancelled_orders{0};
   std::atomic<uint64_t> stale_cancels{0};
+  std::atomic<uint64_t> rejected_orders{0}; // too large for the order layout
   std::atomic<uint64_t> total_latency_ns{0};
 
   std::atomic<uint64_t> total_allocs{0};
   std::atomic<uint64_t> reused_allocs{0};
 
-  static constexpr uint64_t BIN_SHIFT = 5;
-  static constexpr uint64_t BIN_WIDTH_NS = 1 << BIN_SHIFT; // each bin = 32 ns
-                                                           //
-  static constexpr uint64_t MAX_TRACK_NS = 5'000'000;      // 5 ms cap
-  static constexpr size_t NUM_BINS = (MAX_TRACK_NS >> BIN_SHIFT) + 1;
-  std::array<std::atomic<uint64_t>, NUM_BINS> hist{};
+  // Order id index (open addressing)
+  std::atomic<uint64_t> index_lookups{0};
+  std::atomic<uint64_t> index_probes{0};
+  std::atomic<uint64_t> index_max_probe{0};
+  std::atomic<uint64_t> index_size{0};
+  std::atomic<uint64_t> index_capacity{0};
+  std::atomic<uint64_t> index_rehashes{0};
+
+  // Level pool occupancy
+  std::atomic<uint64_t> levels_in_use{0};
+  std::atomic<uint64_t> level_capacity{0};
+
+  // Execution-report egress
+  std::atomic<uint64_t> exec_reports{0};
+  std::atomic<uint64_t> exec_ns{0};
+  std::atomic<uint64_t> exec_ring_full{0};
+
+  // L2 depth feed
+  std::atomic<uint64_t> depth_events{0};
+  std::atomic<uint64_t> depth_updates{0};
+  std::atomic<uint64_t> depth_ring_full{0};
+
+  // Shared-memory book snapshots
+  std::atomic<uint64_t> snapshots{0};
+  std::atomic<uint64_t> snapshot_ns{0};
+
+  // Dispatch latency by order type, and for limit and market orders by
+  // outcome: rested without trading, or traded
+  std::array<LatencyHistogram, 3> latency_by_type; // indexed by OrderType
+  LatencyHistogram latency_resting;
+  LatencyHistogram latency_crossing;
+
+  // Pipeline stages of stamped orders: network (bytes read to published on
+  // the ring), queue (published to dequeued by the matcher) and book
+  // (dequeued to matched, so including the orders ahead in the batch)
+  enum Stage : size_t { NETWORK, QUEUE, BOOK, TOTAL, STAGES };
+  static constexpr const char *STAGE_NAMES[STAGES] = {"network", "queue",
+                                                      "book", "total"};
+  std::array<LatencyHistogram, STAGES> latency_by_stage;
+
+  // Core and scheduling class of the matching thread
+  PlacementGauge placement;
+
+  // Order ring occupancy seen by the matcher at each batch
+  std::atomic<uint64_t> queue_batches{0};
+  std::atomic<uint64_t> queue_depth_sum{0};
+  std::atomic<uint64_t> queue_high_water{0};
+
+  // Single-writer add: a relaxed load and store, no locked instruction
+  static void add(std::atomic<uint64_t> &c, uint64_t n) noexcept {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
 
   void record_order() noexcept {
     total_orders.fetch_add(1, std::memory_order_relaxed);
@@ -40,19 +90,91 @@ struct Telemetry {
     stale_cancels.fetch_add(1, std::memory_order_relaxed);
   }
 
+  void record_reject() noexcept {
+    rejected_orders.fetch_add(1, std::memory_order_relaxed);
+  }
+
   void record_alloc(bool reused) {
     total_allocs.fetch_add(1, std::memory_order_relaxed);
     if (reused)
       reused_allocs.fetch_add(1, std::memory_order_relaxed);
   }
 
-  void record_latency(uint64_t ns) noexcept {
-    size_t idx = std::min<size_t>((ns >> BIN_SHIFT), NUM_BINS - 1);
-    hist[idx].fetch_add(1, std::memory_order_relaxed);
+  // Folds in counts an index gathered since its last publish. Indexes
+  // publish from their owning thread only, so plain adds are enough.
+  void record_index_probes(uint64_t lookups, uint64_t probes,
+                           uint64_t max_probe, uint64_t rehashes) noexcept {
+    add(index_lookups, lookups);
+    add(index_probes, probes);
+    add(index_rehashes, rehashes);
+    if (max_probe > index_max_probe.load(std::memory_order_relaxed))
+      index_max_probe.store(max_probe, std::memory_order_relaxed);
+  }
+
+  void record_index_load(uint64_t size, uint64_t capacity) noexcept {
+    index_size.store(size, std::memory_order_relaxed);
+    index_capacity.store(capacity, std::memory_order_relaxed);
+  }
+
+  void record_level_pool(uint64_t in_use, uint64_t capacity) noexcept {
+    levels_in_use.store(in_use, std::memory_order_relaxed);
+    level_capacity.store(capacity, std::memory_order_relaxed);
+  }
+
+  // One report pushed to the outbound ring in `ns` (0 when not timed)
+  void record_exec(uint64_t ns) noexcept {
+    exec_reports.fetch_add(1, std::memory_order_relaxed);
+    exec_ns.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  void record_exec_ring_full() noexcept {
+    exec_ring_full.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // One depth flush: `events` level changes conflated into `updates`
+  void record_depth(uint64_t events, uint64_t updates, bool stalled) noexcept {
+    depth_events.fetch_add(events, std::memory_order_relaxed);
+    depth_updates.fetch_add(updates, std::memory_order_relaxed);
+    if (stalled)
+      depth_ring_full.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // One book snapshot published in `ns` (0 when not timed)
+  void record_snapshot(uint64_t ns) noexcept {
+    snapshots.fetch_add(1, std::memory_order_relaxed);
+    snapshot_ns.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  void record_latency(uint64_t ns, OrderType type, bool crossed) noexcept {
+    latency_by_type[static_cast<size_t>(type)].record(ns);
+    if (crossed)
+      latency_crossing.record(ns);
+    else if (type == OrderType::Limit)
+      latency_resting.record(ns);
 
     total_latency_ns.fetch_add(ns, std::memory_order_relaxed);
   }
 
+  // One stamped order's trip, as TSC stamps; a stage that reads negative
+  // (stamps from cores whose TSCs disagree) counts as 0
+  void record_stages(OrderStamps stamps, uint64_t dequeued, uint64_t matched,
+                     const TSCClock &clock) noexcept {
+    auto ns = [&](uint64_t from, uint64_t to) {
+      return to > from ? clock.cycles_to_nanoseconds(to - from) : 0;
+    };
+    latency_by_stage[NETWORK].record(ns(stamps.received, stamps.enqueued));
+    latency_by_stage[QUEUE].record(ns(stamps.enqueued, dequeued));
+    latency_by_stage[BOOK].record(ns(dequeued, matched));
+    latency_by_stage[TOTAL].record(ns(stamps.received, matched));
+  }
+
+  void record_queue_depth(uint64_t depth) noexcept {
+    queue_batches.fetch_add(1, std::memory_order_relaxed);
+    queue_depth_sum.fetch_add(depth, std::memory_order_relaxed);
+    if (depth > queue_high_water.load(std::memory_order_relaxed))
+      queue_high_water.store(depth, std::memory_order_relaxed);
+  }
+
   double avg_latency_ns() const noexcept {
     auto total = total_orders.load(std::memory_order_relaxed);
     return total ? double(total_latency_ns.load(std::memory_order_relaxed)) /
@@ -66,64 +188,152 @@ struct Telemetry {
                  : 0.0;
   }
 
-  void dump_percentiles() const noexcept {
-    uint64_t total = 0;
-    for (auto &h : hist)
-      total += h.load(std::memory_order_relaxed);
-    if (total == 0)
-      return;
+  double avg_index_probe() const noexcept {
+    auto lookups = index_lookups.load(std::memory_order_relaxed);
+    return lookups ? double(index_probes.load(std::memory_order_relaxed)) /
+                         lookups
+                   : 0.0;
+  }
 
-    auto find_percentile = [&](double target) {
-      uint64_t cumulative = 0;
-      for (size_t i = 0; i < NUM_BINS; ++i) {
-        cumulative += hist[i].load(std::memory_order_relaxed);
-        if (double(cumulative) / total >= target)
-          return i * BIN_WIDTH_NS;
-      }
-      return (NUM_BINS - 1) * BIN_WIDTH_NS;
-    };
+  double index_load_factor() const noexcept {
+    auto capacity = index_capacity.load(std::memory_order_relaxed);
+    return capacity
+               ? double(index_size.load(std::memory_order_relaxed)) / capacity
+               : 0.0;
+  }
+
+  double avg_exec_ns() const noexcept {
+    auto reports = exec_reports.load(std::memory_order_relaxed);
+    return reports ? double(exec_ns.load(std::memory_order_relaxed)) / reports
+                   : 0.0;
+  }
 
-    auto p50 = find_percentile(0.50);
-    auto p90 = find_percentile(0.90);
-    auto p99 = find_percentile(0.99);
-    auto p999 = find_percentile(0.999);
+  // Adds every order's latency, whichever type, to `all`
+  void merge_latency_all(LatencyHistogram &all) const noexcept {
+    for (const auto &h : latency_by_type)
+      all.merge(h);
+  }
+
+  // Adds `other`'s latency histograms to these, e.g. to sum up shards
+  void merge_latency(const Telemetry &other) noexcept {
+    for (size_t t = 0; t < latency_by_type.size(); t++)
+      latency_by_type[t].merge(other.latency_by_type[t]);
+    latency_resting.merge(other.latency_resting);
+    latency_crossing.merge(other.latency_crossing);
+    for (size_t s = 0; s < STAGES; s++)
+      latency_by_stage[s].merge(other.latency_by_stage[s]);
+  }
+
+  void dump_percentiles() const noexcept {
+    LatencyHistogram all;
+    merge_latency_all(all);
+    if (all.total() == 0)
+      return;
+    all.print("all");
+    latency_by_type[0].print("limit");
+    latency_by_type[1].print("market");
+    latency_by_type[2].print("cancel");
+    latency_resting.print("resting");
+    latency_crossing.print("crossing");
+    if (latency_by_stage[TOTAL].total() == 0)
+      return;
+    for (size_t s = 0; s < STAGES; s++)
+      latency_by_stage[s].print(STAGE_NAMES[s]);
+  }
 
-    std::printf("p50=%lu ns  p90=%lu ns  p99=%lu ns  p999=%lu ns\n", p50, p90,
-                p99, p999);
+  // Every latency histogram as CSV for the notebooks in out/
+  bool write_latency_csv(const char *path) const noexcept {
+    FILE *f = std::fopen(path, "w");
+    if (!f) {
+      std::perror(path);
+      return false;
+    }
+    std::fprintf(f, "class,lower_ns,upper_ns,count\n");
+    latency_by_type[0].write_csv(f, "limit");
+    latency_by_type[1].write_csv(f, "market");
+    latency_by_type[2].write_csv(f, "cancel");
+    latency_resting.write_csv(f, "resting");
+    latency_crossing.write_csv(f, "crossing");
+    for (size_t s = 0; s < STAGES; s++)
+      latency_by_stage[s].write_csv(f, STAGE_NAMES[s]);
+    return std::fclose(f) == 0;
   }
 
   void dump(double elapsed_s) const noexcept {
     double throughput = total_orders.load() / elapsed_s;
     std::printf("[FastBook Telemetry]\n");
-    std::printf("orders=%lu matched=%lu cancelled=%lu stale cancels=%lu\n",
+    std::printf("orders=%lu matched=%lu cancelled=%lu stale cancels=%lu "
+                "rejected=%lu\n",
                 total_orders.load(), matched_orders.load(),
-                cancelled_orders.load(), stale_cancels.load());
+                cancelled_orders.load(), stale_cancels.load(),
+                rejected_orders.load());
     std::printf("avg_latency=%.2f ns, total_latency= %lu ns\n",
                 avg_latency_ns(), total_latency_ns.load());
     std::printf("throughput=%.2f ops/s\n", throughput);
+    std::printf("placement: %s\n", describe(placement.load()).c_str());
     std::printf("allocations=%lu reused=%.2f%%\n", total_allocs.load(),
                 reuse_ratio());
+    std::printf("index: avg_probe=%.2f max_probe=%lu load=%.2f rehashes=%lu\n",
+                avg_index_probe(), index_max_probe.load(), index_load_factor(),
+                index_rehashes.load());
+    std::printf("levels: in_use=%lu capacity=%lu\n", levels_in_use.load(),
+                level_capacity.load());
+    auto orders = total_orders.load();
+    std::printf("exec: reports=%lu per_order=%.2f avg_cost=%.1f ns "
+                "ring_full=%lu\n",
+                exec_reports.load(),
+                orders ? double(exec_reports.load()) / orders : 0.0,
+                avg_exec_ns(), exec_ring_full.load());
+    auto updates = depth_updates.load();
+    std::printf("depth: events=%lu updates=%lu conflation=%.2fx "
+                "ring_full=%lu\n",
+                depth_events.load(), updates,
+                updates ? double(depth_events.load()) / updates : 0.0,
+                depth_ring_full.load());
+    auto published = snapshots.load();
+    std::printf("snapshot: publishes=%lu avg_cost=%.1f ns\n", published,
+                published ? double(snapshot_ns.load()) / published : 0.0);
+    auto batches = queue_batches.load();
+    std::printf("queue: batches=%lu avg_depth=%.1f high_water=%lu\n",
+                batches,
+                batches ? double(queue_depth_sum.load()) / batches : 0.0,
+                queue_high_water.load());
     dump_percentiles();
   }
 };
 
-// Per-order latency measurement
+// Per-order latency measurement. An order crossed if any fill was recorded
+// while it was dispatched. A stamped order (one that came through a ring)
+// also records its pipeline stages, with the timer's end as matched.
 struct ScopedTimer {
 #ifdef ENABLE_TELEMETRY
 
   Telemetry &tel;
   TSCClock hardware_clock;
+  OrderType type;
+  OrderStamps stamps;
+  uint64_t dequeued;
+  uint64_t matched;
   uint64_t start;
-  explicit ScopedTimer(Telemetry &t, TSCClock clock) noexcept
-      : tel(t), hardware_clock(clock), start(hardware_clock.start()) {}
+  explicit ScopedTimer(Telemetry &t, TSCClock clock, OrderType ot,
+                       OrderStamps st = {}, uint64_t deq = 0) noexcept
+      : tel(t), hardware_clock(clock), type(ot), stamps(st), dequeued(deq),
+        matched(t.matched_orders.load(std::memory_order_relaxed)),
+        start(hardware_clock.start()) {}
 
   ~ScopedTimer() noexcept {
     uint64_t end = hardware_clock.stop();
     auto ns = hardware_clock.cycles_to_nanoseconds(end - start);
-    tel.record_latency(ns);
+    bool crossed =
+        tel.matched_orders.load(std::memory_order_relaxed) != matched;
+    tel.record_latency(ns, type, crossed);
+    if (stamps.received)
+      tel.record_stages(stamps, dequeued, end, hardware_clock);
   }
 #else
-  explicit ScopedTimer(Telemetry & /*t*/, TSCClock /*clock*/) noexcept {}
+  explicit ScopedTimer(Telemetry & /*t*/, TSCClock /*clock*/,
+                       OrderType /*ot*/, OrderStamps /*st*/ = {},
+                       uint64_t /*deq*/ = 0) noexcept {}
   ~ScopedTimer() noexcept {}
 #endif //  ENABLE_TELEMETRY
 };
@@ -6,6 +6,7 @@ using Volume = uint64_t;
 using OrderId = uint64_t;
 using AccountId = uint64_t;
 using Tick = uint32_t;
+using InstrumentId = uint16_t;
 
 enum class Side : uint8_t { Bid = 0, Ask = 1 };
 enum class OrderType : uint8_t { Limit = 0, Market = 1, Cancel = 2 };
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/types.h>
+#include <vector>
+
+struct UringOptions {
+  bool sqpoll{false};
+  unsigned buffers{64};           // provided buffers, power of 2
+  unsigned buffer_size{1 << 16}; // bytes per provided buffer
+};
+
+// io_uring receive path for a set of sockets, written against the raw kernel
+// ABI. A multishot accept on the listener and one multishot recv per session
+// draw from a shared, registered provided-buffer ring, so the kernel keeps
+// posting completions without any per-read submission. The CQ ring is polled
+// from user space; syscalls are only made to arm requests, to wake an idle
+// SQPOLL thread, or to flush task work after a long idle spin.
+class UringIngress {
+  static constexpr uint16_t BUFFER_GROUP = 0;
+  static constexpr unsigned IDLE_SPINS = 1024; // empty polls before enter()
+  static constexpr unsigned SQ_ENTRIES = 64;
+
+  // user_data = kind << 32 | session id
+  static constexpr uint64_t KIND_ACCEPT = 1;
+  static constexpr uint64_t KIND_RECV = 2;
+
+  UringOptions opts_;
+  int ring_fd_{-1};
+  int listen_fd_{-1};
+  std::vector<int> recv_fds_; // session id -> socket, -1 when not watched
+
+  // Submission queue
+  void *sq_ptr_{nullptr};
+  size_t sq_len_{0};
+  unsigned *sq_head_{nullptr};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_entries_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *sq_flags_{nullptr};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_len_{0};
+  unsigned unsubmitted_{0};
+
+  // Completion queue
+  void *cq_ptr_{nullptr};
+  size_t cq_len_{0};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+
+  // Provided buffer ring
+  io_uring_buf *buf_ring_{nullptr};
+  size_t buf_ring_len_{0};
+  uint8_t *buffers_{nullptr};
+  uint16_t buf_tail_{0};
+
+  bool ready_{false};
+  bool accept_armed_{false};
+  std::vector<uint32_t> rearm_; // sessions whose multishot recv ended
+  unsigned idle_spins_{0};
+  uint64_t syscalls_{0};
+
+  int enter(unsigned to_submit, unsigned flags);
+  io_uring_sqe *next_sqe();
+  bool submit();
+  bool arm_accept();
+  bool arm_recv(uint32_t session);
+  void idle_kick();
+  void publish_buffers() noexcept;
+
+  inline void recycle(uint16_t bid) noexcept {
+    io_uring_buf &b = buf_ring_[buf_tail_ & (opts_.buffers - 1)];
+    b.addr = reinterpret_cast<uint64_t>(buffers_ +
+                                        size_t(bid) * opts_.buffer_size);
+    b.len = opts_.buffer_size;
+    b.bid = bid;
+    buf_tail_++;
+  }
+
+public:
+  explicit UringIngress(UringOptions opts);
+  ~UringIngress();
+
+  UringIngress(const UringIngress &) = delete;
+  UringIngress &operator=(const UringIngress &) = delete;
+
+  // False if the kernel refused any part of the setup
+  bool ok() const noexcept { return ready_; }
+  uint64_t syscalls() const noexcept { return syscalls_; }
+
+  // Accepts connections on `listen_fd` until the ring is torn down
+  bool watch_accept(int listen_fd);
+
+  // Receives from `fd` on behalf of `session` until EOF or error; false
+  // (with nothing left watched) if the receive could not be armed
+  bool watch_recv(int fd, uint32_t session);
+
+  // Reaps completions into `handler`:
+  //   on_accept(int fd_or_negative_errno)
+  //   on_data(uint32_t session, const uint8_t *data, size_t len)
+  //   on_close(uint32_t session, int res)  res is 0 on EOF, else -errno
+  // Data buffers are recycled as soon as on_data returns. After on_close the
+  // session is no longer watched and its socket may be closed. Returns bytes
+  // delivered (0 if only accepts/closes completed), or -EAGAIN when nothing
+  // completed.
+  template <typename Handler> ssize_t poll(Handler &handler) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+      if (++idle_spins_ >= IDLE_SPINS) {
+        idle_spins_ = 0;
+        idle_kick();
+      }
+      return -EAGAIN;
+    }
+    idle_spins_ = 0;
+
+    ssize_t delivered = 0;
+    bool events = false;
+    for (; head != tail; head++) {
+      const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+      uint64_t kind = cqe.user_data >> 32;
+      auto session = static_cast<uint32_t>(cqe.user_data);
+      bool more = cqe.flags & IORING_CQE_F_MORE;
+
+      if (kind == KIND_ACCEPT) {
+        if (!more)
+          accept_armed_ = false;
+        handler.on_accept(cqe.res);
+        events = true;
+        continue;
+      }
+
+      if (cqe.res == -ENOBUFS) {
+        if (!more)
+          rearm_.push_back(session); // once buffers are back
+        continue;
+      }
+
+      if (cqe.res <= 0) {
+        // EOF or error ends the stream; multishot never continues past it
+        recv_fds_[session] = -1;
+        handler.on_close(session, cqe.res);
+        events = true;
+        continue;
+      }
+
+      uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+      handler.on_data(session, buffers_ + size_t(bid) * opts_.buffer_size,
+                      size_t(cqe.res));
+      recycle(bid);
+      delivered += cqe.res;
+      if (!more)
+        rearm_.push_back(session);
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    publish_buffers();
+
+    for (uint32_t s : rearm_) {
+      if (recv_fds_[s] >= 0)
+        arm_recv(s);
+    }
+    rearm_.clear();
+    if (!accept_armed_ && listen_fd_ >= 0)
+      arm_accept();
+    submit();
+
+    if (delivered > 0)
+      return delivered;
+    return events ? 0 : -EAGAIN;
+  }
+};
@@ -0,0 +1,150 @@
+#include "TSCClock.h"
+
+#include <cpuid.h>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+struct Anchor {
+  uint64_t tsc;
+  uint64_t ns; // CLOCK_MONOTONIC_RAW
+};
+
+// Where correct_drift() measures from; set once, by calibration
+Anchor anchor{};
+
+uint64_t raw_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return uint64_t(ts.tv_sec) * 1'000'000'000 + uint64_t(ts.tv_nsec);
+}
+
+// A TSC reading and a clock reading taken as close together as a few tries
+// allow: the pair whose two bracketing TSC reads are nearest wins
+Anchor sample() {
+  Anchor best{};
+  uint64_t best_gap = UINT64_MAX;
+  for (int i = 0; i < 5; i++) {
+    uint64_t before = __rdtsc();
+    uint64_t ns = raw_ns();
+    uint64_t after = __rdtsc();
+    if (after - before < best_gap) {
+      best_gap = after - before;
+      best = {before + (after - before) / 2, ns};
+    }
+  }
+  return best;
+}
+
+bool plausible(double hz) { return hz >= 1e8 && hz <= 1e10; }
+
+// The frequency the CPU, hypervisor or kernel reports, or 0
+double reported_hz(const char *&source) {
+  unsigned a, b, c, d;
+  unsigned max_leaf = __get_cpuid_max(0, nullptr);
+
+  if (max_leaf >= 0x15) {
+    __cpuid(0x15, a, b, c, d); // TSC / crystal ratio b/a, crystal hz in c
+    if (a && b && c) {
+      source = "cpuid 0x15";
+      return double(c) * b / a;
+    }
+    // No crystal frequency: the TSC runs at the processor base frequency
+    if (a && b && max_leaf >= 0x16) {
+      __cpuid(0x16, a, b, c, d);
+      if (a) {
+        source = "cpuid 0x16";
+        return double(a & 0xffff) * 1e6;
+      }
+    }
+  }
+
+  // VMware's timing leaf, also offered by KVM and others
+  __cpuid(1, a, b, c, d);
+  if (c & (1u << 31)) {
+    __cpuid(0x40000000, a, b, c, d);
+    if (a >= 0x40000010) {
+      __cpuid(0x40000010, a, b, c, d);
+      if (a) {
+        source = "hypervisor";
+        return double(a) * 1e3;
+      }
+    }
+  }
+
+  const char *sysfs = "/sys/devices/system/cpu/cpu0/tsc_freq_khz";
+  if (FILE *f = std::fopen(sysfs, "r")) {
+    unsigned long khz = 0;
+    bool read = std::fscanf(f, "%lu", &khz) == 1;
+    std::fclose(f);
+    if (read && khz) {
+      source = "tsc_freq_khz";
+      return double(khz) * 1e3;
+    }
+  }
+  return 0;
+}
+
+bool invariant_tsc() {
+  unsigned a, b, c, d;
+  if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007)
+    return false;
+  __cpuid(0x80000007, a, b, c, d);
+  return d & (1u << 8);
+}
+
+} // namespace
+
+const TscCalibration &TSCClock::shared() {
+  static const TscCalibration calibration = [] {
+    TscCalibration cal;
+    cal.invariant = invariant_tsc();
+    cal.hz = reported_hz(cal.source);
+    if (!plausible(cal.hz)) {
+      cal.hz = measure_hz(std::chrono::milliseconds(20));
+      cal.source = "measured";
+    }
+    anchor = sample();
+    mult_.store(mult_for(cal.hz), std::memory_order_relaxed);
+
+    cout << "TSC: " << cal.hz / 1e6 << " MHz (" << cal.source
+         << (cal.invariant ? ", invariant)" : ")") << '\n';
+    if (!cal.invariant)
+      std::cerr << "TSC: not invariant; latencies may be skewed across "
+                   "cores and power states\n";
+    return cal;
+  }();
+  return calibration;
+}
+
+double TSCClock::measure_hz(std::chrono::nanoseconds window) {
+  Anchor a = sample();
+  std::this_thread::sleep_for(window);
+  Anchor b = sample();
+  return double(b.tsc - a.tsc) * 1e9 / double(b.ns - a.ns);
+}
+
+double TSCClock::correct_drift() {
+  shared();
+  Anchor now = sample();
+  double hz = double(now.tsc - anchor.tsc) * 1e9 / double(now.ns - anchor.ns);
+  // Too short a baseline would be noisier than the frequency it replaces
+  if (now.ns - anchor.ns >= 100'000'000 && plausible(hz))
+    mult_.store(mult_for(hz), std::memory_order_relaxed);
+  return 1e9 * double(uint64_t{1} << SHIFT) /
+         double(mult_.load(std::memory_order_relaxed));
+}
+
+void run_tsc_drift_correction(std::chrono::milliseconds interval,
+                              const std::atomic<bool> &done) {
+  auto next = std::chrono::steady_clock::now() + interval;
+  while (!done.load(std::memory_order_acquire)) {
+    // Short naps, so shutdown is not held up by a whole interval
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (std::chrono::steady_clock::now() < next)
+      continue;
+    TSCClock::correct_drift();
+    next += interval;
+  }
+}
@@ -0,0 +1,198 @@
+#include "book_snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t WORDS = sizeof(Client::BookSnapshot) / sizeof(uint64_t);
+
+constexpr size_t segment_bytes(uint64_t slots) {
+  return sizeof(Client::SnapshotHeader) +
+         slots * sizeof(Client::BookSnapshot);
+}
+
+inline std::atomic_ref<uint64_t> word(uint64_t &w) noexcept {
+  return std::atomic_ref<uint64_t>(w);
+}
+
+// Empties a slot under its seqlock; seq keeps counting up, so a reader
+// that started before sees it move and retries
+void clear(Client::BookSnapshot &s) noexcept {
+  auto *w = reinterpret_cast<uint64_t *>(&s);
+  uint64_t seq = word(w[0]).load(std::memory_order_relaxed) | 1;
+  word(w[0]).store(seq, std::memory_order_relaxed); // odd: being written
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 1; i < WORDS; i++)
+    word(w[i]).store(0, std::memory_order_relaxed);
+  word(w[0]).store(seq + 1, std::memory_order_release);
+}
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const std::string &name, size_t slots)
+    : name_(name), slots_count_(std::min(slots, SNAPSHOT_SLOTS)) {
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror("[Snapshot] shm_open");
+    return;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) < 0) {
+    perror("[Snapshot] fstat");
+    close(fd);
+    return;
+  }
+  // Grown in place, never shrunk: pages a reader has mapped stay backed
+  size_t existing = static_cast<size_t>(st.st_size);
+  bytes_ = std::max(existing, segment_bytes(slots_count_));
+  if (bytes_ > existing && ftruncate(fd, bytes_) < 0) {
+    perror("[Snapshot] ftruncate");
+    close(fd);
+    return;
+  }
+  void *p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror("[Snapshot] mmap");
+    return;
+  }
+  base_ = p;
+
+  auto *header = static_cast<Client::SnapshotHeader *>(base_);
+  auto *slots_p = reinterpret_cast<Client::BookSnapshot *>(header + 1);
+  // Fresh pages are zero: every slot starts empty at seq 0. A reused
+  // segment still holds the last run's books; each slot is emptied as a
+  // publish would, so an attached reader sees it old or empty, never torn.
+  if (existing > sizeof(Client::SnapshotHeader)) {
+    size_t held = (existing - sizeof(Client::SnapshotHeader)) /
+                  sizeof(Client::BookSnapshot);
+    for (size_t i = 0; i < held; i++)
+      clear(slots_p[i]);
+  }
+  header->depth = SNAPSHOT_DEPTH;
+  word(header->slots).store(slots_count_, std::memory_order_relaxed);
+  header->version = Client::SNAPSHOT_VERSION;
+  // Readers check the magic last, so it goes in after the rest
+  word(header->magic).store(Client::SNAPSHOT_MAGIC, std::memory_order_release);
+  slots_ = slots_p;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  if (base_) {
+    munmap(base_, bytes_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+void SnapshotWriter::publish(InstrumentId instrument,
+                             const Orderbook &book) noexcept {
+  if (!slots_)
+    return;
+  if (instrument >= slots_count_) [[unlikely]] {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Client::BookSnapshot &s = slots_[instrument];
+
+  uint64_t seq = word(s.seq).load(std::memory_order_relaxed);
+  word(s.seq).store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  auto fill = [&](Side side, Client::SnapshotLevel *levels) {
+    size_t i = 0;
+    size_t n = book.top(side, SNAPSHOT_DEPTH, [&](const Level &lvl) {
+      word(levels[i].price).store(lvl.price, std::memory_order_relaxed);
+      word(levels[i].volume).store(lvl.volume, std::memory_order_relaxed);
+      word(levels[i].orders).store(lvl.size, std::memory_order_relaxed);
+      i++;
+    });
+    return n;
+  };
+  word(s.bid_count).store(fill(Side::Bid, s.bids), std::memory_order_relaxed);
+  word(s.ask_count).store(fill(Side::Ask, s.asks), std::memory_order_relaxed);
+  word(s.updates).store(s.updates + 1, std::memory_order_relaxed);
+
+  word(s.seq).store(seq + 2, std::memory_order_release);
+}
+
+void SnapshotWriter::dump() const noexcept {
+  std::printf("[Snapshot] %s: %zu slots, %lu publishes dropped for ids "
+              "past them\n",
+              name_.c_str(), slots_count_, dropped());
+}
+
+SnapshotReader::SnapshotReader(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("[Snapshot] shm_open");
+    return;
+  }
+  off_t size = lseek(fd, 0, SEEK_END);
+  if (size < static_cast<off_t>(sizeof(Client::SnapshotHeader))) {
+    std::fprintf(stderr, "[Snapshot] %s: segment too small\n", name.c_str());
+    close(fd);
+    return;
+  }
+  void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror("[Snapshot] mmap");
+    return;
+  }
+  base_ = p;
+  bytes_ = size;
+
+  auto *header = static_cast<Client::SnapshotHeader *>(base_);
+  if (word(header->magic).load(std::memory_order_acquire) !=
+          Client::SNAPSHOT_MAGIC ||
+      header->version != Client::SNAPSHOT_VERSION ||
+      header->depth != SNAPSHOT_DEPTH ||
+      segment_bytes(header->slots) > bytes_) {
+    std::fprintf(stderr, "[Snapshot] %s: not a version %lu book segment\n",
+                 name.c_str(), Client::SNAPSHOT_VERSION);
+    return;
+  }
+  slots_count_ = header->slots;
+  slots_ = reinterpret_cast<const Client::BookSnapshot *>(header + 1);
+}
+
+SnapshotReader::~SnapshotReader() {
+  if (base_)
+    munmap(base_, bytes_);
+}
+
+bool SnapshotReader::read(InstrumentId instrument,
+                          Client::BookSnapshot &out) noexcept {
+  if (!slots_ || instrument >= slots_count_)
+    return false;
+
+  // The mapping is read-only; atomic_ref needs a non-const object, but
+  // loads never write through it
+  auto *src = const_cast<uint64_t *>(
+      reinterpret_cast<const uint64_t *>(&slots_[instrument]));
+  auto *dst = reinterpret_cast<uint64_t *>(&out);
+
+  while (true) {
+    uint64_t before = word(src[0]).load(std::memory_order_acquire);
+    if (before & 1) {
+      retries_++;
+      _mm_pause();
+      continue;
+    }
+    for (size_t i = 1; i < WORDS; i++)
+      dst[i] = word(src[i]).load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (word(src[0]).load(std::memory_order_relaxed) == before) {
+      dst[0] = before;
+      return true;
+    }
+    retries_++;
+  }
+}
@@ -0,0 +1,444 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <map>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t HEADER = sizeof(Client::CheckpointHeader);
+constexpr int CHILD_NICE = 10;
+// Orders ahead of the one being restored whose index bucket is prefetched
+constexpr uint64_t PREFETCH_AHEAD = 16;
+
+std::string checkpoint_name(uint64_t generation, size_t shard) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "%06lu-%03zu.checkpoint", generation,
+                shard);
+  return name;
+}
+
+bool parse_name(const fs::path &path, uint64_t &generation) {
+  return path.extension() == ".checkpoint" &&
+         std::sscanf(path.filename().c_str(), "%lu-", &generation) == 1;
+}
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
+// Buffered writer over a raw descriptor; only write(2), so it may run in a
+// forked child
+class FileSink {
+  int fd_;
+  std::span<uint8_t> buffer_;
+  size_t used_{0};
+  bool ok_{true};
+
+public:
+  FileSink(int fd, std::span<uint8_t> buffer) : fd_(fd), buffer_(buffer) {}
+
+  template <typename T> void put(const T &record) {
+    if (used_ + sizeof(T) > buffer_.size())
+      flush();
+    std::memcpy(buffer_.data() + used_, &record, sizeof(T));
+    used_ += sizeof(T);
+  }
+
+  bool flush() {
+    for (size_t off = 0; ok_ && off < used_;) {
+      ssize_t r = ::write(fd_, buffer_.data() + off, used_ - off);
+      if (r < 0 && errno == EINTR)
+        continue;
+      if (r <= 0)
+        ok_ = false;
+      else
+        off += r;
+    }
+    used_ = 0;
+    return ok_;
+  }
+};
+
+void put_side(FileSink &out, const Orderbook &book, Side side) {
+  book.top(side, SIZE_MAX, [&](const Level &level) {
+    out.put(Client::CheckpointLevel{level.price, level.size, side, {}});
+    level.for_each([&](const Matching::Order &o) {
+      out.put(Client::CheckpointOrder{o.order_id, o.quantity,
+                                      o.quantity_remaining,
+                                      book.account_of(o)});
+    });
+  });
+}
+
+// A mapped checkpoint file
+struct Mapped {
+  const uint8_t *base{nullptr};
+  size_t bytes{0};
+
+  const Client::CheckpointHeader &header() const {
+    return *reinterpret_cast<const Client::CheckpointHeader *>(base);
+  }
+};
+
+bool map_file(const fs::path &path, Mapped &out) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  off_t size = lseek(fd, 0, SEEK_END);
+  void *p = size >= static_cast<off_t>(HEADER)
+                ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                       fd, 0)
+                : MAP_FAILED;
+  close(fd);
+  if (p == MAP_FAILED)
+    return false;
+  out = {static_cast<const uint8_t *>(p), static_cast<size_t>(size)};
+  return true;
+}
+
+// Walks the whole file before any of it is applied, so a torn or corrupt
+// file is rejected rather than half loaded
+bool well_formed(const Mapped &m) {
+  const Client::CheckpointHeader &h = m.header();
+  if (h.magic != Client::CHECKPOINT_MAGIC ||
+      h.version != Client::CHECKPOINT_VERSION || h.bytes != m.bytes ||
+      h.shard >= h.shards)
+    return false;
+
+  const uint8_t *p = m.base + HEADER;
+  const uint8_t *end = m.base + m.bytes;
+  uint64_t levels = 0, orders = 0;
+  for (uint64_t b = 0; b < h.books; b++) {
+    if (end - p < static_cast<ptrdiff_t>(sizeof(Client::CheckpointBook)))
+      return false;
+    auto *book = reinterpret_cast<const Client::CheckpointBook *>(p);
+    p += sizeof(*book);
+    uint64_t book_orders = 0;
+    for (uint64_t l = 0; l < book->levels; l++) {
+      if (end - p < static_cast<ptrdiff_t>(sizeof(Client::CheckpointLevel)))
+        return false;
+      auto *level = reinterpret_cast<const Client::CheckpointLevel *>(p);
+      p += sizeof(*level);
+      if (level->orders == 0 ||
+          (level->side != Side::Bid && level->side != Side::Ask) ||
+          static_cast<uint64_t>(end - p) / sizeof(Client::CheckpointOrder) <
+              level->orders)
+        return false;
+      p += level->orders * sizeof(Client::CheckpointOrder);
+      book_orders += level->orders;
+    }
+    if (book_orders != book->orders)
+      return false;
+    levels += book->levels;
+    orders += book_orders;
+  }
+  return p == end && levels == h.levels && orders == h.orders;
+}
+
+void apply(const Mapped &m,
+           const std::function<BookRegistry &(InstrumentId)> &books_for,
+           CheckpointRestoreStats &stats) {
+  const Client::CheckpointHeader &h = m.header();
+  const uint8_t *p = m.base + HEADER;
+  for (uint64_t b = 0; b < h.books; b++) {
+    auto *record = reinterpret_cast<const Client::CheckpointBook *>(p);
+    p += sizeof(*record);
+
+    BookRegistry::Book &book =
+        books_for(record->instrument).get(record->instrument);
+    book.next_order_id = std::max(book.next_order_id, record->next_order_id);
+    book.book.reserve(record->orders);
+
+    // Index inserts land in random buckets; prefetching them a few orders
+    // ahead keeps several misses in flight. Levels are laid out back to
+    // back, so the order ids ahead are found by skipping level records.
+    const uint8_t *ahead = p;
+    uint64_t ahead_left = 0; // orders left in the level `ahead` points into
+    uint64_t lead = 0;
+    auto advance = [&] {
+      if (ahead_left == 0) {
+        auto *level = reinterpret_cast<const Client::CheckpointLevel *>(ahead);
+        ahead_left = level->orders;
+        ahead += sizeof(*level);
+      }
+      auto *o = reinterpret_cast<const Client::CheckpointOrder *>(ahead);
+      book.book.prefetch_order(o->order_id);
+      ahead += sizeof(*o);
+      ahead_left--;
+      lead++;
+    };
+    for (uint64_t i = 0; i < PREFETCH_AHEAD && lead < record->orders; i++)
+      advance();
+
+    for (uint64_t l = 0; l < record->levels; l++) {
+      auto *level = reinterpret_cast<const Client::CheckpointLevel *>(p);
+      p += sizeof(*level);
+      auto *orders = reinterpret_cast<const Client::CheckpointOrder *>(p);
+      p += level->orders * sizeof(Client::CheckpointOrder);
+
+      Level &target = *book.book.restore_level(level->side, level->price);
+      for (uint32_t i = 0; i < level->orders; i++) {
+        if (lead < record->orders)
+          advance();
+        const Client::CheckpointOrder &o = orders[i];
+        if (!book.book.restore_order(target, o.order_id, o.quantity,
+                                     o.remaining, o.account_id))
+          stats.duplicates++;
+      }
+    }
+    stats.books++;
+    stats.levels += record->levels;
+    stats.orders += record->orders;
+  }
+}
+
+} // namespace
+
+bool write_checkpoint(const char *path, const char *tmp,
+                      Client::CheckpointHeader header,
+                      const BookRegistry &books, std::span<uint8_t> buffer) {
+  header.books = header.levels = header.orders = 0;
+  books.for_each([&](InstrumentId, const BookRegistry::Book &b) {
+    header.books++;
+    header.levels += b.book.active_levels();
+    header.orders += b.book.resting_orders();
+  });
+  header.bytes = HEADER + header.books * sizeof(Client::CheckpointBook) +
+                 header.levels * sizeof(Client::CheckpointLevel) +
+                 header.orders * sizeof(Client::CheckpointOrder);
+
+  int fd = ::open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+
+  FileSink out(fd, buffer);
+  out.put(header);
+  books.for_each([&](InstrumentId instrument, const BookRegistry::Book &b) {
+    out.put(Client::CheckpointBook{b.next_order_id, b.book.active_levels(),
+                                   b.book.resting_orders(), instrument, {}});
+    put_side(out, b.book, Side::Bid);
+    put_side(out, b.book, Side::Ask);
+  });
+
+  bool ok = out.flush() && ::fsync(fd) == 0;
+  ok = ::close(fd) == 0 && ok;
+  if (!ok || ::rename(tmp, path) != 0) {
+    ::unlink(tmp);
+    return false;
+  }
+  return true;
+}
+
+Checkpointer::Checkpointer(const std::string &dir, uint64_t generation,
+                           size_t shard, size_t shards,
+                           CheckpointOptions opts)
+    : opts_(opts), buffer_(std::make_unique<uint8_t[]>(BUFFER_BYTES)),
+      next_at_(0) {
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  path_ = (fs::path(dir) / checkpoint_name(generation, shard)).string();
+  tmp_ = path_ + ".tmp";
+
+  header_.magic = Client::CHECKPOINT_MAGIC;
+  header_.version = Client::CHECKPOINT_VERSION;
+  header_.generation = generation;
+  header_.shard = shard;
+  header_.shards = shards;
+
+  CPU_ZERO(&affinity_);
+  if (sched_getaffinity(0, sizeof(affinity_), &affinity_) != 0)
+    CPU_ZERO(&affinity_);
+}
+
+Checkpointer::~Checkpointer() { reap(true); }
+
+void Checkpointer::reap(bool wait) {
+  if (child_ <= 0)
+    return;
+  int status = 0;
+  pid_t r;
+  do {
+    r = waitpid(child_, &status, wait ? 0 : WNOHANG);
+  } while (r < 0 && errno == EINTR);
+  if (r == 0)
+    return; // still writing
+
+  if (r == child_ && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    written_++;
+    last_write_ns_ = elapsed_ns(child_start_);
+  } else {
+    failed_++;
+  }
+  child_ = -1;
+}
+
+bool Checkpointer::cow_headroom() const noexcept {
+  size_t needed = opts_.arena ? opts_.arena->cow_pages() : 0;
+  if (needed == 0)
+    return true;
+  long available = free_huge_pages();
+  return available < 0 || size_t(available) >= needed; // unknown: try
+}
+
+void Checkpointer::poll(const BookRegistry &books, uint64_t processed,
+                        uint64_t journal_records) {
+  reap(false);
+  if (opts_.every == 0 || processed < next_at_ || child_ > 0)
+    return;
+  if (!cow_headroom()) {
+    skipped_++;
+    next_at_ = processed + opts_.every;
+    return;
+  }
+
+  Client::CheckpointHeader header = header_;
+  header.journal_records = journal_records;
+
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Child: a frozen copy of the books. Only syscalls from here on; other
+    // threads' locks were copied in whatever state they were in. A matcher
+    // on SCHED_FIFO would pass its class on; the child drops it.
+    sched_param normal{};
+    sched_setscheduler(0, SCHED_OTHER, &normal);
+    sched_setaffinity(0, sizeof(affinity_), &affinity_);
+    setpriority(PRIO_PROCESS, 0, CHILD_NICE);
+    bool ok = write_checkpoint(path_.c_str(), tmp_.c_str(), header, books,
+                               {buffer_.get(), BUFFER_BYTES});
+    _exit(ok ? 0 : 1);
+  }
+
+  uint64_t ns = elapsed_ns(start);
+  next_at_ = processed + opts_.every;
+  if (pid < 0) {
+    failed_++;
+    return;
+  }
+  child_ = pid;
+  child_start_ = start;
+  forks_++;
+  fork_ns_total_ += ns;
+  fork_ns_max_ = std::max(fork_ns_max_, ns);
+}
+
+bool Checkpointer::write(const BookRegistry &books,
+                         uint64_t journal_records) {
+  reap(true);
+  Client::CheckpointHeader header = header_;
+  header.journal_records = journal_records;
+
+  auto start = std::chrono::steady_clock::now();
+  bool ok = write_checkpoint(path_.c_str(), tmp_.c_str(), header, books,
+                             {buffer_.get(), BUFFER_BYTES});
+  if (!ok) {
+    perror("Checkpoint write");
+    failed_++;
+    return false;
+  }
+  written_++;
+  last_write_ns_ = elapsed_ns(start);
+  last_orders_ = 0;
+  books.for_each([&](InstrumentId, const BookRegistry::Book &b) {
+    last_orders_ += b.book.resting_orders();
+  });
+  return true;
+}
+
+void Checkpointer::dump() const noexcept {
+  std::printf("[Checkpoint %lu] written=%lu failed=%lu forks=%lu "
+              "skipped=%lu fork_stall_avg_us=%.1f fork_stall_max_us=%.1f "
+              "last_write_ms=%.1f final_orders=%lu -> %s\n",
+              header_.shard, written_, failed_, forks_, skipped_,
+              forks_ ? fork_ns_total_ / 1e3 / forks_ : 0.0,
+              fork_ns_max_ / 1e3, last_write_ns_ / 1e6, last_orders_,
+              path_.c_str());
+}
+
+CheckpointRestoreStats
+restore_checkpoints(
+    const std::string &dir,
+    const std::function<BookRegistry &(InstrumentId)> &books_for,
+    JournalPosition &from) {
+  auto t0 = std::chrono::steady_clock::now();
+
+  // Every file per generation, newest generation first
+  std::map<uint64_t, std::vector<fs::path>, std::greater<>> sets;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    uint64_t generation = 0;
+    if (parse_name(entry.path(), generation))
+      sets[generation].push_back(entry.path());
+  }
+
+  CheckpointRestoreStats stats;
+  for (auto &[generation, paths] : sets) {
+    std::vector<Mapped> files;
+    std::vector<bool> seen;
+    bool usable = true;
+    for (const fs::path &path : paths) {
+      Mapped m;
+      if (!map_file(path, m))
+        continue;
+      files.push_back(m);
+      const Client::CheckpointHeader &h = m.header();
+      if (!well_formed(m) || h.generation != generation ||
+          (!seen.empty() && h.shards != seen.size()) ||
+          (!seen.empty() && seen[h.shard])) {
+        usable = false;
+        break;
+      }
+      if (seen.empty())
+        seen.assign(h.shards, false);
+      seen[h.shard] = true;
+    }
+    // A set is only whole if every shard of that run wrote its file
+    usable = usable && !seen.empty() &&
+             std::all_of(seen.begin(), seen.end(), [](bool s) { return s; });
+
+    if (usable) {
+      from.generation = generation;
+      from.applied.assign(seen.size(), 0);
+      for (const Mapped &m : files) {
+        apply(m, books_for, stats);
+        from.applied[m.header().shard] = m.header().journal_records;
+      }
+      stats.generation = generation;
+      stats.files = files.size();
+    }
+    for (const Mapped &m : files)
+      munmap(const_cast<uint8_t *>(m.base), m.bytes);
+    if (usable)
+      break;
+  }
+
+  stats.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+          .count();
+  return stats;
+}
+
+uint64_t next_checkpoint_generation(const std::string &dir) {
+  uint64_t last = 0;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    uint64_t generation = 0;
+    if (parse_name(entry.path(), generation))
+      last = std::max(last, generation);
+  }
+  return last + 1;
+}
@@ -0,0 +1,177 @@
+#include "config.h"
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+namespace {
+
+// Matches "--name=<int>" and stores the value; false if `arg` is another
+// option. A malformed number is reported as an unknown option.
+bool parse_int(std::string_view arg, std::string_view prefix, long &out) {
+  if (arg.substr(0, prefix.size()) != prefix)
+    return false;
+  std::string_view digits = arg.substr(prefix.size());
+  auto [end, ec] =
+      std::from_chars(digits.data(), digits.data() + digits.size(), out);
+  return ec == std::errc{} && end == digits.data() + digits.size();
+}
+
+// Matches "--name=<host>:<port>"; false if `arg` is another option or the
+// port is malformed
+bool parse_endpoint(std::string_view arg, std::string_view prefix,
+                    std::string &host, uint16_t &port) {
+  if (arg.substr(0, prefix.size()) != prefix)
+    return false;
+  std::string_view endpoint = arg.substr(prefix.size());
+  size_t colon = endpoint.rfind(':');
+  if (colon == std::string_view::npos || colon == 0)
+    return false;
+  long value = 0;
+  if (!parse_int(endpoint, endpoint.substr(0, colon + 1), value) ||
+      value < 1 || value > 65535)
+    return false;
+  host = std::string(endpoint.substr(0, colon));
+  port = static_cast<uint16_t>(value);
+  return true;
+}
+
+[[noreturn]] void usage(const char *prog) {
+  std::fprintf(stderr,
+               "Usage: %s [options]\n"
+               "  --ingress=read|uring  network ingress backend (default: "
+               "read)\n"
+               "  --sqpoll              io_uring: kernel-side SQ polling "
+               "thread\n"
+               "  --exit-when-idle      stop after the last session "
+               "disconnects\n"
+               "  --shards=N            matching threads (default: 1)\n"
+               "  --first-core=K        pin shard i to core K+i (default: "
+               "-1, unpinned)\n"
+               "  --net-core=K          pin the network thread to core K\n"
+               "  --fifo=PRIO           SCHED_FIFO 1-99 for pinned network "
+               "and shard threads\n"
+               "  --mlock               lock all memory with mlockall()\n"
+               "  --arena-mb=N          huge page arena for rings and pools, "
+               "0 to disable (default: 0)\n"
+               "  --exec-reports        send execution reports back to "
+               "sessions\n"
+               "  --no-exec-reports     do not send them (the default)\n"
+               "  --depth-feed=IP:PORT  publish L2 depth updates over UDP\n"
+               "  --snapshot=/NAME      publish top-of-book to POSIX shared "
+               "memory\n"
+               "  --snapshot-slots=N    instrument ids with a snapshot slot "
+               "(default: 65536)\n"
+               "  --journal=DIR         journal input to DIR, replaying it "
+               "first\n"
+               "  --journal-sync-ms=N   msync cadence (default: 10)\n"
+               "  --journal-segment-mb=N  segment file size (default: 64)\n"
+               "  --checkpoint=DIR      checkpoint the books to DIR, "
+               "restoring first\n"
+               "  --checkpoint-every=N  background checkpoint every N orders "
+               "per shard\n"
+               "  --replay=FILE         match a file of orders, no sockets\n"
+               "  --replay-direct       replay on the matcher thread, "
+               "bypassing the ring\n"
+               "  --latency-csv=FILE    write the latency histograms at "
+               "exit\n"
+               "  --stats-interval-ms=N live stats cadence, 0 to disable "
+               "(default: 0)\n"
+               "  --stats=/NAME         publish live stats to POSIX shared "
+               "memory\n",
+               prog);
+  std::exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+EngineConfig parse_args(int argc, char **argv) {
+  EngineConfig config;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg(argv[i]);
+    long value = 0;
+
+    if (arg == "--ingress=read") {
+      config.ingress = IngressBackend::Read;
+    } else if (arg == "--ingress=uring") {
+      config.ingress = IngressBackend::Uring;
+    } else if (arg == "--sqpoll") {
+      config.sqpoll = true;
+    } else if (arg == "--exit-when-idle") {
+      config.exit_when_idle = true;
+    } else if (arg == "--exec-reports") {
+      config.exec_reports = true;
+    } else if (arg == "--no-exec-reports") {
+      config.exec_reports = false;
+    } else if (parse_endpoint(arg, "--depth-feed=", config.depth_host,
+                              config.depth_port)) {
+      // stored by parse_endpoint
+    } else if (arg.starts_with("--snapshot=/") && arg.size() > 12) {
+      config.snapshot = std::string(arg.substr(11));
+    } else if (parse_int(arg, "--snapshot-slots=", value) && value >= 1 &&
+               value <= 1 << 16) {
+      config.snapshot_slots = static_cast<unsigned>(value);
+    } else if (arg.starts_with("--journal=") && arg.size() > 10) {
+      config.journal = std::string(arg.substr(10));
+    } else if (parse_int(arg, "--journal-sync-ms=", value) && value >= 1 &&
+               value <= 60'000) {
+      config.journal_sync_ms = static_cast<unsigned>(value);
+    } else if (parse_int(arg, "--journal-segment-mb=", value) && value >= 1 &&
+               value <= 4096) {
+      config.journal_segment_mb = static_cast<unsigned>(value);
+    } else if (arg.starts_with("--replay=") && arg.size() > 9) {
+      config.replay = std::string(arg.substr(9));
+    } else if (arg == "--replay" && i + 1 < argc) {
+      config.replay = argv[++i];
+    } else if (arg == "--replay-direct") {
+      config.replay_direct = true;
+    } else if (arg.starts_with("--latency-csv=") && arg.size() > 14) {
+      config.latency_csv = std::string(arg.substr(14));
+    } else if (parse_int(arg, "--stats-interval-ms=", value) && value >= 0 &&
+               value <= 3'600'000) {
+      config.stats_interval_ms = static_cast<unsigned>(value);
+    } else if (arg.starts_with("--stats=/") && arg.size() > 9) {
+      config.stats = std::string(arg.substr(8));
+    } else if (arg.starts_with("--checkpoint=") && arg.size() > 13) {
+      config.checkpoint = std::string(arg.substr(13));
+    } else if (parse_int(arg, "--checkpoint-every=", value) && value >= 0) {
+      config.checkpoint_every = static_cast<uint64_t>(value);
+    } else if (parse_int(arg, "--shards=", value) && value >= 1 &&
+               value <= 256) {
+      config.shards = static_cast<unsigned>(value);
+    } else if (parse_int(arg, "--first-core=", value) && value >= -1) {
+      config.first_core = static_cast<int>(value);
+    } else if (parse_int(arg, "--net-core=", value) && value >= -1) {
+      config.net_core = static_cast<int>(value);
+    } else if (parse_int(arg, "--fifo=", value) && value >= 1 &&
+               value <= 99) {
+      config.fifo_priority = static_cast<int>(value);
+    } else if (arg == "--mlock") {
+      config.mlock = true;
+    } else if (parse_int(arg, "--arena-mb=", value) && value >= 0 &&
+               value <= 1 << 20) {
+      config.arena_mb = static_cast<unsigned>(value);
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      usage(argv[0]);
+    }
+  }
+
+  if (config.replay_direct && (config.replay.empty() || config.shards != 1)) {
+    std::fprintf(stderr, "--replay-direct needs --replay and one shard\n");
+    usage(argv[0]);
+  }
+  if (config.net_core >= 0 && config.first_core >= 0 &&
+      config.net_core >= config.first_core &&
+      config.net_core < config.first_core + static_cast<int>(config.shards)) {
+    std::fprintf(stderr, "--net-core=%d is one of the shard cores\n",
+                 config.net_core);
+    usage(argv[0]);
+  }
+  if (!config.stats.empty() && config.stats_interval_ms == 0) {
+    std::fprintf(stderr, "--stats needs a non-zero --stats-interval-ms\n");
+    usage(argv[0]);
+  }
+  return config;
+}
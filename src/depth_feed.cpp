@@ -0,0 +1,45 @@
+#include "depth_feed.h"
+#include "orderbook.h"
+
+#include <algorithm>
+#include <emmintrin.h>
+
+size_t DepthTracker::flush() {
+  if (changes_.empty())
+    return 0;
+
+  out_.clear();
+  for (const Change &c : changes_) {
+    Level *level = c.book->level_at(c.side, c.price);
+    if (level == nullptr) {
+      // Emptied this batch. Updates carry absolute state, so the rare repeat
+      // (a level emptied, refilled and emptied again) is harmless.
+      out_.push_back({c.instrument, c.side, 0, 0, c.price, 0});
+      continue;
+    }
+    if (!level->dirty)
+      continue; // listed twice: freed and re-created at the same price
+    level->dirty = false;
+    out_.push_back(
+        {c.instrument, c.side, 0, level->size, c.price, level->volume});
+  }
+  changes_.clear();
+  out_.back().flags = Client::DEPTH_END_OF_BATCH;
+
+  bool stalled = false;
+  for (size_t sent = 0; sent < out_.size();) {
+    auto region = ring_.claim(out_.size() - sent);
+    if (region.empty()) {
+      stalled = true;
+      _mm_pause();
+      continue;
+    }
+    std::copy_n(out_.begin() + sent, region.size(), region.begin());
+    ring_.publish(region.size());
+    sent += region.size();
+  }
+
+  telemetry_.record_depth(events_, out_.size(), stalled);
+  events_ = 0;
+  return out_.size();
+}
@@ -0,0 +1,106 @@
+#include "depth_publisher.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <emmintrin.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <utility>
+
+int open_depth_feed(const std::string &host, uint16_t port) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+    std::fprintf(stderr, "[Depth] bad feed address: %s\n", host.c_str());
+    return -1;
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("[Depth] socket");
+    return -1;
+  }
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    perror("[Depth] connect");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+DepthPublisher::DepthPublisher(std::vector<DepthQueue *> rings, int fd)
+    : rings_(std::move(rings)), seq_(rings_.size(), 0), fd_(fd),
+      headers_(MAX_DATAGRAMS), iov_(MAX_DATAGRAMS * 2), msgs_(MAX_DATAGRAMS) {}
+
+DepthPublisher::~DepthPublisher() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+void DepthPublisher::publish(size_t shard, const Client::DepthUpdate *first,
+                             size_t n) {
+  size_t count = 0;
+  size_t packed = 0;
+  for (; packed < n && count < MAX_DATAGRAMS; count++) {
+    size_t take = std::min(n - packed, UPDATES_PER_DATAGRAM);
+    headers_[count] = {seq_[shard]++, static_cast<uint16_t>(shard),
+                       static_cast<uint16_t>(take), 0};
+    iov_[2 * count] = {&headers_[count], sizeof(Client::DepthPacketHeader)};
+    iov_[2 * count + 1] = {const_cast<Client::DepthUpdate *>(first + packed),
+                           take * sizeof(Client::DepthUpdate)};
+    msgs_[count] = {};
+    msgs_[count].msg_hdr.msg_iov = &iov_[2 * count];
+    msgs_[count].msg_hdr.msg_iovlen = 2;
+    packed += take;
+  }
+
+  // Datagrams are never retried: a receiver that misses one sees the seq
+  // gap and resyncs, which is cheaper than stalling every other receiver
+  for (size_t off = 0; off < count;) {
+    int r = sendmmsg(fd_, msgs_.data() + off, count - off, MSG_DONTWAIT);
+    syscalls_++;
+    if (r <= 0) {
+      dropped_++;
+      off++; // skip the datagram the kernel refused
+      continue;
+    }
+    off += r;
+    datagrams_ += r;
+  }
+  updates_ += packed;
+}
+
+void DepthPublisher::run(const std::atomic<bool> &done) {
+  while (true) {
+    size_t total = 0;
+    for (size_t r = 0; r < rings_.size(); r++) {
+      auto batch = rings_[r]->peek(PUBLISH_BATCH);
+      if (batch.empty())
+        continue;
+      publish(r, batch.data(), batch.size());
+      rings_[r]->consume(batch.size());
+      total += batch.size();
+    }
+    if (total > 0)
+      continue;
+
+    if (done.load(std::memory_order_acquire)) {
+      bool drained = std::all_of(rings_.begin(), rings_.end(), [](auto *q) {
+        return q->peek(1).empty();
+      });
+      if (drained)
+        break;
+    }
+    _mm_pause();
+  }
+}
+
+void DepthPublisher::dump() const noexcept {
+  std::printf("[Depth Feed] updates=%lu datagrams=%lu syscalls=%lu "
+              "(%.1f updates per syscall) dropped=%lu\n",
+              updates_, datagrams_, syscalls_,
+              syscalls_ ? double(updates_) / syscalls_ : 0.0, dropped_);
+}
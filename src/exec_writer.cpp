@@ -0,0 +1,259 @@
+#include "exec_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <span>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+constexpr size_t REPORT = sizeof(Client::ExecReport);
+constexpr int SEND_FLAGS = MSG_NOSIGNAL | MSG_DONTWAIT;
+} // namespace
+
+ExecWriter::ExecWriter(std::vector<ExecQueue *> rings)
+    : rings_(std::move(rings)) {}
+
+ExecWriter::~ExecWriter() {
+  apply_control();
+  for (auto &[tag, conn] : conns_)
+    ::close(conn.fd);
+}
+
+void ExecWriter::open(uint32_t tag, int fd) {
+  int own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (own < 0) {
+    perror("ExecWriter dup");
+    return;
+  }
+  while (!control_.enqueue({tag, own}))
+    _mm_pause();
+}
+
+void ExecWriter::close(uint32_t tag) {
+  while (!control_.enqueue({tag, -1}))
+    _mm_pause();
+}
+
+void ExecWriter::apply_control() {
+  while (auto c = control_.dequeue()) {
+    if (c->fd >= 0) {
+      conns_.emplace(c->tag, Conn{c->fd, false, {}, {}, {}});
+      continue;
+    }
+    auto it = conns_.find(c->tag);
+    if (it != conns_.end())
+      it->second.close_at = std::chrono::steady_clock::now() + LINGER;
+  }
+}
+
+void ExecWriter::reap(std::chrono::steady_clock::time_point now) {
+  for (auto it = conns_.begin(); it != conns_.end();) {
+    Conn &conn = it->second;
+    bool closing = conn.close_at.time_since_epoch().count() != 0;
+    if (!closing || now < conn.close_at) {
+      ++it;
+      continue;
+    }
+    dropped_ += conn.backlog.size() / REPORT;
+    ::close(conn.fd);
+    it = conns_.erase(it);
+  }
+}
+
+void ExecWriter::enqueue_run(uint32_t tag, const Client::ExecReport *first,
+                             size_t n) {
+  auto it = conns_.find(tag);
+  if (it == conns_.end() || it->second.dead) {
+    dropped_ += n; // session already gone
+    return;
+  }
+  Conn &conn = it->second;
+  if (conn.iov.empty())
+    dirty_.push_back(&conn);
+  conn.iov.push_back({const_cast<Client::ExecReport *>(first), n * REPORT});
+}
+
+void ExecWriter::buffer(Conn &conn, const iovec *iov, size_t n, size_t skip) {
+  size_t total = 0;
+  for (size_t i = 0; i < n; i++)
+    total += iov[i].iov_len;
+  total -= skip;
+
+  // Always finish a report the socket took part of, then keep whole
+  // reports while the backlog has room
+  size_t head = (REPORT - skip % REPORT) % REPORT;
+  size_t room = MAX_BACKLOG > conn.backlog.size()
+                    ? MAX_BACKLOG - conn.backlog.size()
+                    : 0;
+  size_t keep = std::min(total, head + (room / REPORT) * REPORT);
+  dropped_ += (total - keep) / REPORT;
+
+  for (size_t i = 0; i < n && keep > 0; i++) {
+    auto *p = static_cast<const uint8_t *>(iov[i].iov_base);
+    size_t len = iov[i].iov_len;
+    if (skip >= len) {
+      skip -= len;
+      continue;
+    }
+    size_t take = std::min(len - skip, keep);
+    conn.backlog.insert(conn.backlog.end(), p + skip, p + skip + take);
+    keep -= take;
+    skip = 0;
+  }
+}
+
+void ExecWriter::release(Conn &conn) {
+  // The peer is gone; wait for the network thread's close() to free it
+  conn.dead = true;
+  dropped_ += conn.backlog.size() / REPORT;
+  conn.backlog.clear();
+}
+
+void ExecWriter::send_backlog(Conn &conn) {
+  ssize_t r =
+      ::send(conn.fd, conn.backlog.data(), conn.backlog.size(), SEND_FLAGS);
+  syscalls_++;
+  if (r > 0) {
+    bytes_ += r;
+    conn.backlog.erase(conn.backlog.begin(), conn.backlog.begin() + r);
+  } else if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    release(conn);
+  }
+}
+
+void ExecWriter::flush(Conn &conn) {
+  if (!conn.backlog.empty()) {
+    // Keep ordering: queue behind what the socket already refused
+    buffer(conn, conn.iov.data(), conn.iov.size(), 0);
+    conn.iov.clear();
+    send_backlog(conn);
+    return;
+  }
+
+  for (size_t off = 0; off < conn.iov.size();) {
+    size_t count = std::min<size_t>(conn.iov.size() - off, IOV_MAX);
+    size_t want = 0;
+    for (size_t i = off; i < off + count; i++)
+      want += conn.iov[i].iov_len;
+
+    msghdr msg{};
+    msg.msg_iov = conn.iov.data() + off;
+    msg.msg_iovlen = count;
+    ssize_t r = ::sendmsg(conn.fd, &msg, SEND_FLAGS);
+    syscalls_++;
+
+    if (r < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        buffer(conn, conn.iov.data() + off, conn.iov.size() - off, 0);
+      } else {
+        for (size_t i = off; i < conn.iov.size(); i++)
+          dropped_ += conn.iov[i].iov_len / REPORT;
+        release(conn);
+      }
+      break;
+    }
+
+    bytes_ += r;
+    if (static_cast<size_t>(r) < want) {
+      buffer(conn, conn.iov.data() + off, conn.iov.size() - off, r);
+      break;
+    }
+    off += count;
+  }
+  conn.iov.clear();
+}
+
+void ExecWriter::run(const std::atomic<bool> &done) {
+  std::vector<std::span<const Client::ExecReport>> batches(rings_.size());
+  unsigned idle_spins = 0;
+  bool lingering = false;
+  std::chrono::steady_clock::time_point linger_until;
+
+  while (true) {
+    apply_control();
+
+    size_t total = 0;
+    for (size_t r = 0; r < rings_.size(); r++) {
+      auto batch = rings_[r]->peek(WRITE_BATCH);
+      batches[r] = batch;
+      total += batch.size();
+
+      // Consecutive reports for one session become one iovec
+      for (size_t i = 0; i < batch.size();) {
+        size_t j = i + 1;
+        while (j < batch.size() && batch[j].session == batch[i].session)
+          j++;
+        enqueue_run(batch[i].session, &batch[i], j - i);
+        i = j;
+      }
+    }
+
+    for (Conn *conn : dirty_)
+      flush(*conn);
+    dirty_.clear();
+
+    // Ring memory is only released once every iovec pointing into it has
+    // been sent or copied to a backlog
+    for (size_t r = 0; r < rings_.size(); r++)
+      rings_[r]->consume(batches[r].size());
+
+    if (total > 0) {
+      idle_spins = 0;
+      continue;
+    }
+
+    // A stalled client is retried now and then, not on every idle spin
+    if (++idle_spins >= BACKLOG_RETRY_SPINS) {
+      idle_spins = 0;
+      for (auto &[tag, conn] : conns_) {
+        if (!conn.backlog.empty() && !conn.dead)
+          send_backlog(conn);
+      }
+      reap(std::chrono::steady_clock::now());
+    }
+
+    if (done.load(std::memory_order_acquire)) {
+      bool drained = std::all_of(rings_.begin(), rings_.end(), [](auto *q) {
+        return q->peek(1).empty();
+      });
+      if (drained) {
+        // Give slow clients a bounded grace period for their backlog
+        auto now = std::chrono::steady_clock::now();
+        if (!lingering) {
+          lingering = true;
+          linger_until = now + LINGER;
+        }
+        if (!backlogged() || now >= linger_until)
+          break;
+      }
+    }
+    _mm_pause();
+  }
+
+  for (auto &[tag, conn] : conns_) {
+    dropped_ += conn.backlog.size() / REPORT;
+    conn.backlog.clear();
+  }
+}
+
+bool ExecWriter::backlogged() const noexcept {
+  return std::any_of(conns_.begin(), conns_.end(), [](const auto &c) {
+    return !c.second.backlog.empty() && !c.second.dead;
+  });
+}
+
+void ExecWriter::dump() const noexcept {
+  uint64_t reports = bytes_ / REPORT;
+  std::printf("[Egress] reports=%lu bytes=%lu syscalls=%lu (%.1f reports per "
+              "syscall) dropped=%lu\n",
+              reports, bytes_, syscalls_,
+              syscalls_ ? double(reports) / syscalls_ : 0.0, dropped_);
+}
@@ -0,0 +1,146 @@
+#include "huge_arena.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const char *to_string(ArenaBacking backing) noexcept {
+  switch (backing) {
+  case ArenaBacking::None:
+    return "none";
+  case ArenaBacking::HugeTLB:
+    return "hugetlb";
+  case ArenaBacking::THP:
+    return "thp";
+  case ArenaBacking::Small:
+    return "4k pages";
+  }
+  return "?";
+}
+
+namespace {
+
+// The value of the `key` line in a /proc/meminfo image, or -1
+long meminfo_field(const char *text, const char *key) {
+  size_t len = std::strlen(key);
+  for (const char *line = text; *line;) {
+    if (std::strncmp(line, key, len) == 0 && line[len] == ':')
+      return std::strtol(line + len + 1, nullptr, 10);
+    const char *next = std::strchr(line, '\n');
+    if (!next)
+      break;
+    line = next + 1;
+  }
+  return -1;
+}
+
+// An anonymous mapping of `bytes` starting on a huge page boundary: maps one
+// huge page extra and trims the ends, so THP can back the range from its
+// first byte
+void *map_aligned(size_t bytes) {
+  size_t padded = bytes + HugeArena::HUGE_PAGE;
+  void *p = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return nullptr;
+
+  auto start = reinterpret_cast<uintptr_t>(p);
+  uintptr_t aligned =
+      (start + HugeArena::HUGE_PAGE - 1) & ~(HugeArena::HUGE_PAGE - 1);
+  if (aligned > start)
+    munmap(p, aligned - start);
+  size_t tail = start + padded - (aligned + bytes);
+  if (tail > 0)
+    munmap(reinterpret_cast<void *>(aligned + bytes), tail);
+  return reinterpret_cast<void *>(aligned);
+}
+
+} // namespace
+
+long free_huge_pages(const char *meminfo) noexcept {
+  int fd = ::open(meminfo, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  char text[8192];
+  size_t len = 0;
+  ssize_t n;
+  while (len < sizeof(text) - 1 &&
+         (n = ::read(fd, text + len, sizeof(text) - 1 - len)) > 0)
+    len += size_t(n);
+  ::close(fd);
+  text[len] = '\0';
+
+  long free = meminfo_field(text, "HugePages_Free");
+  long reserved = meminfo_field(text, "HugePages_Rsvd");
+  if (free < 0 || reserved < 0)
+    return -1;
+  return free > reserved ? free - reserved : 0;
+}
+
+HugeArena::HugeArena(size_t bytes) {
+  if (bytes == 0)
+    return;
+  size_t rounded = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+  auto started = std::chrono::steady_clock::now();
+
+  // Reserved huge pages, populated by the kernel; fails unless the admin
+  // set aside enough of them (vm.nr_hugepages)
+  void *p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1,
+                 0);
+  if (p != MAP_FAILED) {
+    backing_ = ArenaBacking::HugeTLB;
+  } else {
+    p = map_aligned(rounded);
+    if (!p) {
+      perror("[Arena] mmap");
+      return;
+    }
+    // Asked for before the first touch, so the faults below allocate huge
+    // pages directly rather than waiting for khugepaged to collapse them
+    backing_ = madvise(p, rounded, MADV_HUGEPAGE) == 0 ? ArenaBacking::THP
+                                                       : ArenaBacking::Small;
+    // One write per 4 KB page; under THP only the first of each 2 MB faults
+    auto *bytes_p = static_cast<volatile std::byte *>(p);
+    for (size_t off = 0; off < rounded; off += 4096)
+      bytes_p[off] = std::byte{0};
+  }
+
+  base_ = static_cast<std::byte *>(p);
+  capacity_ = rounded;
+  prefault_seconds_ = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+}
+
+HugeArena::~HugeArena() {
+  if (base_)
+    munmap(base_, capacity_);
+}
+
+void *HugeArena::allocate(size_t bytes, size_t align) noexcept {
+  if (!base_)
+    return nullptr;
+  size_t used = used_.load(std::memory_order_relaxed);
+  while (true) {
+    size_t start = (used + align - 1) & ~(align - 1);
+    if (start > capacity_ || bytes > capacity_ - start) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    if (used_.compare_exchange_weak(used, start + bytes,
+                                    std::memory_order_relaxed))
+      return base_ + start;
+  }
+}
+
+void HugeArena::dump() const {
+  std::printf("[Arena] %s: %.1f of %zu MB used, %lu allocations fell back "
+              "to the heap\n",
+              to_string(backing_), used() / double(1 << 20), capacity_ >> 20,
+              misses());
+}
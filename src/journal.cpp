@@ -0,0 +1,321 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t PAGE = 4096;
+constexpr size_t HEADER = sizeof(Client::JournalHeader);
+
+inline std::atomic_ref<uint64_t> word(uint64_t &w) noexcept {
+  return std::atomic_ref<uint64_t>(w);
+}
+
+// <generation>-<shard>-<file id>.journal; the file id only keeps names
+// unique, replay order comes from the header
+std::string segment_name(uint64_t generation, size_t shard, uint64_t id) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "%06lu-%03zu-%06lu.journal", generation,
+                shard, id);
+  return name;
+}
+
+bool parse_name(const fs::path &path, uint64_t &generation) {
+  return path.extension() == ".journal" &&
+         std::sscanf(path.filename().c_str(), "%lu-", &generation) == 1;
+}
+
+// A record slot the file was created with and nothing ever filled
+bool unwritten(const Client::Order &o) noexcept {
+  static constexpr Client::Order ZERO{};
+  return std::memcmp(&o, &ZERO, sizeof(o)) == 0;
+}
+
+} // namespace
+
+Journal::Journal(const std::string &dir, uint64_t generation, size_t shard,
+                 JournalOptions opts)
+    : dir_(dir), generation_(generation), shard_(shard), opts_(opts),
+      capacity_((std::max(opts.segment_bytes, 2 * PAGE) - HEADER) /
+                sizeof(Client::Order)) {
+  std::error_code ec;
+  fs::create_directories(dir_, ec);
+  if (Segment *first = create_segment())
+    activate(first);
+}
+
+Journal::~Journal() {
+  maintain(true);
+  if (current_) {
+    sync(*current_, count_);
+    if (count_ == 0)
+      unlink(current_->path.c_str()); // a run that journaled nothing
+    release(current_);
+  }
+  if (Segment *spare = spare_.exchange(nullptr)) {
+    unlink(spare->path.c_str()); // never written
+    release(spare);
+  }
+}
+
+Journal::Segment *Journal::create_segment() {
+  uint64_t id = created_.fetch_add(1, std::memory_order_relaxed);
+  std::string path = dir_ + "/" + segment_name(generation_, shard_, id);
+  size_t bytes = HEADER + capacity_ * sizeof(Client::Order);
+
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror("[Journal] open");
+    return nullptr;
+  }
+  int err = posix_fallocate(fd, 0, bytes);
+  if (err != 0) {
+    std::fprintf(stderr, "[Journal] fallocate %s: %s\n", path.c_str(),
+                 std::strerror(err));
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+  void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    perror("[Journal] mmap");
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  auto *base = static_cast<uint8_t *>(p);
+  // Take the write faults here rather than on the matching thread
+  for (size_t off = 0; off < bytes; off += PAGE)
+    *reinterpret_cast<volatile uint8_t *>(base + off) = 0;
+
+  auto *header = reinterpret_cast<Client::JournalHeader *>(base);
+  header->magic = Client::JOURNAL_MAGIC;
+  header->version = Client::JOURNAL_VERSION;
+  header->generation = generation_;
+  header->shard = shard_;
+  header->capacity = capacity_;
+  return new Segment{fd,     path,
+                     base,   bytes,
+                     header, reinterpret_cast<Client::Order *>(base + HEADER)};
+}
+
+void Journal::activate(Segment *next) {
+  word(next->header->seq).store(++activated_, std::memory_order_relaxed);
+  Segment *old = current_;
+  current_ = next;
+  count_ = 0;
+  // Retarget the sync thread before handing the old segment over, so it
+  // can never pick up a segment it has already released
+  active_.store(next, std::memory_order_release);
+  if (old) {
+    while (!sealed_.enqueue(old))
+      _mm_pause();
+  }
+}
+
+void Journal::append(std::span<const Client::Order> orders) {
+  appended_ += orders.size();
+  while (!orders.empty()) {
+    if (count_ == capacity_) [[unlikely]] {
+      Segment *next = spare_.exchange(nullptr, std::memory_order_acquire);
+      if (!next) {
+        inline_rolls_++;
+        next = create_segment();
+        if (!next) {
+          // Matching orders that cannot be recovered is worse than stopping
+          std::fprintf(stderr, "[Journal] shard %zu cannot roll, aborting\n",
+                       shard_);
+          std::abort();
+        }
+      }
+      activate(next);
+    }
+
+    size_t n = std::min<size_t>(orders.size(), capacity_ - count_);
+    std::memcpy(current_->records + count_, orders.data(),
+                n * sizeof(Client::Order));
+    count_ += n;
+    word(current_->header->count).store(count_, std::memory_order_release);
+    orders = orders.subspan(n);
+  }
+}
+
+void Journal::sync(Segment &segment, uint64_t count) {
+  if (count <= segment.synced)
+    return;
+  auto t0 = std::chrono::steady_clock::now();
+
+  size_t from = HEADER + segment.synced * sizeof(Client::Order);
+  size_t to = HEADER + count * sizeof(Client::Order);
+  from &= ~(PAGE - 1);
+  // Records first, then the header page that vouches for them; a power
+  // loss in between leaves `synced` short rather than ahead of the data
+  if (msync(segment.base + from, to - from, MS_SYNC) < 0) {
+    perror("[Journal] msync");
+    return;
+  }
+  word(segment.header->synced).store(count, std::memory_order_relaxed);
+  if (msync(segment.base, PAGE, MS_SYNC) < 0) {
+    perror("[Journal] msync");
+    return;
+  }
+
+  segment.synced = count;
+  syncs_++;
+  sync_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - t0)
+                  .count();
+}
+
+void Journal::release(Segment *segment) {
+  munmap(segment->base, segment->bytes);
+  close(segment->fd);
+  delete segment;
+}
+
+void Journal::maintain(bool final) {
+  if (Segment *active = active_.load(std::memory_order_acquire))
+    sync(*active,
+         word(active->header->count).load(std::memory_order_acquire));
+
+  while (auto sealed = sealed_.dequeue()) {
+    Segment *s = *sealed;
+    sync(*s, word(s->header->count).load(std::memory_order_acquire));
+    release(s);
+  }
+
+  if (!final && spare_.load(std::memory_order_relaxed) == nullptr) {
+    if (Segment *spare = create_segment())
+      spare_.store(spare, std::memory_order_release);
+  }
+}
+
+void Journal::dump() const noexcept {
+  std::printf("[Journal shard %zu] records=%lu segments=%lu inline_rolls=%lu "
+              "syncs=%lu avg_sync=%.1f us\n",
+              shard_, appended_, activated_, inline_rolls_, syncs_,
+              syncs_ ? sync_ns_ / 1e3 / syncs_ : 0.0);
+}
+
+void run_journal_sync(std::vector<Journal *> journals,
+                      std::chrono::milliseconds interval,
+                      const std::atomic<bool> &done) {
+  while (!done.load(std::memory_order_acquire)) {
+    for (Journal *j : journals)
+      j->maintain();
+    std::this_thread::sleep_for(interval);
+  }
+  for (Journal *j : journals)
+    j->maintain(true);
+}
+
+uint64_t next_journal_generation(const std::string &dir) {
+  uint64_t last = 0;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    uint64_t generation = 0;
+    if (parse_name(entry.path(), generation))
+      last = std::max(last, generation);
+  }
+  return last + 1;
+}
+
+JournalReplayStats
+replay_journal(const std::string &dir,
+               const std::function<void(std::span<const Client::Order>)> &fn,
+               const JournalPosition &from) {
+  struct Found {
+    uint64_t generation, shard, seq;
+    fs::path path;
+  };
+  std::vector<Found> found;
+
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    uint64_t generation = 0;
+    if (!parse_name(entry.path(), generation))
+      continue;
+    int fd = open(entry.path().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      continue;
+    Client::JournalHeader h{};
+    bool valid = pread(fd, &h, sizeof(h), 0) == sizeof(h) &&
+                 h.magic == Client::JOURNAL_MAGIC &&
+                 h.version == Client::JOURNAL_VERSION && h.seq != 0;
+    close(fd);
+    if (valid)
+      found.push_back({h.generation, h.shard, h.seq, entry.path()});
+  }
+  std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+    return std::tie(a.generation, a.shard, a.seq) <
+           std::tie(b.generation, b.shard, b.seq);
+  });
+
+  JournalReplayStats stats;
+  std::vector<uint64_t> skip = from.applied; // per shard of from.generation
+  auto t0 = std::chrono::steady_clock::now();
+  for (const Found &f : found) {
+    if (f.generation < from.generation)
+      continue;
+    int fd = open(f.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      continue;
+    off_t size = lseek(fd, 0, SEEK_END);
+    void *p = size > static_cast<off_t>(HEADER)
+                  ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                         fd, 0)
+                  : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED)
+      continue;
+
+    auto *header = static_cast<const Client::JournalHeader *>(p);
+    uint64_t fits = (size - HEADER) / sizeof(Client::Order);
+    uint64_t count = std::min({header->count, header->capacity, fits});
+    auto *records = reinterpret_cast<const Client::Order *>(
+        static_cast<const uint8_t *>(p) + HEADER);
+    // The live count can reach the disk ahead of records written after the
+    // last sync; past `synced`, stop at the first record that never did
+    for (uint64_t i = std::min(header->synced, count); i < count; i++) {
+      if (unwritten(records[i])) {
+        count = i;
+        break;
+      }
+    }
+    if (count == 0) {
+      munmap(p, size);
+      continue;
+    }
+    std::span<const Client::Order> orders(records, count);
+    if (f.generation == from.generation && f.shard < skip.size()) {
+      uint64_t n = std::min<uint64_t>(skip[f.shard], count);
+      skip[f.shard] -= n;
+      stats.skipped += n;
+      orders = orders.subspan(n);
+    }
+    if (!orders.empty()) {
+      fn(orders);
+      stats.records += orders.size();
+      stats.segments++;
+    }
+    munmap(p, size);
+  }
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+  return stats;
+}
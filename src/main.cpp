@@ -1,22 +1,35 @@
 #include "TSCClock.h"
-#include "order.h"
+#include "affinity.h"
+#include "book_snapshot.h"
+#include "checkpoint.h"
+#include "config.h"
+#include "depth_publisher.h"
+#include "exec_writer.h"
+#include "huge_arena.h"
+#include "journal.h"
+#include "replay.h"
 #include "server.h"
-#include "spsc_queue.h"
-#include "types.h"
+#include "shard.h"
+#include "stats_reporter.h"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <csignal>
-#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <emmintrin.h>
+#include <functional>
 #include <iostream>
-#include <orderbook.h>
+#include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 using namespace std;
 
-SPSCQueue<Client::Order, 65536> order_queue;
-Orderbook book;
-uint64_t order_id = 1;
+// The network -> matcher ring and its tags; built in the arena by main
+OrderQueue *order_queue = nullptr;
+OrderTags *order_tags = nullptr;
 
 std::atomic<bool> *p_stop_flag = nullptr;
 
@@ -27,74 +40,319 @@ void handle_signal(int sig) {
   }
 }
 
-void matching_loop(std::atomic<bool> &stop_flag, TSCClock hardware_clock) {
-  uint64_t processed = 0;
-  chrono::steady_clock::time_point start;
-  bool started = false;
-
-  while (true) {
-
-    auto maybe_order = order_queue.dequeue();
-    if (!maybe_order) [[unlikely]] {
-      // queue is empty, check whether network stopped
-      if (stop_flag.load(std::memory_order::acquire)) {
-        maybe_order = order_queue.dequeue();
-        if (!maybe_order) {
-          break; // Queue is empty and network is dead. Safe to exit
-        }
-      } else {
-        _mm_pause();
-        continue;
-      }
-    }
+int main(int argc, char **argv) {
+  EngineConfig config = parse_args(argc, argv);
+
+  // First, so the rings, pools and books are locked as they are allocated
+  bool mlocked = config.mlock && lock_memory();
+
+  // Then the arena the rings, shards and book pools are carved from, so
+  // its pages are faulted in here and not mid-session
+  HugeArena arena(size_t(config.arena_mb) << 20);
+  HugeArena *slabs = arena.ok() ? &arena : nullptr;
+  if (arena.ok())
+    std::printf("[Arena] %zu MB (%s) prefaulted in %.1f ms\n",
+                arena.capacity() >> 20, to_string(arena.backing()),
+                arena.prefault_seconds() * 1e3);
+  ArenaPtr<OrderQueue> ingress_ring = arena_new<OrderQueue>(slabs);
+  ArenaPtr<OrderTags> ingress_tags = arena_new<OrderTags>(slabs);
+  order_queue = ingress_ring.get();
+  order_tags = ingress_tags.get();
 
-    ScopedTimer t(book.telemetry_, hardware_clock);
-    book.telemetry_.record_order();
+  std::atomic<bool> stop_flag{false};
+  p_stop_flag = &stop_flag;
 
-    if (!started) {
-      started = true;
-      start = chrono::steady_clock::now();
+  // Set once the network thread has stopped and every staged order has
+  // reached a shard; matchers drain their ring and exit after that.
+  std::atomic<bool> ingress_closed{false};
+
+  // Fail before any thread starts if the feed cannot be opened
+  int depth_fd = -1;
+  if (config.depth_port != 0) {
+    depth_fd = open_depth_feed(config.depth_host, config.depth_port);
+    if (depth_fd < 0)
+      return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<OrderFile> replay_file;
+  if (!config.replay.empty()) {
+    replay_file = std::make_unique<OrderFile>(config.replay);
+    if (!replay_file->ok())
+      return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<SnapshotWriter> snapshot;
+  if (!config.snapshot.empty()) {
+    snapshot = std::make_unique<SnapshotWriter>(config.snapshot,
+                                                config.snapshot_slots);
+    if (!snapshot->ok())
+      return EXIT_FAILURE;
+  }
+
+  // Each run journals and checkpoints under a new generation, after
+  // everything before it
+  uint64_t generation = 1;
+  if (!config.journal.empty())
+    generation = std::max(generation, next_journal_generation(config.journal));
+  if (!config.checkpoint.empty())
+    generation =
+        std::max(generation, next_checkpoint_generation(config.checkpoint));
+
+  std::vector<std::unique_ptr<Journal>> journals;
+  if (!config.journal.empty()) {
+    JournalOptions opts{.segment_bytes = size_t(config.journal_segment_mb)
+                                         << 20};
+    for (unsigned i = 0; i < config.shards; i++) {
+      journals.push_back(
+          std::make_unique<Journal>(config.journal, generation, i, opts));
+      if (!journals.back()->ok())
+        return EXIT_FAILURE;
     }
+  }
+
+  // Created here, before any thread is pinned: background checkpoint
+  // writers inherit this thread's affinity
+  std::vector<std::unique_ptr<Checkpointer>> checkpointers;
+  if (!config.checkpoint.empty()) {
+    for (unsigned i = 0; i < config.shards; i++)
+      checkpointers.push_back(std::make_unique<Checkpointer>(
+          config.checkpoint, generation, i, config.shards,
+          CheckpointOptions{.every = config.checkpoint_every,
+                            .arena = slabs}));
+  }
+
+  TSCClock hardware_clock;
+
+  // Each shard holds its rings and telemetry inline, so it goes in the arena
+  // whole
+  std::vector<ArenaPtr<Shard>> shards;
+  std::vector<Shard *> shard_ptrs;
+  for (unsigned i = 0; i < config.shards; i++) {
+    shards.push_back(arena_new<Shard>(
+        slabs, i,
+        ShardOptions{.exec_reports = config.exec_reports,
+                     .depth_feed = depth_fd >= 0,
+                     .snapshot = snapshot.get(),
+                     .journal = journals.empty() ? nullptr : journals[i].get(),
+                     .checkpoint = checkpointers.empty()
+                                       ? nullptr
+                                       : checkpointers[i].get(),
+                     .arena = slabs}));
+    shard_ptrs.push_back(shards.back().get());
+  }
+
+  // Rebuild the books from earlier runs before taking new orders: load the
+  // newest checkpoint, then replay only the journal written after it
+  JournalPosition from;
+  if (!config.checkpoint.empty()) {
+    CheckpointRestoreStats restored = restore_checkpoints(
+        config.checkpoint,
+        [&](InstrumentId instrument) -> BookRegistry & {
+          return shards[instrument % shards.size()]->books_;
+        },
+        from);
+    if (restored.files > 0)
+      std::printf("[Checkpoint] restored generation %lu: %lu orders at %lu "
+                  "levels in %lu books from %lu files in %.3fs\n",
+                  restored.generation, restored.orders, restored.levels,
+                  restored.books, restored.files, restored.seconds);
+  }
+  if (!config.journal.empty()) {
+    JournalReplayStats replayed = replay_journal(
+        config.journal,
+        [&](std::span<const Client::Order> orders) {
+          for (const Client::Order &order : orders)
+            shards[order.instrument % shards.size()]->dispatch(order);
+        },
+        from);
+    if (replayed.records > 0)
+      std::printf("[Journal] replayed %lu msgs from %lu segments in %.3fs "
+                  "(%.2f M msgs/s), %lu already checkpointed\n",
+                  replayed.records, replayed.segments, replayed.seconds,
+                  replayed.records / replayed.seconds / 1e6,
+                  replayed.skipped);
+  }
+
+  // A single shard reads the ingress ring directly; more need a router
+  std::unique_ptr<ShardRouter> router;
+  if (shards.size() > 1)
+    router = std::make_unique<ShardRouter>(shard_ptrs);
+
+  // One writer drains every shard's report ring
+  std::unique_ptr<ExecWriter> writer;
+  if (config.exec_reports) {
+    std::vector<ExecQueue *> rings;
+    for (auto &shard : shards)
+      rings.push_back(&shard->exec_queue_);
+    writer = std::make_unique<ExecWriter>(rings);
+  }
+
+  // And one publisher drains every shard's depth ring
+  std::unique_ptr<DepthPublisher> publisher;
+  if (depth_fd >= 0) {
+    std::vector<DepthQueue *> rings;
+    for (auto &shard : shards)
+      rings.push_back(&shard->depth_queue_);
+    publisher = std::make_unique<DepthPublisher>(rings, depth_fd);
+  }
 
-    const auto &order = *maybe_order;
-    bool is_buy = (order.side == Side::Bid);
+  // Written by the network thread, read by the stats reporter
+  Ingress_Telemetry ingress_telemetry;
 
-    if (order.order_type == OrderType::Limit) {
-      book.addOrder(order_id++, order.price, order.quantity, is_buy,
-                    order.account_id);
-    } else if (order.order_type == OrderType::Market) {
-      book.matchMarketOrder(is_buy, order.quantity);
-    } else {
-      book.removeOrder(order.order_id);
+  std::unique_ptr<StatsReporter> reporter;
+  if (config.stats_interval_ms > 0) {
+    reporter = std::make_unique<StatsReporter>(
+        shard_ptrs, replay_file ? nullptr : &ingress_telemetry,
+        StatsOptions{.interval =
+                         std::chrono::milliseconds(config.stats_interval_ms),
+                     .shm = config.stats,
+                     .memory_locked = mlocked});
+    if (!reporter->ok())
+      return EXIT_FAILURE;
+  }
+
+  std::signal(SIGINT, handle_signal);
+
+  auto start = chrono::steady_clock::now();
+  std::vector<thread> matchers;
+  for (auto &shard : shards) {
+    OrderQueue &input = router ? shard->queue_ : *order_queue;
+    OrderTags &tags = router ? shard->tags_ : *order_tags;
+    if (config.replay_direct)
+      matchers.emplace_back(&Shard::replay, shard.get(),
+                            replay_file->orders(), hardware_clock);
+    else
+      matchers.emplace_back(&Shard::run, shard.get(), ref(input), ref(tags),
+                            cref(ingress_closed), hardware_clock);
+    if (config.first_core >= 0) {
+      std::string name = "shard " + std::to_string(shard->index());
+      shard->telemetry_.placement.record(place_thread(
+          matchers.back().native_handle(), name.c_str(),
+          config.first_core + static_cast<int>(shard->index()),
+          config.fifo_priority));
     }
+  }
+
+  // Set once every matcher has exited; the writer and publisher then drain
+  // and stop. They take the cores after the shards'.
+  std::atomic<bool> matchers_done{false};
+  int next_core = config.first_core + static_cast<int>(shards.size());
+  thread egress;
+  if (writer) {
+    egress = thread(&ExecWriter::run, writer.get(), cref(matchers_done));
+    if (config.first_core >= 0)
+      pin_to_core(egress, next_core++);
+  }
+  thread feed;
+  if (publisher) {
+    feed = thread(&DepthPublisher::run, publisher.get(), cref(matchers_done));
+    if (config.first_core >= 0)
+      pin_to_core(feed, next_core++);
+  }
+
+  // Keeps the shared cycle-to-ns multiplier in step with the kernel clock
+  thread tsc_drift(run_tsc_drift_correction, std::chrono::seconds(5),
+                   cref(matchers_done));
+
+  // Left unpinned: it sleeps between samples and needs no core of its own
+  thread stats;
+  if (reporter)
+    stats = thread(&StatsReporter::run, reporter.get(), cref(matchers_done));
+
+  thread journal_sync;
+  if (!journals.empty()) {
+    std::vector<Journal *> ptrs;
+    for (auto &j : journals)
+      ptrs.push_back(j.get());
+    journal_sync = thread(run_journal_sync, ptrs,
+                          std::chrono::milliseconds(config.journal_sync_ms),
+                          cref(matchers_done));
+  }
+
+  // The network thread (this one) is placed last: every thread started
+  // above would otherwise inherit its core and scheduling class
+  if (!config.replay_direct)
+    ingress_telemetry.placement.record(place_thread(
+        pthread_self(), "network", config.net_core, config.fifo_priority));
+
+  std::printf("[Placement] network: %s\n",
+              describe(ingress_telemetry.placement.load()).c_str());
+  for (auto &shard : shards)
+    std::printf("[Placement] shard %zu: %s\n", shard->index(),
+                describe(shard->telemetry_.placement.load()).c_str());
+  std::printf("[Placement] memory: %s\n", mlocked ? "locked" : "pageable");
 
-    processed++;
+  // Replay stands in for the network thread; a direct replay needs neither
+  if (replay_file && !config.replay_direct) {
+    ReplayFeedStats fed = feed_orders(replay_file->orders(), *order_queue,
+                                      *order_tags, router.get(), stop_flag);
+    std::cout << "[Replay] fed " << fed.orders << " orders ("
+              << fed.stalls << " full-ring stalls)\n";
+  } else if (!replay_file) {
+    start_tcp_server(stop_flag, hardware_clock, config, ingress_telemetry,
+                     router.get(), writer.get());
+  }
 
-    if (processed % 1'000'000 == 0) {
-      auto now = chrono::steady_clock::now();
-      double elapsed = chrono::duration<double>(now - start).count();
-      std::cout << processed << " processed in " << elapsed << "s ("
-                << processed / elapsed << " orders/sec)" << "\n";
-      book.telemetry_.dump(elapsed);
-      std::printf("active_levels=%zu resting_orders=%zu\n",
-                  book.active_levels(), book.resting_orders());
+  if (router) {
+    while (!order_queue->peek(1).empty()) {
+      if (router->route(*order_queue, *order_tags) == 0)
+        _mm_pause();
     }
+    std::cout << "Routed: " << router->routed() << " across "
+              << router->shards() << " shards (" << router->blocked()
+              << " full-ring stalls)\n";
   }
+  ingress_closed.store(true, std::memory_order_release);
 
-  book.dump_shape("final_shape.csv", 10);
-  cout << "processed: " << processed << '\n';
-}
+  for (auto &t : matchers)
+    t.join();
 
-int main() {
-  std::atomic<bool> stop_flag{false};
-  p_stop_flag = &stop_flag;
+  if (replay_file) {
+    double elapsed =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    uint64_t processed = 0;
+    for (auto &shard : shards)
+      processed += shard->processed();
+    std::printf("[Replay] %lu orders in %.3fs (%.2f M orders/s) via %s\n",
+                processed, elapsed, processed / elapsed / 1e6,
+                config.replay_direct ? "direct dispatch" : "the order ring");
+  }
 
-  TSCClock hardware_clock;
+  matchers_done.store(true, std::memory_order_release);
+  tsc_drift.join();
+  if (stats.joinable())
+    stats.join();
+  if (writer) {
+    egress.join();
+    writer->dump();
+  }
+  if (publisher) {
+    feed.join();
+    publisher->dump();
+  }
+  if (journal_sync.joinable()) {
+    journal_sync.join();
+    for (auto &j : journals)
+      j->dump();
+  }
 
-  std::signal(SIGINT, handle_signal);
-  thread matcher(matching_loop, ref(stop_flag), hardware_clock);
-  start_tcp_server(stop_flag, hardware_clock);
-  matcher.join();
+  if (snapshot)
+    snapshot->dump();
+  for (auto &c : checkpointers)
+    c->dump();
+  if (arena.ok())
+    arena.dump();
+
+  if (!config.latency_csv.empty()) {
+    auto merged = std::make_unique<Telemetry>();
+    for (auto &shard : shards)
+      merged->merge_latency(shard->telemetry_);
+    merged->write_latency_csv(config.latency_csv.c_str());
+  }
+
+  // Instrument 0 always lands on shard 0
+  if (const BookRegistry::Book *b = shards[0]->books_.find(0))
+    b->book.dump_shape("final_shape.csv", 10);
 
   std::cerr << "[Main] Graceful termination.\n";
   return 0;
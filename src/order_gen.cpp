@@ -0,0 +1,186 @@
+#include "order_gen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Resting limit ids by price. A cancel picks a price uniformly and takes
+// its newest id, as the script's random.choice(list(pool.keys())) does, but
+// in O(1): prices sit in a dense vector and an emptied one is swapped out.
+class PricePool {
+  struct Bucket {
+    Price price;
+    std::vector<OrderId> ids;
+  };
+  std::vector<Bucket> buckets_;
+  std::unordered_map<Price, size_t> slot_;
+
+public:
+  bool empty() const noexcept { return buckets_.empty(); }
+
+  void add(Price price, OrderId id) {
+    auto [it, inserted] = slot_.try_emplace(price, buckets_.size());
+    if (inserted)
+      buckets_.push_back({price, {}});
+    buckets_[it->second].ids.push_back(id);
+  }
+
+  OrderId take(uint64_t r) {
+    size_t i = r % buckets_.size();
+    OrderId id = buckets_[i].ids.back();
+    buckets_[i].ids.pop_back();
+    if (buckets_[i].ids.empty()) {
+      slot_.erase(buckets_[i].price);
+      if (i + 1 != buckets_.size()) {
+        buckets_[i] = std::move(buckets_.back());
+        slot_[buckets_[i].price] = i;
+      }
+      buckets_.pop_back();
+    }
+    return id;
+  }
+};
+
+// One chunk's generator. Draws are built from raw mt19937_64 output rather
+// than <random> distributions, whose results differ between standard
+// libraries, so a seed names the same stream everywhere.
+class ChunkStream {
+  const OrderGenParams &p_;
+  std::mt19937_64 rng_;
+  double qty_mu_;
+  double spare_normal_{0};
+  bool has_spare_{false};
+  OrderId next_id_;
+  PricePool near_, far_;
+
+  // Uniform in (0, 1)
+  double uniform() { return ((rng_() >> 11) + 0.5) * 0x1p-53; }
+
+  // Standard normal, Marsaglia polar method
+  double normal() {
+    if (has_spare_) {
+      has_spare_ = false;
+      return spare_normal_;
+    }
+    double u, v, s;
+    do {
+      u = 2 * uniform() - 1;
+      v = 2 * uniform() - 1;
+      s = u * u + v * v;
+    } while (s >= 1);
+    double scale = std::sqrt(-2 * std::log(s) / s);
+    spare_normal_ = v * scale;
+    has_spare_ = true;
+    return u * scale;
+  }
+
+  Side side() { return uniform() < p_.buy_ratio ? Side::Bid : Side::Ask; }
+
+  // Laplace (double exponential) offset from the mid
+  Price price() {
+    double u = uniform() - 0.5;
+    double offset =
+        std::copysign(std::log1p(-2 * std::abs(u)) / -p_.price_decay, u);
+    auto price = static_cast<int64_t>(p_.fair_price) +
+                 static_cast<int64_t>(offset);
+    return static_cast<Price>(std::max<int64_t>(1, price));
+  }
+
+  // Lognormal with a heavy right tail
+  Volume quantity() {
+    double q = std::exp(qty_mu_ + p_.qty_sigma * normal());
+    return static_cast<Volume>(std::max(1.0, std::round(std::min(q, 1e18))));
+  }
+
+  uint32_t account() {
+    return static_cast<uint32_t>(1 + rng_() % p_.accounts);
+  }
+
+  OrderType event() {
+    double r = uniform();
+    if (near_.empty() && far_.empty())
+      return r < p_.p_limit / (p_.p_limit + p_.p_market) ? OrderType::Limit
+                                                         : OrderType::Market;
+    if (r < p_.p_limit)
+      return OrderType::Limit;
+    if (r < p_.p_limit + p_.p_market)
+      return OrderType::Market;
+    return OrderType::Cancel;
+  }
+
+public:
+  ChunkStream(const OrderGenParams &p, uint64_t index)
+      : p_(p), qty_mu_(std::log(p.qty_median)),
+        next_id_(index * p.chunk + 1) {
+    std::seed_seq seq{static_cast<uint32_t>(p.seed),
+                      static_cast<uint32_t>(p.seed >> 32),
+                      static_cast<uint32_t>(index),
+                      static_cast<uint32_t>(index >> 32)};
+    rng_.seed(seq);
+  }
+
+  Client::Order next() {
+    Client::Order o{};
+    o.instrument = p_.instrument;
+    o.order_type = event();
+    if (o.order_type == OrderType::Cancel) {
+      bool use_far = uniform() < p_.far_cancel;
+      PricePool &pool = (use_far && !far_.empty()) || near_.empty() ? far_
+                                                                    : near_;
+      o.side = Side::Bid;
+      o.order_id = pool.take(rng_());
+      return o;
+    }
+
+    o.side = side();
+    if (o.order_type == OrderType::Limit)
+      o.price = price();
+    o.quantity = quantity();
+    o.account_id = account();
+    o.order_id = next_id_++;
+    if (o.order_type == OrderType::Limit) {
+      Price delta = o.price > p_.fair_price ? o.price - p_.fair_price
+                                            : p_.fair_price - o.price;
+      (delta > p_.far_threshold ? far_ : near_).add(o.price, o.order_id);
+    }
+    return o;
+  }
+};
+
+} // namespace
+
+void generate_chunk(const OrderGenParams &params, uint64_t index,
+                    std::span<Client::Order> out) {
+  ChunkStream stream(params, index);
+  for (Client::Order &o : out.first(std::min<size_t>(out.size(), params.chunk)))
+    o = stream.next();
+}
+
+double generate_orders(const OrderGenParams &params,
+                       std::span<Client::Order> out, unsigned threads) {
+  const uint64_t chunks = (out.size() + params.chunk - 1) / params.chunk;
+  std::atomic<uint64_t> next{0};
+  auto worker = [&] {
+    for (uint64_t i; (i = next.fetch_add(1)) < chunks;)
+      generate_chunk(params, i, out.subspan(i * params.chunk));
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  threads = static_cast<unsigned>(
+      std::clamp<uint64_t>(threads, 1, std::max<uint64_t>(chunks, 1)));
+  for (unsigned t = 1; t < threads; t++)
+    pool.emplace_back(worker);
+  worker();
+  for (auto &t : pool)
+    t.join();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
@@ -14,49 +14,133 @@
 
 // Level methods
 void Level::push_back(Matching::Order *o) {
-  o->level = this;
-  o->next = &sentinel;
-  o->prev = sentinel.prev;
-  sentinel.prev->next = o;
-  sentinel.prev = o;
+  if (last == nullptr || tail == FifoChunk::ENTRIES) {
+    // Squeeze out cancelled holes rather than grow while they make up at
+    // least half the queue; each compaction frees room for as many pushes
+    // as it moved orders, so the cost stays constant per order
+    if (last != nullptr && span >= 2 * size + 2)
+      compact();
+    if (last == nullptr || tail == FifoChunk::ENTRIES)
+      grow();
+  }
+  o->level = ref();
+  o->slot = last->slot(tail);
+  last->entries[tail++] = {o, o->quantity_remaining};
+  span++;
   size++;
   volume += o->quantity_remaining;
 };
 
 void Level::pop(Matching::Order *o) {
-  assert(o->type == Matching::NodeType::Order);
-  o->prev->next = o->next;
-  o->next->prev = o->prev;
-  o->next = nullptr;
-  o->prev = nullptr;
+  LevelEntry &entry = chunks->entry(o->slot);
+  assert(o->level == ref() && entry.order == o);
+  volume -= entry.remaining;
+  entry = {nullptr, 0};
   size--;
-  volume -= o->quantity_remaining;
-  o->level = nullptr;
+  o->level = {};
+
+  if (size == 0) {
+    chunks->release(first, last);
+    first = last = nullptr;
+    head = tail = span = 0;
+    return;
+  }
+  // Keep front() and back() on live orders, handing back drained chunks
+  while (first->entries[head].order == nullptr) {
+    span--;
+    if (++head == FifoChunk::ENTRIES) {
+      FifoChunk *drained = first;
+      first = first->next;
+      first->prev = nullptr;
+      chunks->release(drained, drained);
+      head = 0;
+    }
+  }
+  while (last->entries[tail - 1].order == nullptr) {
+    span--;
+    if (--tail == 0) {
+      FifoChunk *drained = last;
+      last = last->prev;
+      last->next = nullptr;
+      chunks->release(drained, drained);
+      tail = FifoChunk::ENTRIES;
+    }
+  }
 };
 
+void Level::grow() {
+  assert(chunks != nullptr && "Level has no chunk pool");
+  FifoChunk *chunk = chunks->acquire();
+  chunk->next = nullptr;
+  chunk->prev = last;
+  if (last)
+    last->next = chunk;
+  else
+    first = chunk;
+  last = chunk;
+  tail = 0;
+}
+
+void Level::compact() {
+  // Slide the live entries to the front, oldest first
+  FifoChunk *to = first;
+  uint32_t at = 0;
+  for (FifoChunk *from = first; from != nullptr; from = from->next) {
+    uint32_t end = from == last ? tail : FifoChunk::ENTRIES;
+    for (uint32_t i = from == first ? head : 0; i < end; i++) {
+      LevelEntry entry = from->entries[i];
+      if (entry.order == nullptr)
+        continue;
+      if (at == FifoChunk::ENTRIES) {
+        to = to->next;
+        at = 0;
+      }
+      to->entries[at] = entry;
+      entry.order->slot = to->slot(at);
+      at++;
+    }
+  }
+  head = 0;
+  tail = at;
+  span = size;
+  if (to != last) {
+    chunks->release(to->next, last);
+    to->next = nullptr;
+    last = to;
+  }
+}
+
 std::string Level::toString() const {
   std::ostringstream oss;
   oss << "Level(price=" << price << ", size=" << size << ", volume=" << volume
       << ")\n";
 
-  const Matching::Order *curr = sentinel.next;
-  while (curr != &sentinel) {
-    oss << "  Order{id=" << curr->order_id
-        << ", qty_rem=" << curr->quantity_remaining
-        << ", side=" << (curr->side == Side::Bid ? "Bid" : "Ask")
-        << ", acct=" << curr->account_id << "}\n";
-    curr = curr->next;
-  }
+  for_each([&](const Matching::Order &o) {
+    oss << "  Order{id=" << o.order_id << ", qty_rem=" << o.quantity_remaining
+        << ", side=" << (side == Side::Bid ? "Bid" : "Ask") << "}\n";
+  });
   return oss.str();
 }
 
 void Orderbook::addOrder(uint64_t orderId, Price price, uint64_t quantity,
                          bool is_buy, uint64_t account_id) {
-  Matching::Order *order =
-      orderpool_.allocate(orderId, quantity, is_buy, account_id);
+  Side side = is_buy ? Side::Bid : Side::Ask;
+  if (!Matching::fits(quantity, price)) [[unlikely]] {
+    // Too large for the compact order layout
+    telemetry_.record_reject();
+    report(ExecType::Rejected, current_session(), orderId, side, price,
+           quantity, 0);
+    return;
+  }
+
+  Matching::Order *order = orderpool_.allocate(orderId, quantity, account_id);
+  order->session = current_session();
+  report(ExecType::Ack, order->session, orderId, side, price, quantity,
+         quantity);
 
-  uint64_t quantity_remaining = matchLimitOrder(order, price);
-  order->quantity_remaining = quantity_remaining;
+  uint64_t quantity_remaining = matchLimitOrder(order, side, price);
+  order->quantity_remaining =
+      static_cast<Matching::Quantity>(quantity_remaining);
 
   if (quantity_remaining == 0) {
     // Order fully filled
@@ -64,30 +148,55 @@ void Orderbook::addOrder(uint64_t orderId, Price price, uint64_t quantity,
     return;
   }
 
-  Side side = order->side;
   auto &sideOfBook = (side == Side::Bid) ? mBidLevels : mAskLevels;
 
-  auto possibleLevel =
-      (side == Side::Bid) ? findBidPos(price) : findAskPos(price);
-
-  if (possibleLevel != sideOfBook.end() &&
-      possibleLevel->get()->price == price) {
-    addToLevel(*possibleLevel->get(), order);
-  } else {
-    auto newLevel = std::make_unique<Level>(price);
-    addToLevel(*newLevel, order);
-    sideOfBook.insert(possibleLevel, std::move(newLevel));
+  Level *level = sideOfBook.find(price);
+  if (level == nullptr) {
+    level = sideOfBook.insert(price, levelpool_.allocate(price, side));
   }
+  addToLevel(*level, order);
+  touch(side, *level);
 };
 
-uint64_t Orderbook::matchLimitOrder(Matching::Order *incoming, Price price) {
-  Side side = incoming->side;
+// Orders this far ahead of the one being filled are prefetched
+static constexpr uint32_t FILL_PREFETCH = 4;
+
+template <typename F>
+uint64_t Orderbook::fill(Level &level, uint64_t quantity, F &&fill_incoming) {
+  // pop() keeps the front on a live order, so every round trades
+  while (quantity > 0 && !level.empty()) {
+    if (Matching::Order *next = level.ahead(FILL_PREFETCH))
+      __builtin_prefetch(next, 1);
+    LevelEntry &entry = level.front_entry();
+    Matching::Order *resting = entry.order;
+
+    uint64_t traded = std::min(quantity, entry.remaining);
+    quantity -= traded;
+    entry.remaining -= traded;
+    resting->quantity_remaining =
+        static_cast<Matching::Quantity>(entry.remaining);
+    level.volume -= traded;
+
+    report(ExecType::Fill, resting->session, resting->order_id, level.side,
+           level.price, traded, entry.remaining);
+    fill_incoming(level.price, traded, quantity);
+
+    if (resting->quantity_remaining == 0) {
+      level.pop(resting);
+      orderpool_.deallocate(resting->order_id);
+    }
+  }
+  return quantity;
+}
+
+uint64_t Orderbook::matchLimitOrder(Matching::Order *incoming, Side side,
+                                    Price price) {
   auto &opposingLevels = (side == Side::Bid) ? mAskLevels : mBidLevels;
   uint64_t quantity_remaining = incoming->quantity_remaining;
   bool recorded = false;
-  // iterate from best opposite (back)
+  // iterate from best opposite
   while (quantity_remaining > 0 && !opposingLevels.empty()) {
-    Level &bestOpp = *opposingLevels.back();
+    Level &bestOpp = *opposingLevels.best();
 
     bool crossed = Orderbook::crossed(price, bestOpp.price, side);
 
@@ -98,69 +207,62 @@ uint64_t Orderbook::matchLimitOrder(Matching::Order *incoming, Price price) {
       recorded = true;
       telemetry_.record_match();
     }
+    touch(opposite(side), bestOpp);
 
-    Matching::Order *resting = bestOpp.sentinel.next;
-    while (quantity_remaining > 0 && resting != &bestOpp.sentinel) {
-      uint64_t traded =
-          std::min(quantity_remaining, resting->quantity_remaining);
-      quantity_remaining -= traded;
-      resting->quantity_remaining -= traded;
-      bestOpp.volume -= traded;
-
-      Matching::Order *next = resting->next; // prefetch
-
-      if (resting->quantity_remaining == 0) {
-        bestOpp.pop(resting);
-        orderpool_.deallocate(resting->order_id);
-      }
-
-      resting = next;
-    }
+    quantity_remaining = fill(bestOpp, quantity_remaining,
+                              [&](Price at, Volume traded, Volume left) {
+                                report(ExecType::Fill, incoming->session,
+                                       incoming->order_id, side, at, traded,
+                                       left);
+                              });
 
     if (bestOpp.size == 0) {
-      opposingLevels.pop_back();
+      opposingLevels.erase(bestOpp.price);
+      levelpool_.deallocate(&bestOpp);
     }
   }
 
   return quantity_remaining;
 }
 
-uint64_t Orderbook::matchMarketOrder(bool is_buy, uint64_t quantity) {
+uint64_t Orderbook::matchMarketOrder(bool is_buy, uint64_t quantity,
+                                     OrderId order_id) {
   auto &opposingLevels = (is_buy) ? mAskLevels : mBidLevels;
   uint64_t quantity_remaining = quantity;
+  Side side = is_buy ? Side::Bid : Side::Ask;
+  uint32_t session = current_session();
   bool recorded = false;
-  // iterate from best opposite (back)
+  // iterate from best opposite
   while (quantity_remaining > 0 && !opposingLevels.empty()) {
-    Level &bestOpp = *opposingLevels.back();
+    Level &bestOpp = *opposingLevels.best();
 
     if (!recorded) {
       recorded = true;
       telemetry_.record_match();
     }
+    touch(opposite(side), bestOpp);
 
-    Matching::Order *resting = bestOpp.sentinel.next;
-    while (quantity_remaining > 0 && resting != &bestOpp.sentinel) {
-      uint64_t traded =
-          std::min(quantity_remaining, resting->quantity_remaining);
-      quantity_remaining -= traded;
-      resting->quantity_remaining -= traded;
-      bestOpp.volume -= traded;
-
-      Matching::Order *next = resting->next; // prefetch
-
-      if (resting->quantity_remaining == 0) {
-        bestOpp.pop(resting);
-        orderpool_.deallocate(resting->order_id);
-      }
-
-      resting = next;
-    }
+    quantity_remaining =
+        fill(bestOpp, quantity_remaining,
+             [&](Price at, Volume traded, Volume left) {
+               report(ExecType::Fill, session, order_id, side, at, traded,
+                      left);
+             });
 
     if (bestOpp.size == 0) {
-      opposingLevels.pop_back();
+      opposingLevels.erase(bestOpp.price);
+      levelpool_.deallocate(&bestOpp);
     }
   }
 
+  // Market orders never rest: the unfilled remainder is cancelled, or the
+  // whole order rejected if nothing traded
+  if (quantity_remaining == quantity)
+    report(ExecType::Rejected, session, order_id, side, 0, quantity, 0);
+  else if (quantity_remaining > 0)
+    report(ExecType::Cancelled, session, order_id, side, 0,
+           quantity_remaining, 0);
+
   return quantity_remaining;
 }
 
@@ -168,13 +270,18 @@ void Orderbook::removeOrder(uint64_t order_id) {
   auto *order = orderpool_.find(order_id);
   if (order == nullptr) {
     telemetry_.record_stale_cancel();
+    report(ExecType::Rejected, current_session(), order_id, Side::Bid, 0, 0,
+           0);
     return;
   }
 
   telemetry_.record_cancel();
-  Level *level = order->level;
+  Level *level = levelpool_.at(order->level);
+  Side side = level->side;
+  report(ExecType::Cancelled, order->session, order_id, side, level->price,
+         order->quantity_remaining, 0);
   level->pop(order);
-  Side side = order->side;
+  touch(side, *level);
   orderpool_.deallocate(order_id);
 
   if (level->size > 0)
@@ -182,61 +289,70 @@ void Orderbook::removeOrder(uint64_t order_id) {
 
   // remove empty level
   auto &sideOfBook = (side == Side::Bid) ? mBidLevels : mAskLevels;
+  sideOfBook.erase(level->price);
+  levelpool_.deallocate(level);
+}
 
-  auto it = std::find_if(
-      sideOfBook.begin(), sideOfBook.end(),
-      [level](const std::unique_ptr<Level> &p) { return p.get() == level; });
+Level *Orderbook::restore_level(Side side, Price price) {
+  auto &sideOfBook = (side == Side::Bid) ? mBidLevels : mAskLevels;
+  Level *level = sideOfBook.find(price);
+  if (level == nullptr)
+    level = sideOfBook.insert(price, levelpool_.allocate(price, side));
+  return level;
+}
 
-  if (it != sideOfBook.end()) {
-    sideOfBook.erase(it);
-  }
+bool Orderbook::restore_order(Level &level, OrderId order_id, Volume quantity,
+                              Volume remaining, AccountId account_id) {
+  if (!Matching::fits(quantity, level.price))
+    return false; // too large for the compact order layout
+  Matching::Order *order = orderpool_.allocate(order_id, quantity, account_id);
+  if (order->level != Matching::LevelRef{})
+    return false; // duplicate id: the pool handed back the resting order
+  order->quantity_remaining = static_cast<Matching::Quantity>(remaining);
+  order->session = 0; // sessions do not survive a restart
+  addToLevel(level, order);
+  return true;
 }
 
 std::pair<BestLevel, BestLevel> Orderbook::getBestPrices() const {
-  BestLevel bestBid, bestAsk;
-  if (!mBidLevels.empty()) {
-    bestBid =
-        std::make_pair(mBidLevels.back()->price, mBidLevels.back()->volume);
-  }
-  if (!mAskLevels.empty()) {
-    bestAsk =
-        std::make_pair(mAskLevels.back()->price, mAskLevels.back()->volume);
-  }
-
-  return {bestBid, bestAsk};
+  return {bestBid(), bestAsk()};
 };
 
-Orderbook::BidIt Orderbook::findBidPos(Price price) {
+std::vector<const Level *> Orderbook::bids() const {
   // bids: ascending, best at back
-  return std::lower_bound(mBidLevels.begin(), mBidLevels.end(), price,
-                          [](const std::unique_ptr<Level> &L,
-                             const Price price) { return L->price < price; });
-};
+  std::vector<const Level *> levels;
+  levels.reserve(mBidLevels.size());
+  mBidLevels.for_each([&](const Level &lvl) { levels.push_back(&lvl); });
+  return levels;
+}
 
-Orderbook::AskIt Orderbook::findAskPos(Price price) {
+std::vector<const Level *> Orderbook::asks() const {
   // Asks: descending, best at back
-  return std::lower_bound(mAskLevels.begin(), mAskLevels.end(), price,
-                          [](const std::unique_ptr<Level> &L,
-                             const Price price) { return L->price > price; });
-};
+  std::vector<const Level *> levels;
+  levels.reserve(mAskLevels.size());
+  mAskLevels.for_each([&](const Level &lvl) { levels.push_back(&lvl); });
+  std::reverse(levels.begin(), levels.end());
+  return levels;
+}
 
 void Orderbook::addToLevel(Level &level, Matching::Order *order) {
-  assert(order->level == nullptr && "Order already belongs to a level");
+  assert(order->level == Matching::LevelRef{} &&
+         "Order already belongs to a level");
   level.push_back(order);
 }
 
 BestLevel Orderbook::bestBid() const {
-  return mBidLevels.empty()
+  const Level *best = mBidLevels.best();
+  return best == nullptr
              ? std::nullopt
-             : std::make_optional(std::make_pair(mBidLevels.back()->price,
-                                                 mBidLevels.back()->volume));
+             : std::make_optional(std::make_pair(best->price, best->volume));
 }
 
 BestLevel Orderbook::bestAsk() const {
-  return mAskLevels.empty()
+  const Level *best = mAskLevels.best();
+  return best == nullptr
              ? std::nullopt
-             : std::make_optional(std::make_pair(mAskLevels.back()->price,
-                                                 mAskLevels.back()->volume));
+             : std::make_optional(std::make_pair(best->price, best->volume));
 }
 
 std::string Orderbook::toString() const {
@@ -246,41 +362,37 @@ std::string Orderbook::toString() const {
 
   // --- Asks (print best last, since stored descending) ---
   oss << "[ASKS]\n";
-  if (mAskLevels.empty()) {
+  auto askLevels = asks();
+  if (askLevels.empty()) {
     oss << "  <empty>\n";
   } else {
-    for (auto it = mAskLevels.rbegin(); it != mAskLevels.rend(); ++it) {
+    for (auto it = askLevels.rbegin(); it != askLevels.rend(); ++it) {
       const Level &L = **it;
       oss << "  Price: " << L.price << " | Size: " << L.size
           << " | Vol: " << L.volume << '\n';
-      const Matching::Order *curr = L.sentinel.next;
-      while (curr != &L.sentinel) {
-        oss << "    → id=" << curr->order_id
-            << " qty=" << curr->quantity_remaining
-            << " acct=" << curr->account_id
-            << " side=" << (curr->side == Side::Bid ? "Bid" : "Ask") << '\n';
-        curr = curr->next;
-      }
+      L.for_each([&](const Matching::Order &o) {
+        oss << "    → id=" << o.order_id << " qty=" << o.quantity_remaining
+            << " acct=" << orderpool_.account(o)
+            << " side=" << (L.side == Side::Bid ? "Bid" : "Ask") << '\n';
+      });
     }
   }
 
   // --- Bids (stored ascending) ---
   oss << "[BIDS]\n";
-  if (mBidLevels.empty()) {
+  auto bidLevels = bids();
+  if (bidLevels.empty()) {
     oss << "  <empty>\n";
   } else {
-    for (auto it = mBidLevels.rbegin(); it != mBidLevels.rend(); ++it) {
+    for (auto it = bidLevels.rbegin(); it != bidLevels.rend(); ++it) {
       const Level &L = **it;
       oss << "  Price: " << L.price << " | Size: " << L.size
           << " | Vol: " << L.volume << '\n';
-      const Matching::Order *curr = L.sentinel.next;
-      while (curr != &L.sentinel) {
-        oss << "    → id=" << curr->order_id
-            << " qty=" << curr->quantity_remaining
-            << " acct=" << curr->account_id
-            << " side=" << (curr->side == Side::Bid ? "Bid" : "Ask") << '\n';
-        curr = curr->next;
-      }
+      L.for_each([&](const Matching::Order &o) {
+        oss << "    → id=" << o.order_id << " qty=" << o.quantity_remaining
+            << " acct=" << orderpool_.account(o)
+            << " side=" << (L.side == Side::Bid ? "Bid" : "Ask") << '\n';
+      });
     }
   }
 
@@ -293,24 +405,22 @@ void Orderbook::dump_shape(const std::string &path, uint64_t bin_size) const {
     return;
   }
 
-  uint64_t best_bid = mBidLevels.back().get()->price;
-  uint64_t best_ask = mAskLevels.back().get()->price;
+  uint64_t best_bid = mBidLevels.best()->price;
+  uint64_t best_ask = mAskLevels.best()->price;
 
   double mid = (best_bid + best_ask) / 2.0;
 
   std::unordered_map<int64_t, std::pair<uint64_t, uint64_t>> bins;
 
-  for (auto &it : mBidLevels) {
-    auto lvl = it.get();
-    int64_t dist = -static_cast<int64_t>((mid - lvl->price) / bin_size);
-    bins[dist].first += lvl->volume;
-  }
+  mBidLevels.for_each([&](const Level &lvl) {
+    int64_t dist = -static_cast<int64_t>((mid - lvl.price) / bin_size);
+    bins[dist].first += lvl.volume;
+  });
 
-  for (auto &it : mAskLevels) {
-    auto lvl = it.get();
-    int64_t dist = static_cast<int64_t>((lvl->price - mid) / bin_size);
-    bins[dist].second += lvl->volume;
-  }
+  mAskLevels.for_each([&](const Level &lvl) {
+    int64_t dist = static_cast<int64_t>((lvl.price - mid) / bin_size);
+    bins[dist].second += lvl.volume;
+  });
 
   std::vector<int64_t> keys;
   keys.reserve(bins.size());
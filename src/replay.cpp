@@ -0,0 +1,65 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+OrderFile::OrderFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror("OrderFile open");
+    return;
+  }
+  off_t size = lseek(fd, 0, SEEK_END);
+  if (size < static_cast<off_t>(sizeof(Client::Order))) {
+    std::fprintf(stderr, "OrderFile: %s holds no orders\n", path.c_str());
+    close(fd);
+    return;
+  }
+  void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror("OrderFile mmap");
+    return;
+  }
+  madvise(p, size, MADV_SEQUENTIAL);
+  base_ = p;
+  bytes_ = size;
+}
+
+OrderFile::~OrderFile() {
+  if (base_)
+    munmap(base_, bytes_);
+}
+
+ReplayFeedStats feed_orders(std::span<const Client::Order> orders,
+                            OrderQueue &queue, OrderTags &tags,
+                            ShardRouter *router,
+                            const std::atomic<bool> &stop) {
+  ReplayFeedStats stats;
+  size_t off = 0;
+  while (off < orders.size() && !stop.load(std::memory_order_relaxed)) {
+    if (router)
+      router->route(queue, tags);
+
+    auto slots = queue.claim(orders.size() - off);
+    if (slots.empty()) {
+      stats.stalls++;
+      _mm_pause();
+      continue;
+    }
+    std::memcpy(slots.data(), orders.data() + off,
+                slots.size() * sizeof(Client::Order));
+    // No network stage: the orders are received as they are enqueued
+    uint64_t now = pipeline_stamp();
+    tags.tag(OrderTags::NONE, slots.size(), {now, now});
+    queue.publish(slots.size());
+    off += slots.size();
+  }
+  stats.orders = off;
+  return stats;
+}
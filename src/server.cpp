@@ -1,11 +1,16 @@
 
 #include "TSCClock.h"
+#include "exec_writer.h"
 #include "ingress_telemetry.h"
-#include "socket_buffer.h"
+#include "ring_reader.h"
+#include "session.h"
+#include "uring_ingress.h"
 #include <order.h>
 #include <spsc_queue.h>
 #include <types.h>
 
+#include <arpa/inet.h>
+#include <array>
 #include <atomic>
 #include <cerrno>
 #include <chrono>
@@ -15,67 +20,288 @@
 #include <immintrin.h>
 #include <iostream>
 #include <netinet/in.h>
-#include <poll.h>
 #include <server.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #ifdef ENABLE_TELEMETRY
 #define RECORD_START_TIME(clock) uint64_t _start = clock.start()
-#define RECORD_END_TIME(clock, tel) tel.record_latency(clock.stop() - _start)
+#define RECORD_END_TIME(clock, tel, msgs)                                      \
+  tel.record_batch(clock.cycles_to_nanoseconds(clock.stop() - _start), msgs)
 #else
 #define RECORD_START_TIME(clock)
-#define RECORD_END_TIME(clock, tel)
+#define RECORD_END_TIME(clock, tel, msgs)
 #endif
 
-extern SPSCQueue<Client::Order, 65536> order_queue;
+// Built by main in the huge page arena
+extern OrderQueue *order_queue;
+extern OrderTags *order_tags;
 
 constexpr int PORT = 8080;
 
-ssize_t read_exact(int fd, void *buffer, size_t bytes,
-                   std::atomic<bool> &stop_flag) {
-  size_t total_read = 0;
-  uint8_t *buf = static_cast<uint8_t *>(buffer);
+namespace {
 
-  while (total_read < bytes) {
-    if (stop_flag.load())
-      return -3;
+// Most gateways a network thread serves at once
+constexpr size_t MAX_SESSIONS = 64;
 
-    ssize_t n = read(fd, buf + total_read, bytes - total_read);
+// Orders framed per session per round before moving on to the next ready
+// session, so one busy gateway cannot starve the others.
+constexpr size_t SESSION_BATCH = 512;
 
-    if (n > 0) {
-      total_read += n;
+using Sessions = SessionTable<Client::Order, ORDER_QUEUE_SIZE>;
+
+struct IngressStats {
+  Ingress_Telemetry &telemetry; // owned by main, read by the stats reporter
+  bool started = false;
+  chrono::steady_clock::time_point t0{};
+  uint64_t enqueued = 0;
+
+  void mark_started() {
+    if (!started) {
+      started = true;
+      t0 = chrono::steady_clock::now();
+    }
+  }
+};
+
+std::string peer_name(int fd) {
+  sockaddr_in addr{};
+  socklen_t len = sizeof(addr);
+  if (getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+    return "?";
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+  return std::string(ip) + ':' + std::to_string(ntohs(addr.sin_port));
+}
+
+// State shared by the network thread's serve loops
+struct NetContext {
+  std::atomic<bool> &stop_flag;
+  TSCClock hardware_clock;
+  const EngineConfig &config;
+  ShardRouter *router; // null with a single matcher
+  ExecWriter *writer;  // null when execution reports are off
+  Sessions sessions;
+  IngressStats stats;
+};
+
+Sessions::Session *open_session(NetContext &net, int fd) {
+  Sessions::Session *s = net.sessions.open(fd, peer_name(fd));
+  if (!s) {
+    std::cerr << "[Server] Session limit (" << net.sessions.capacity()
+              << ") reached, rejecting connection\n";
+    close(fd);
+    return nullptr;
+  }
+  if (net.writer)
+    net.writer->open(s->tag, fd);
+  cout << "[Session " << s->id << ' ' << s->peer << "] connected ("
+       << net.sessions.active() << " active)\n";
+  return s;
+}
+
+// Hands staged orders on to the shard rings; a no-op with a single matcher
+inline void pump(NetContext &net) {
+  if (net.router)
+    net.router->route(*order_queue, *order_tags);
+}
+
+void close_session(NetContext &net, uint32_t id) {
+  if (net.writer) {
+    if (Sessions::Session *s = net.sessions.get(id))
+      net.writer->close(s->tag);
+  }
+  net.sessions.close(id);
+  if (net.config.exit_when_idle && net.sessions.active() == 0) {
+    cout << "[Server] Last session closed, stopping\n";
+    net.stop_flag.store(true, memory_order_release);
+  }
+}
+
+void serve_epoll(int listen_fd, NetContext &net) {
+  constexpr uint64_t LISTENER = ~uint64_t{0};
+
+  int ep = epoll_create1(EPOLL_CLOEXEC);
+  if (ep < 0) {
+    perror("epoll_create1");
+    exit(EXIT_FAILURE);
+  }
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.u64 = LISTENER;
+  epoll_ctl(ep, EPOLL_CTL_ADD, listen_fd, &ev);
+
+  std::array<epoll_event, MAX_SESSIONS + 1> ready;
+  uint64_t syscalls = 0;
+
+  while (!net.stop_flag.load(memory_order::relaxed)) {
+    pump(net);
+
+    // Nothing can be read until the matcher frees a slot
+    if (order_queue->claim(1).empty()) {
+      _mm_pause();
       continue;
     }
-    if (n == 0) {
-      // client closed connection
-      return 0;
+
+    // Level-triggered and non-blocking: a session with more than one batch
+    // pending stays ready and gets another turn next round.
+    int n = epoll_wait(ep, ready.data(), static_cast<int>(ready.size()), 0);
+    syscalls++;
+    if (n <= 0) {
+      _mm_pause(); // spin wait
+      continue;
     }
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-      // no data available yet
-      _mm_pause();
+
+    for (int i = 0; i < n; i++) {
+      if (ready[i].data.u64 == LISTENER) {
+        int fd;
+        while ((fd = accept4(listen_fd, nullptr, nullptr,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+          syscalls++;
+          if (Sessions::Session *s = open_session(net, fd)) {
+            epoll_event sev{};
+            sev.events = EPOLLIN | EPOLLRDHUP;
+            sev.data.u64 = s->id;
+            epoll_ctl(ep, EPOLL_CTL_ADD, fd, &sev);
+            syscalls++;
+          }
+        }
+        syscalls++;
+        continue;
+      }
+
+      auto id = static_cast<uint32_t>(ready[i].data.u64);
+      Sessions::Session *s = net.sessions.get(id);
+      if (!s)
+        continue; // closed earlier in this round
+
+      RECORD_START_TIME(net.hardware_clock);
+
+      // read() lands directly in free ring slots; complete orders are
+      // published in one store, a trailing partial order is carried over.
+      size_t published = 0;
+      ssize_t r = s->reader.read_into(s->fd, published);
+      if (r == s->reader.RING_FULL) {
+        s->stalls++;
+        continue;
+      }
+      syscalls++;
+
+      if (r > 0) {
+        s->record(static_cast<size_t>(r), published);
+        net.stats.mark_started();
+        net.stats.enqueued += published;
+        RECORD_END_TIME(net.hardware_clock, net.stats.telemetry, published);
+        continue;
+      }
+
+      if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        continue;
+      if (r < 0)
+        perror("read");
+
+      // Closing the fd also drops it from the epoll set
+      close_session(net, id);
+    }
+  }
+
+  close(ep);
+  net.stats.telemetry.record_syscalls(syscalls);
+}
+
+// Returns false if io_uring could not be set up on this kernel
+bool serve_uring(int listen_fd, NetContext &net) {
+  UringIngress uring(UringOptions{.sqpoll = net.config.sqpoll});
+  if (!uring.ok() || !uring.watch_accept(listen_fd))
+    return false;
+
+  cout << "[Server] io_uring ingress" << (net.config.sqpoll ? " (SQPOLL)" : "")
+       << '\n';
+
+  struct Handler {
+    UringIngress &uring;
+    NetContext &net;
+    size_t published = 0;
+
+    void on_accept(int fd) {
+      if (fd < 0) {
+        errno = -fd;
+        perror("io_uring accept");
+        return;
+      }
+      if (Sessions::Session *s = open_session(net, fd)) {
+        if (!uring.watch_recv(fd, s->id))
+          close_session(net, s->id);
+      }
+    }
+
+    void on_data(uint32_t id, const uint8_t *data, size_t len) {
+      Sessions::Session *s = net.sessions.get(id);
+      if (!s)
+        return; // closed while this receive was in flight
+      size_t framed = 0;
+      size_t taken = 0;
+      bool waited = false;
+      // Completed receives are framed into ring slots by the session's
+      // reader, spinning while the matcher frees space.
+      while (taken < len) {
+        size_t batch = 0;
+        taken += s->reader.ingest(data + taken, len - taken, batch);
+        framed += batch;
+        if (taken < len) {
+          waited = true;
+          pump(net);
+          _mm_pause();
+        }
+      }
+      s->stalls += waited;
+      s->record(len, framed);
+      published += framed;
+    }
+
+    void on_close(uint32_t id, int res) {
+      if (res < 0) {
+        errno = -res;
+        perror("io_uring recv");
+      }
+      close_session(net, id);
+    }
+  } handler{uring, net};
+
+  while (!net.stop_flag.load(memory_order::relaxed)) {
+    RECORD_START_TIME(net.hardware_clock);
+
+    // Completions arrive in the order the kernel received the data, so
+    // sessions interleave at receive-buffer granularity.
+    pump(net);
+    handler.published = 0;
+    ssize_t n = uring.poll(handler);
+    if (n == -EAGAIN) {
+      _mm_pause(); // spin wait
       continue;
     }
-    return -1; // real error
+    if (n == 0)
+      continue;
+
+    net.stats.mark_started();
+    net.stats.enqueued += handler.published;
+    RECORD_END_TIME(net.hardware_clock, net.stats.telemetry,
+                    handler.published);
   }
-  return total_read;
+
+  net.stats.telemetry.record_syscalls(uring.syscalls());
+  return true;
 }
 
-void start_tcp_server(std::atomic<bool> &stop_flag, TSCClock hardware_clock) {
-  int server_fd, new_socket;
+int open_listener() {
+  int server_fd;
   struct sockaddr_in address;
   int opt = 1;
-  Ingress_Telemetry ingress_tel;
-  bool started = false;
-  chrono::steady_clock::time_point t0{};
-
-  int enqueued = 0;
-  int not_queued = 0;
-
-  socklen_t addrlen = sizeof(address);
-  SocketBuffer client_buffer = SocketBuffer();
 
   // Creating socket file descriptor
-  if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+  if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
     perror("Socket failed");
     exit(EXIT_FAILURE);
   }
@@ -98,14 +324,11 @@ void start_tcp_server(std::atomic<bool> &stop_flag, TSCClock hardware_clock) {
   }
 
   // Start listening for incoming connections
-  if (listen(server_fd, 3) < 0) {
+  if (listen(server_fd, SOMAXCONN) < 0) {
     perror("listen");
     exit(EXIT_FAILURE);
   }
 
-  cout << "Server listening on port " << PORT << endl;
-  // Accept incoming connection
-
   int flags = fcntl(server_fd, F_GETFL, 0);
   if (flags == -1) {
     perror("fcntl(F_GETFL)");
@@ -117,88 +340,49 @@ void start_tcp_server(std::atomic<bool> &stop_flag, TSCClock hardware_clock) {
     exit(EXIT_FAILURE);
   }
 
-  while (!stop_flag.load(memory_order::relaxed)) {
-    new_socket = accept(server_fd, (struct sockaddr *)&address, &addrlen);
-
-    if (new_socket >= 0) {
-      break;
-    }
-
-    if (errno == EWOULDBLOCK || errno == EAGAIN) {
-      _mm_pause();
-      continue;
-    }
-
-    perror("accept");
-    exit(EXIT_FAILURE);
-  }
-
-  if (new_socket < 0) {
-    std::cerr << "[Server] Shutting down before accepting connection.\n";
-    close(server_fd);
-    return;
-  }
-
-  // Set client socket to non-blocking
-  cout << "Client socket connected\n";
-  flags = fcntl(new_socket, F_GETFL, 0);
-  if (flags == -1) {
-    perror("fcntl(F_GETFL) new_socket");
-    close(new_socket);
-    close(server_fd);
-    exit(EXIT_FAILURE);
-  }
-
-  if (fcntl(new_socket, F_SETFL, flags | O_NONBLOCK) == -1) {
-    perror("fcntl(F_SETFL) new_socket");
-    close(new_socket);
-    close(server_fd);
-    exit(EXIT_FAILURE);
-  }
-
-  while (!stop_flag.load(memory_order::relaxed)) {
-    RECORD_START_TIME(hardware_clock);
-
-    if (!started) {
-      t0 = chrono::steady_clock::now();
-    }
-
-    Client::Order order;
-
-    ssize_t n =
-        client_buffer.read_exact(new_socket, &order, sizeof(order), stop_flag);
-
-    if (n == 0) {
-      std::cout << "Client disconnected\n";
-      stop_flag.store(true, memory_order_release);
-      break;
-    }
-
-    if (n != sizeof(order)) {
-      std::cerr << "read error or short read";
-    }
+  return server_fd;
+}
 
-    while (!order_queue.enqueue(order)) {
-      _mm_pause();
-    }
+} // namespace
 
-    enqueued++;
+void start_tcp_server(std::atomic<bool> &stop_flag, TSCClock hardware_clock,
+                      const EngineConfig &config,
+                      Ingress_Telemetry &telemetry, ShardRouter *router,
+                      ExecWriter *writer) {
+  int server_fd = open_listener();
+  cout << "Server listening on port " << PORT << endl;
 
-    if (!started) {
-      started = true;
-    }
-    RECORD_END_TIME(hardware_clock, ingress_tel);
+  NetContext net{stop_flag,
+                 hardware_clock,
+                 config,
+                 router,
+                 writer,
+                 Sessions(*order_queue, MAX_SESSIONS, SESSION_BATCH,
+                          order_tags),
+                 IngressStats{telemetry}};
+
+  bool served = false;
+  if (config.ingress == IngressBackend::Uring) {
+    served = serve_uring(server_fd, net);
+    if (!served)
+      std::cerr << "[Server] io_uring unavailable, falling back to epoll\n";
   }
+  if (!served)
+    serve_epoll(server_fd, net);
 
+  IngressStats &stats = net.stats;
   double elapsed_s = 0.0;
-  if (started)
-    elapsed_s =
-        std::chrono::duration<double>(chrono::steady_clock::now() - t0).count();
-  ingress_tel.dump(elapsed_s);
-  cout << "Enqueued: " << enqueued << '\n';
-  cout << "Not queued: " << not_queued << '\n';
-
-  // close the socket
-  close(new_socket);
+  if (stats.started)
+    elapsed_s = std::chrono::duration<double>(chrono::steady_clock::now() -
+                                              stats.t0)
+                    .count();
+  stats.telemetry.dump(elapsed_s);
+  cout << "Enqueued: " << stats.enqueued << '\n';
+  cout << "Sessions: " << net.sessions.opened() << " opened, "
+       << net.sessions.active() << " still connected\n";
+  net.sessions.for_each([](const Sessions::Session &s) { s.dump(); });
+
+  // Sessions close their sockets on destruction; the writer keeps its own
+  // copies until the matchers' last reports are out
   close(server_fd);
 }
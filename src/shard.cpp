@@ -0,0 +1,159 @@
+#include "shard.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <emmintrin.h>
+
+// Orders handled per peek/consume round. Caps how long the producer waits
+// for slots the matcher is still reading.
+constexpr size_t MATCH_BATCH = 256;
+
+void Shard::publish_touched(TSCClock hardware_clock) {
+  for (auto [instrument, book] : touched_) {
+    book->book.publish_stats();
+    book->touched = false;
+    if (!snapshot_)
+      continue;
+#ifdef ENABLE_TELEMETRY
+    uint64_t start = hardware_clock.start();
+    snapshot_->publish(instrument, book->book);
+    telemetry_.record_snapshot(
+        hardware_clock.cycles_to_nanoseconds(hardware_clock.stop() - start));
+#else
+    (void)hardware_clock;
+    snapshot_->publish(instrument, book->book);
+    telemetry_.record_snapshot(0);
+#endif
+  }
+  touched_.clear();
+}
+
+void Shard::begin(TSCClock hardware_clock) {
+  exec_.set_clock(hardware_clock);
+  // Background checkpoint of what was restored before the first order
+  if (checkpoint_)
+    checkpoint_->poll(books_, processed_, journaled());
+}
+
+void Shard::report_progress() {
+  auto now = chrono::steady_clock::now();
+  double elapsed = chrono::duration<double>(now - started_at_).count();
+  std::printf("[Shard %zu] %lu processed in %.3fs (%.0f orders/sec)\n", index_,
+              processed_, elapsed, processed_ / elapsed);
+  telemetry_.dump(elapsed);
+
+  size_t levels = 0, resting = 0;
+  books_.for_each([&](InstrumentId, const BookRegistry::Book &b) {
+    levels += b.book.active_levels();
+    resting += b.book.resting_orders();
+  });
+  std::printf("books=%zu active_levels=%zu resting_orders=%zu\n",
+              books_.size(), levels, resting);
+}
+
+void Shard::count_gauges(uint64_t asked) {
+  size_t levels = 0, resting = 0;
+  books_.for_each([&](InstrumentId, const BookRegistry::Book &b) {
+    levels += b.book.active_levels();
+    resting += b.book.resting_orders();
+  });
+  gauges_.books.store(books_.size(), std::memory_order_relaxed);
+  gauges_.levels.store(levels, std::memory_order_relaxed);
+  gauges_.resting.store(resting, std::memory_order_relaxed);
+  gauges_.answered.store(asked, std::memory_order_release);
+}
+
+void Shard::match_batch(std::span<const Client::Order> batch, OrderTags *tags,
+                        TSCClock hardware_clock) {
+  if (!started_) {
+    started_ = true;
+    started_at_ = chrono::steady_clock::now();
+  }
+
+  // Write-ahead: the batch is journaled before any of it is matched
+  if (journal_)
+    journal_->append(batch);
+
+  if (tags)
+    tags->refresh();
+  const uint64_t dequeued = pipeline_stamp();
+  for (const auto &order : batch) {
+    uint32_t session = tags ? tags->next() : OrderTags::NONE;
+    ScopedTimer t(telemetry_, hardware_clock, order.order_type,
+                  tags ? tags->stamps() : OrderStamps{}, dequeued);
+    telemetry_.record_order();
+
+    exec_.begin(session, order.instrument);
+    dispatch(order);
+
+    processed_++;
+  }
+
+  // One conflated depth update per level the batch touched, and one
+  // snapshot per book
+  depth_.flush();
+  publish_touched(hardware_clock);
+}
+
+void Shard::finish() {
+  if (checkpoint_)
+    checkpoint_->write(books_, journaled());
+  count_gauges(gauges_.asked.load(std::memory_order_relaxed));
+
+  if (verbose_ && started_)
+    report_progress();
+  if (verbose_)
+    std::printf("[Shard %zu] processed: %lu books: %zu\n", index_, processed_,
+                books_.size());
+}
+
+void Shard::run(OrderQueue &input, OrderTags &tags,
+                const std::atomic<bool> &closed, TSCClock hardware_clock) {
+  begin(hardware_clock);
+
+  while (true) {
+
+    auto batch = input.peek(MATCH_BATCH);
+    if (batch.empty()) [[unlikely]] {
+      // queue is empty, check whether ingress has closed
+      if (closed.load(std::memory_order::acquire)) {
+        batch = input.peek(MATCH_BATCH);
+        if (batch.empty()) {
+          break; // Queue is empty and network is dead. Safe to exit
+        }
+      } else {
+        answer_gauges();
+        _mm_pause();
+        continue;
+      }
+    }
+
+#ifdef ENABLE_TELEMETRY
+    telemetry_.record_queue_depth(input.occupancy());
+#endif
+    match_batch(batch, &tags, hardware_clock);
+    input.consume(batch.size());
+    answer_gauges();
+
+    if (checkpoint_)
+      checkpoint_->poll(books_, processed_, journaled());
+  }
+
+  finish();
+}
+
+void Shard::replay(std::span<const Client::Order> orders,
+                   TSCClock hardware_clock) {
+  begin(hardware_clock);
+
+  for (size_t off = 0; off < orders.size(); off += MATCH_BATCH) {
+    match_batch(orders.subspan(off, std::min(MATCH_BATCH, orders.size() - off)),
+                nullptr, hardware_clock);
+    answer_gauges();
+
+    if (checkpoint_)
+      checkpoint_->poll(books_, processed_, journaled());
+  }
+
+  finish();
+}
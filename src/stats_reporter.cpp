@@ -0,0 +1,297 @@
+#include "stats_reporter.h"
+
+#include <cstdio>
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t WORDS = sizeof(Client::EngineStats) / sizeof(uint64_t);
+constexpr size_t SEGMENT_BYTES =
+    sizeof(Client::StatsHeader) + sizeof(Client::EngineStats);
+
+// How long a sample waits for a matcher to recount its books
+constexpr auto GAUGE_WAIT = std::chrono::milliseconds(10);
+
+inline std::atomic_ref<uint64_t> word(uint64_t &w) noexcept {
+  return std::atomic_ref<uint64_t>(w);
+}
+
+// p99 of what `live` recorded since `last` was copied from it; `last`
+// becomes a fresh copy
+uint64_t interval_p99(const LatencyHistogram &live,
+                      std::unique_ptr<LatencyHistogram> &last) {
+  auto now = std::make_unique<LatencyHistogram>();
+  now->merge(live);
+  auto interval = std::make_unique<LatencyHistogram>();
+  interval->merge(*now);
+  interval->subtract(*last);
+  last = std::move(now);
+  return interval->percentile(0.99);
+}
+
+uint64_t ns_between(std::chrono::steady_clock::time_point a,
+                    std::chrono::steady_clock::time_point b) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+}
+
+} // namespace
+
+StatsReporter::StatsReporter(std::vector<Shard *> shards,
+                             const Ingress_Telemetry *ingress,
+                             StatsOptions opts)
+    : shards_(std::move(shards)), ingress_(ingress), opts_(std::move(opts)),
+      last_orders_(shards_.size(), 0),
+      started_(std::chrono::steady_clock::now()), last_sample_(started_) {
+  for (size_t i = 0; i < shards_.size(); i++) {
+    last_latency_.push_back(std::make_unique<LatencyHistogram>());
+    last_stages_.emplace_back();
+    for (auto &stage : last_stages_.back())
+      stage = std::make_unique<LatencyHistogram>();
+  }
+
+  if (opts_.shm.empty())
+    return;
+  int fd = shm_open(opts_.shm.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror("[Stats] shm_open");
+    return;
+  }
+  if (ftruncate(fd, 0) < 0 || ftruncate(fd, SEGMENT_BYTES) < 0) {
+    perror("[Stats] ftruncate");
+    close(fd);
+    return;
+  }
+  void *p = mmap(nullptr, SEGMENT_BYTES, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror("[Stats] mmap");
+    return;
+  }
+  base_ = p;
+  bytes_ = SEGMENT_BYTES;
+
+  auto *header = static_cast<Client::StatsHeader *>(base_);
+  header->version = Client::STATS_VERSION;
+  header->max_shards = STATS_MAX_SHARDS;
+  // Readers check the magic last, so it goes in after the rest
+  word(header->magic).store(Client::STATS_MAGIC, std::memory_order_release);
+  segment_ = reinterpret_cast<Client::EngineStats *>(header + 1);
+}
+
+StatsReporter::~StatsReporter() {
+  if (base_) {
+    munmap(base_, bytes_);
+    shm_unlink(opts_.shm.c_str());
+  }
+}
+
+void StatsReporter::run(const std::atomic<bool> &done) {
+  auto next = std::chrono::steady_clock::now() + opts_.interval;
+  while (!done.load(std::memory_order_acquire)) {
+    // Short naps, so shutdown is not held up by a whole interval
+    std::this_thread::sleep_for(
+        std::min<std::chrono::steady_clock::duration>(
+            std::chrono::milliseconds(50),
+            next - std::chrono::steady_clock::now()));
+    if (std::chrono::steady_clock::now() < next)
+      continue;
+    sample();
+    next += opts_.interval;
+  }
+}
+
+void StatsReporter::ask_gauges() {
+  std::vector<uint64_t> asked(shards_.size());
+  for (size_t i = 0; i < shards_.size(); i++)
+    asked[i] = shards_[i]->gauges_.asked.fetch_add(1) + 1;
+
+  // A live matcher answers within a batch; a finished one never does and
+  // keeps the count it made on exit
+  auto deadline = std::chrono::steady_clock::now() + GAUGE_WAIT;
+  for (size_t i = 0; i < shards_.size(); i++)
+    while (shards_[i]->gauges_.answered.load(std::memory_order_acquire) <
+               asked[i] &&
+           std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+void StatsReporter::sample() {
+  ask_gauges();
+
+  auto now = std::chrono::steady_clock::now();
+  const uint64_t interval_ns = ns_between(last_sample_, now);
+  const double seconds = interval_ns / 1e9;
+  last_sample_ = now;
+
+  Client::EngineStats &s = current_;
+  s.updates++;
+  s.uptime_ns = ns_between(started_, now);
+  s.interval_ns = interval_ns;
+  s.shards = std::min(shards_.size(), STATS_MAX_SHARDS);
+  s.memory_locked = opts_.memory_locked;
+  s.network_core = -1;
+
+  for (size_t i = 0; i < shards_.size(); i++) {
+    const Telemetry &t = shards_[i]->telemetry_;
+    const ShardGauges &g = shards_[i]->gauges_;
+
+    // Latency since the previous sample: the merged histogram now, less
+    // the one taken then
+    auto latency = std::make_unique<LatencyHistogram>();
+    t.merge_latency_all(*latency);
+    auto interval = std::make_unique<LatencyHistogram>();
+    interval->merge(*latency);
+    interval->subtract(*last_latency_[i]);
+    last_latency_[i] = std::move(latency);
+
+    uint64_t orders = t.total_orders.load(std::memory_order_relaxed);
+    uint64_t fresh = orders - last_orders_[i];
+    last_orders_[i] = orders;
+
+    ThreadPlacement placed = t.placement.load();
+    auto &stages = last_stages_[i];
+    using S = Telemetry::Stage;
+    uint64_t network = interval_p99(t.latency_by_stage[S::NETWORK],
+                                    stages[S::NETWORK]);
+    uint64_t queue =
+        interval_p99(t.latency_by_stage[S::QUEUE], stages[S::QUEUE]);
+    uint64_t book = interval_p99(t.latency_by_stage[S::BOOK], stages[S::BOOK]);
+
+    Client::StatsShard line{
+        .orders = orders,
+        .matched = t.matched_orders.load(std::memory_order_relaxed),
+        .cancelled = t.cancelled_orders.load(std::memory_order_relaxed),
+        .stale_cancels = t.stale_cancels.load(std::memory_order_relaxed),
+        .orders_per_sec = static_cast<uint64_t>(fresh / seconds),
+        .books = g.books.load(std::memory_order_relaxed),
+        .levels = g.levels.load(std::memory_order_relaxed),
+        .resting = g.resting.load(std::memory_order_relaxed),
+        .p50_ns = interval->percentile(0.50),
+        .p90_ns = interval->percentile(0.90),
+        .p99_ns = interval->percentile(0.99),
+        .p999_ns = interval->percentile(0.999),
+        .max_ns = interval->max(),
+        .network_p99_ns = network,
+        .queue_p99_ns = queue,
+        .book_p99_ns = book,
+        .queue_high_water =
+            t.queue_high_water.load(std::memory_order_relaxed),
+        .core = placed.core,
+        .core_isolated = placed.isolated,
+        .fifo_priority = static_cast<uint64_t>(placed.fifo_priority)};
+    if (i < STATS_MAX_SHARDS)
+      s.shard[i] = line;
+
+    if (opts_.print && fresh > 0)
+      std::printf("[Stats] shard %zu: %.2f M orders/s (%lu total) books=%lu "
+                  "levels=%lu resting=%lu p50=%lu p99=%lu p999=%lu max=%lu "
+                  "ns\n",
+                  i, line.orders_per_sec / 1e6, orders, line.books,
+                  line.levels, line.resting, line.p50_ns, line.p99_ns,
+                  line.p999_ns, line.max_ns);
+    if (opts_.print && fresh > 0 && (network || queue || book))
+      std::printf("[Stats] shard %zu stages p99: network=%lu queue=%lu "
+                  "book=%lu ns, ring high water=%lu\n",
+                  i, network, queue, book, line.queue_high_water);
+  }
+
+  if (ingress_) {
+    uint64_t msgs = ingress_->total_msgs.load(std::memory_order_relaxed);
+    uint64_t fresh = msgs - last_ingress_;
+    last_ingress_ = msgs;
+    s.ingress_msgs = msgs;
+    s.ingress_msgs_per_sec = static_cast<uint64_t>(fresh / seconds);
+    s.ingress_syscalls = ingress_->syscalls.load(std::memory_order_relaxed);
+    ThreadPlacement placed = ingress_->placement.load();
+    s.network_core = placed.core;
+    s.network_core_isolated = placed.isolated;
+    s.network_fifo_priority = static_cast<uint64_t>(placed.fifo_priority);
+    if (opts_.print && fresh > 0)
+      std::printf("[Stats] ingress: %.2f M msgs/s (%lu total) %.1f syscalls "
+                  "per 1M msgs\n",
+                  s.ingress_msgs_per_sec / 1e6, msgs,
+                  ingress_->syscalls_per_million());
+  }
+
+  publish();
+}
+
+void StatsReporter::publish() noexcept {
+  if (!segment_)
+    return;
+  auto *dst = reinterpret_cast<uint64_t *>(segment_);
+  const auto *src = reinterpret_cast<const uint64_t *>(&current_);
+
+  uint64_t seq = word(dst[0]).load(std::memory_order_relaxed);
+  word(dst[0]).store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 1; i < WORDS; i++)
+    word(dst[i]).store(src[i], std::memory_order_relaxed);
+  word(dst[0]).store(seq + 2, std::memory_order_release);
+}
+
+StatsReader::StatsReader(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("[Stats] shm_open");
+    return;
+  }
+  off_t size = lseek(fd, 0, SEEK_END);
+  if (size < static_cast<off_t>(SEGMENT_BYTES)) {
+    std::fprintf(stderr, "[Stats] %s: segment too small\n", name.c_str());
+    close(fd);
+    return;
+  }
+  void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror("[Stats] mmap");
+    return;
+  }
+  base_ = p;
+  bytes_ = size;
+
+  auto *header = static_cast<Client::StatsHeader *>(base_);
+  if (word(header->magic).load(std::memory_order_acquire) !=
+          Client::STATS_MAGIC ||
+      header->version != Client::STATS_VERSION ||
+      header->max_shards != STATS_MAX_SHARDS) {
+    std::fprintf(stderr, "[Stats] %s: not a version %lu stats segment\n",
+                 name.c_str(), Client::STATS_VERSION);
+    return;
+  }
+  stats_ = reinterpret_cast<const Client::EngineStats *>(header + 1);
+}
+
+StatsReader::~StatsReader() {
+  if (base_)
+    munmap(base_, bytes_);
+}
+
+void StatsReader::read(Client::EngineStats &out) noexcept {
+  // The mapping is read-only; atomic_ref needs a non-const object, but
+  // loads never write through it
+  auto *src =
+      const_cast<uint64_t *>(reinterpret_cast<const uint64_t *>(stats_));
+  auto *dst = reinterpret_cast<uint64_t *>(&out);
+
+  while (true) {
+    uint64_t before = word(src[0]).load(std::memory_order_acquire);
+    if (before & 1) {
+      _mm_pause();
+      continue;
+    }
+    for (size_t i = 1; i < WORDS; i++)
+      dst[i] = word(src[i]).load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (word(src[0]).load(std::memory_order_relaxed) == before) {
+      dst[0] = before;
+      return;
+    }
+  }
+}
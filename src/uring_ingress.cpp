@@ -0,0 +1,242 @@
+#include "uring_ingress.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+void *map_ring(size_t len, int fd, off_t offset) {
+  void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, offset);
+  return p == MAP_FAILED ? nullptr : p;
+}
+
+void *map_anon(size_t len) {
+  void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  return p == MAP_FAILED ? nullptr : p;
+}
+
+template <typename T> T *at(void *base, uint32_t offset) {
+  return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+}
+
+} // namespace
+
+UringIngress::UringIngress(UringOptions opts) : opts_(opts) {
+  if (opts_.buffers == 0 || (opts_.buffers & (opts_.buffers - 1)) != 0 ||
+      opts_.buffers > (1u << 15)) {
+    std::fprintf(stderr, "[io_uring] buffer count must be a power of 2\n");
+    return;
+  }
+
+  // Every data completion holds a provided buffer, so a CQ with room for
+  // all of them plus accept/terminal/ENOBUFS entries does not overflow in
+  // practice; if it does, idle_kick() flushes the backlog.
+  io_uring_params params{};
+  params.flags |= IORING_SETUP_CQSIZE;
+  params.cq_entries = opts_.buffers * 2 + SQ_ENTRIES;
+  if (opts_.sqpoll) {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = 1000; // ms before the SQ thread sleeps
+  }
+
+  ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params));
+  syscalls_++;
+  if (ring_fd_ < 0) {
+    perror("io_uring_setup");
+    return;
+  }
+
+  sq_len_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_len_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap)
+    sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+  sq_ptr_ = map_ring(sq_len_, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ptr_ =
+      single_mmap ? sq_ptr_ : map_ring(cq_len_, ring_fd_, IORING_OFF_CQ_RING);
+  sqes_len_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe *>(
+      map_ring(sqes_len_, ring_fd_, IORING_OFF_SQES));
+  if (!sq_ptr_ || !cq_ptr_ || !sqes_) {
+    perror("io_uring mmap");
+    return;
+  }
+
+  sq_head_ = at<unsigned>(sq_ptr_, params.sq_off.head);
+  sq_tail_ = at<unsigned>(sq_ptr_, params.sq_off.tail);
+  sq_mask_ = at<unsigned>(sq_ptr_, params.sq_off.ring_mask);
+  sq_entries_ = at<unsigned>(sq_ptr_, params.sq_off.ring_entries);
+  sq_array_ = at<unsigned>(sq_ptr_, params.sq_off.array);
+  sq_flags_ = at<unsigned>(sq_ptr_, params.sq_off.flags);
+  cq_head_ = at<unsigned>(cq_ptr_, params.cq_off.head);
+  cq_tail_ = at<unsigned>(cq_ptr_, params.cq_off.tail);
+  cq_mask_ = at<unsigned>(cq_ptr_, params.cq_off.ring_mask);
+  cqes_ = at<io_uring_cqe>(cq_ptr_, params.cq_off.cqes);
+
+  // Provided-buffer ring: page-aligned array of io_uring_buf whose tail is
+  // overlaid on the first entry, plus the receive buffers themselves.
+  buf_ring_len_ = opts_.buffers * sizeof(io_uring_buf);
+  buf_ring_ = static_cast<io_uring_buf *>(map_anon(buf_ring_len_));
+  buffers_ = static_cast<uint8_t *>(
+      map_anon(size_t(opts_.buffers) * opts_.buffer_size));
+  if (!buf_ring_ || !buffers_) {
+    perror("io_uring buffer mmap");
+    return;
+  }
+
+  io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+  reg.ring_entries = opts_.buffers;
+  reg.bgid = BUFFER_GROUP;
+  syscalls_++;
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING,
+              &reg, 1) < 0) {
+    perror("io_uring_register(PBUF_RING)");
+    return;
+  }
+
+  for (unsigned bid = 0; bid < opts_.buffers; bid++)
+    recycle(static_cast<uint16_t>(bid));
+  publish_buffers();
+
+  ready_ = true;
+}
+
+UringIngress::~UringIngress() {
+  if (buffers_)
+    munmap(buffers_, size_t(opts_.buffers) * opts_.buffer_size);
+  if (buf_ring_)
+    munmap(buf_ring_, buf_ring_len_);
+  if (sqes_)
+    munmap(sqes_, sqes_len_);
+  if (cq_ptr_ && cq_ptr_ != sq_ptr_)
+    munmap(cq_ptr_, cq_len_);
+  if (sq_ptr_)
+    munmap(sq_ptr_, sq_len_);
+  if (ring_fd_ >= 0)
+    close(ring_fd_);
+}
+
+int UringIngress::enter(unsigned to_submit, unsigned flags) {
+  syscalls_++;
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                                  0, flags, nullptr, 0));
+}
+
+void UringIngress::publish_buffers() noexcept {
+  // The ring tail lives in the resv field of the first entry
+  auto *tail = reinterpret_cast<uint16_t *>(
+      reinterpret_cast<uint8_t *>(buf_ring_) +
+      offsetof(io_uring_buf, resv));
+  __atomic_store_n(tail, buf_tail_, __ATOMIC_RELEASE);
+}
+
+void UringIngress::idle_kick() {
+  // Without SQPOLL, completions can sit in pending task work until this
+  // task enters the kernel. With SQPOLL, the poller may have gone to sleep.
+  // Overflowed completions are only flushed back by GETEVENTS.
+  unsigned flags = __atomic_load_n(sq_flags_, __ATOMIC_ACQUIRE);
+  if (!opts_.sqpoll || (flags & IORING_SQ_CQ_OVERFLOW)) {
+    enter(0, IORING_ENTER_GETEVENTS);
+  } else if (flags & IORING_SQ_NEED_WAKEUP) {
+    enter(0, IORING_ENTER_SQ_WAKEUP);
+  }
+}
+
+io_uring_sqe *UringIngress::next_sqe() {
+  // Entries are filled ahead of the shared tail and published by submit()
+  unsigned tail = *sq_tail_ + unsubmitted_;
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= *sq_entries_) {
+    // Full: hand what is queued to the kernel (or the SQ thread) first
+    submit();
+    for (int spins = 0; spins < 1'000'000; spins++) {
+      if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) < *sq_entries_)
+        break;
+    }
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= *sq_entries_)
+      return nullptr;
+  }
+
+  unsigned idx = tail & *sq_mask_;
+  io_uring_sqe *sqe = &sqes_[idx];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sq_array_[idx] = idx;
+  return sqe;
+}
+
+bool UringIngress::submit() {
+  if (unsubmitted_ == 0)
+    return true;
+
+  // Publish the filled entries, then tell the kernel about them
+  __atomic_store_n(sq_tail_, *sq_tail_ + unsubmitted_, __ATOMIC_RELEASE);
+  unsigned count = unsubmitted_;
+  unsubmitted_ = 0;
+
+  int ret = 0;
+  if (opts_.sqpoll) {
+    // The tail store must be visible before we sample NEED_WAKEUP
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+      ret = enter(0, IORING_ENTER_SQ_WAKEUP);
+  } else {
+    ret = enter(count, 0);
+  }
+
+  if (ret < 0) {
+    perror("io_uring_enter");
+    return false;
+  }
+  return true;
+}
+
+bool UringIngress::arm_accept() {
+  io_uring_sqe *sqe = next_sqe();
+  if (!sqe)
+    return false;
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = listen_fd_;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = KIND_ACCEPT << 32;
+  unsubmitted_++;
+  accept_armed_ = true;
+  return true;
+}
+
+bool UringIngress::arm_recv(uint32_t session) {
+  io_uring_sqe *sqe = next_sqe();
+  if (!sqe)
+    return false;
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = recv_fds_[session];
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = BUFFER_GROUP;
+  sqe->user_data = KIND_RECV << 32 | session;
+  unsubmitted_++;
+  return true;
+}
+
+bool UringIngress::watch_accept(int listen_fd) {
+  listen_fd_ = listen_fd;
+  return arm_accept() && submit();
+}
+
+bool UringIngress::watch_recv(int fd, uint32_t session) {
+  if (session >= recv_fds_.size())
+    recv_fds_.resize(session + 1, -1);
+  recv_fds_[session] = fd;
+  if (arm_recv(session) && submit())
+    return true;
+  recv_fds_[session] = -1; // the caller closes the session
+  return false;
+}
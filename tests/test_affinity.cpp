@@ -0,0 +1,33 @@
+#include "affinity.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(AffinityTest, ParsesKernelCpuLists) {
+  EXPECT_EQ(parse_cpu_list("2-5,7"), (std::vector<int>{2, 3, 4, 5, 7}));
+  EXPECT_EQ(parse_cpu_list("0"), (std::vector<int>{0}));
+  EXPECT_EQ(parse_cpu_list("1,3-4"), (std::vector<int>{1, 3, 4}));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+  EXPECT_EQ(parse_cpu_list("1,x,3"), (std::vector<int>{1}));
+}
+
+TEST(AffinityTest, PlacementReportsWhatTookEffect) {
+  std::thread t([] {});
+  EXPECT_EQ(place_thread(t.native_handle(), "test", -1, 50).core, -1);
+  ThreadPlacement bad = place_thread(t.native_handle(), "test", 1 << 20, 0);
+  EXPECT_EQ(bad.core, -1);
+  EXPECT_EQ(bad.fifo_priority, 0);
+
+  ThreadPlacement pinned = place_thread(t.native_handle(), "test", 0, 0);
+  EXPECT_EQ(pinned.core, 0);
+  EXPECT_EQ(pinned.fifo_priority, 0);
+  t.join();
+
+  EXPECT_EQ(describe(ThreadPlacement{}), "floating");
+  EXPECT_EQ(describe({.core = 3, .isolated = true, .fifo_priority = 50}),
+            "core 3, isolated, SCHED_FIFO 50");
+
+  PlacementGauge gauge;
+  gauge.record({.core = 2, .isolated = false, .fifo_priority = 0});
+  EXPECT_EQ(describe(gauge.load()), "core 2, shared");
+}
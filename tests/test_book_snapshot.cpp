@@ -0,0 +1,171 @@
+#include "book_snapshot.h"
+#include "orderbook.h"
+#include "shard.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::string segment_name(const char *test) {
+  return "/fastbook_test_" + std::string(test) + "_" +
+         std::to_string(getpid());
+}
+
+} // namespace
+
+TEST(BookSnapshotTest, ReaderSeesTopLevelsBestFirst) {
+  std::string name = segment_name("top");
+  SnapshotWriter writer(name);
+  ASSERT_TRUE(writer.ok());
+  SnapshotReader reader(name);
+  ASSERT_TRUE(reader.ok());
+
+  Orderbook book;
+  for (uint64_t i = 0; i < 15; i++)
+    book.addOrder(i + 1, 100 - i, 10 + i, true, 1); // bids 100..86
+  book.addOrder(100, 105, 7, false, 1);
+  book.addOrder(101, 105, 3, false, 1);
+  writer.publish(42, book);
+
+  Client::BookSnapshot snap;
+  ASSERT_TRUE(reader.read(42, snap));
+  EXPECT_EQ(snap.updates, 1u);
+  EXPECT_EQ(snap.seq % 2, 0u);
+  ASSERT_EQ(snap.bid_count, SNAPSHOT_DEPTH);
+  EXPECT_EQ(snap.bids[0].price, 100u);
+  EXPECT_EQ(snap.bids[0].volume, 10u);
+  EXPECT_EQ(snap.bids[SNAPSHOT_DEPTH - 1].price, 100u - SNAPSHOT_DEPTH + 1);
+  ASSERT_EQ(snap.ask_count, 1u);
+  EXPECT_EQ(snap.asks[0].price, 105u);
+  EXPECT_EQ(snap.asks[0].volume, 10u);
+  EXPECT_EQ(snap.asks[0].orders, 2u);
+
+  // Untouched slots read as empty, up to the last instrument id
+  ASSERT_TRUE(reader.read(7, snap));
+  EXPECT_EQ(snap.updates, 0u);
+  EXPECT_EQ(snap.bid_count, 0u);
+  EXPECT_TRUE(reader.read(std::numeric_limits<InstrumentId>::max(), snap));
+  EXPECT_EQ(writer.dropped(), 0u);
+}
+
+TEST(BookSnapshotTest, IdsPastTheSlotsAreCountedAndRefused) {
+  std::string name = segment_name("slots");
+  SnapshotWriter writer(name, 16);
+  ASSERT_TRUE(writer.ok());
+  SnapshotReader reader(name);
+  Orderbook book;
+  book.addOrder(1, 100, 5, true, 1);
+  writer.publish(15, book);
+  writer.publish(16, book);
+  writer.publish(2000, book);
+
+  Client::BookSnapshot snap;
+  ASSERT_TRUE(reader.read(15, snap));
+  EXPECT_EQ(snap.bid_count, 1u);
+  EXPECT_FALSE(reader.read(16, snap));
+  EXPECT_EQ(writer.dropped(), 2u);
+}
+
+TEST(BookSnapshotTest, ReusedSegmentIsClearedNotTruncated) {
+  std::string name = segment_name("reuse");
+  // A run that never unlinked its segment, with a reader still attached
+  SnapshotWriter stale(name, 64);
+  ASSERT_TRUE(stale.ok());
+  Orderbook book;
+  book.addOrder(1, 100, 5, true, 1);
+  stale.publish(40, book);
+  SnapshotReader reader(name);
+  ASSERT_TRUE(reader.ok());
+
+  SnapshotWriter writer(name, 8);
+  ASSERT_TRUE(writer.ok());
+  EXPECT_EQ(writer.slots(), 8u);
+  // Still mapped (a truncate would SIGBUS here), and emptied
+  Client::BookSnapshot snap;
+  ASSERT_TRUE(reader.read(40, snap));
+  EXPECT_EQ(snap.updates, 0u);
+  EXPECT_EQ(snap.bid_count, 0u);
+  EXPECT_EQ(snap.seq % 2, 0u);
+  EXPECT_GT(snap.seq, 0u);
+}
+
+TEST(BookSnapshotTest, ConcurrentReadsAreNeverTorn) {
+  std::string name = segment_name("torn");
+  SnapshotWriter writer(name);
+  ASSERT_TRUE(writer.ok());
+
+  // Every publish moves all levels to the same volume, so a torn copy would
+  // mix volumes
+  std::atomic<bool> stop{false};
+  std::thread matcher([&] {
+    Orderbook book;
+    for (uint64_t i = 0; i < SNAPSHOT_DEPTH; i++)
+      book.addOrder(i + 1, 100 + i, 1, false, 1);
+    while (!stop.load(std::memory_order_relaxed)) {
+      for (uint64_t i = 0; i < SNAPSHOT_DEPTH; i++)
+        book.addOrder(1000 + i, 100 + i, 1, false, 1);
+      writer.publish(0, book);
+      for (uint64_t i = 0; i < SNAPSHOT_DEPTH; i++)
+        book.removeOrder(1000 + i);
+      writer.publish(0, book);
+    }
+  });
+
+  SnapshotReader reader(name);
+  ASSERT_TRUE(reader.ok());
+  Client::BookSnapshot snap;
+  // On one CPU the reader can otherwise finish before the matcher runs
+  do {
+    std::this_thread::yield();
+    ASSERT_TRUE(reader.read(0, snap));
+  } while (snap.updates == 0);
+  uint64_t consistent = 0;
+  for (int n = 0; n < 200000; n++) {
+    ASSERT_TRUE(reader.read(0, snap));
+    if (snap.updates == 0)
+      continue;
+    ASSERT_EQ(snap.ask_count, SNAPSHOT_DEPTH);
+    for (size_t i = 1; i < SNAPSHOT_DEPTH; i++)
+      ASSERT_EQ(snap.asks[i].volume, snap.asks[0].volume);
+    consistent++;
+  }
+  stop = true;
+  matcher.join();
+  EXPECT_GT(consistent, 0u);
+}
+
+TEST(BookSnapshotTest, ShardPublishesBooksItDispatchedTo) {
+  std::string name = segment_name("shard");
+  SnapshotWriter writer(name);
+  ASSERT_TRUE(writer.ok());
+
+  auto shard = std::make_unique<Shard>(0, ShardOptions{.snapshot = &writer});
+  std::atomic<bool> closed{false};
+  for (InstrumentId inst : {3, 5, 3}) {
+    Client::Order o{};
+    o.instrument = inst;
+    o.order_type = OrderType::Limit;
+    o.side = Side::Bid;
+    o.price = 50;
+    o.quantity = 2;
+    shard->queue_.enqueue(o);
+  }
+  closed = true;
+  TSCClock clock;
+  shard->set_verbose(false);
+  shard->run(shard->queue_, shard->tags_, closed, clock);
+
+  SnapshotReader reader(name);
+  Client::BookSnapshot snap;
+  ASSERT_TRUE(reader.read(3, snap));
+  EXPECT_EQ(snap.updates, 1u); // one publish per book per batch
+  EXPECT_EQ(snap.bids[0].volume, 4u);
+  ASSERT_TRUE(reader.read(5, snap));
+  EXPECT_EQ(snap.bids[0].volume, 2u);
+  EXPECT_EQ(shard->telemetry_.snapshots.load(), 2u);
+}
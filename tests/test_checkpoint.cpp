@@ -0,0 +1,154 @@
+#include "checkpoint.h"
+#include <cstdlib>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class CheckpointTest : public ::testing::Test {
+protected:
+  std::string dir_;
+  Telemetry telemetry_;
+
+  void SetUp() override {
+    char tmpl[] = "/tmp/fastbook_checkpoint_XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    dir_ = tmpl;
+  }
+
+  void TearDown() override { fs::remove_all(dir_); }
+
+  static void add(BookRegistry::Book &b, Price price, Volume qty, bool is_buy,
+                  AccountId account = 7) {
+    b.book.addOrder(b.next_order_id++, price, qty, is_buy, account);
+  }
+
+  // "price:id/remaining,..." per level, best first
+  static std::string describe(const Orderbook &book, Side side) {
+    std::string out;
+    book.top(side, SIZE_MAX, [&](const Level &level) {
+      out += std::to_string(level.price) + ":";
+      level.for_each([&](const Matching::Order &o) {
+        out += std::to_string(o.order_id) + "/" +
+               std::to_string(o.quantity_remaining) + ",";
+      });
+      out += " ";
+    });
+    return out;
+  }
+
+  CheckpointRestoreStats restore(BookRegistry &into, JournalPosition &from) {
+    return restore_checkpoints(
+        dir_, [&](InstrumentId) -> BookRegistry & { return into; }, from);
+  }
+};
+
+TEST_F(CheckpointTest, RestoresLevelsFifoAndIds) {
+  BookRegistry books(telemetry_);
+  BookRegistry::Book &b = books.get(3);
+  add(b, 100, 10, true);
+  add(b, 100, 20, true);
+  add(b, 99, 5, true);
+  add(b, 105, 8, false);
+  add(b, 105, 9, false);
+  add(b, 110, 4, false);
+  add(b, 105, 12, true); // fills order 4 and part of order 5
+  add(books.get(9), 50, 1, false);
+
+  Checkpointer checkpointer(dir_, 1, 0, 1);
+  ASSERT_TRUE(checkpointer.write(books, 42));
+
+  Telemetry restored_telemetry;
+  BookRegistry restored(restored_telemetry);
+  JournalPosition from;
+  auto stats = restore(restored, from);
+
+  EXPECT_EQ(stats.files, 1u);
+  EXPECT_EQ(stats.books, 2u);
+  EXPECT_EQ(stats.orders, 6u);
+  EXPECT_EQ(stats.duplicates, 0u);
+  EXPECT_EQ(from.generation, 1u);
+  EXPECT_EQ(from.applied, std::vector<uint64_t>{42});
+
+  BookRegistry::Book &r = restored.get(3);
+  EXPECT_EQ(r.next_order_id, b.next_order_id);
+  EXPECT_EQ(describe(r.book, Side::Bid), describe(b.book, Side::Bid));
+  EXPECT_EQ(describe(r.book, Side::Ask), describe(b.book, Side::Ask));
+  EXPECT_EQ(describe(r.book, Side::Ask), "105:5/5, 110:6/4, ");
+  EXPECT_EQ(r.book.totalBidVolume(), b.book.totalBidVolume());
+  ASSERT_NE(restored.find(9), nullptr);
+  EXPECT_EQ(restored.find(9)->book.resting_orders(), 1u);
+
+  // The restored book keeps matching and cancelling by id
+  r.book.matchMarketOrder(true, 7);
+  EXPECT_EQ(describe(r.book, Side::Ask), "110:6/2, ");
+  r.book.removeOrder(1);
+  EXPECT_EQ(describe(r.book, Side::Bid), "100:2/20, 99:3/5, ");
+}
+
+TEST_F(CheckpointTest, ForkedCheckpointHoldsTheBooksAtFork) {
+  BookRegistry books(telemetry_);
+  BookRegistry::Book &b = books.get(0);
+  for (int i = 0; i < 1000; i++)
+    add(b, 100 + i % 10, 1, true);
+
+  Checkpointer checkpointer(dir_, 1, 0, 1, CheckpointOptions{.every = 500});
+  checkpointer.poll(books, 0, 0); // the first poll always forks
+  checkpointer.wait();
+  checkpointer.poll(books, 499, 0);
+  EXPECT_EQ(checkpointer.forks(), 1u);
+  checkpointer.poll(books, 500, 0);
+  EXPECT_EQ(checkpointer.forks(), 2u);
+
+  // Changes after the fork are not in the file
+  add(b, 200, 1, true);
+  checkpointer.wait();
+  EXPECT_EQ(checkpointer.written(), 2u);
+  EXPECT_EQ(checkpointer.failed(), 0u);
+
+  Telemetry restored_telemetry;
+  BookRegistry restored(restored_telemetry);
+  JournalPosition from;
+  EXPECT_EQ(restore(restored, from).orders, 1000u);
+  EXPECT_EQ(restored.get(0).book.bestBid()->first, 109u);
+}
+
+TEST_F(CheckpointTest, IncompleteSetFallsBackToOlderGeneration) {
+  BookRegistry books(telemetry_);
+  add(books.get(0), 100, 1, true);
+  Checkpointer(dir_, 1, 0, 1).write(books, 1);
+
+  // Generation 2 ran two shards, but only shard 0 wrote its file
+  add(books.get(0), 101, 1, true);
+  Checkpointer(dir_, 2, 0, 2).write(books, 2);
+  EXPECT_EQ(next_checkpoint_generation(dir_), 3u);
+
+  Telemetry restored_telemetry;
+  BookRegistry restored(restored_telemetry);
+  JournalPosition from;
+  auto stats = restore(restored, from);
+  EXPECT_EQ(stats.generation, 1u);
+  EXPECT_EQ(stats.orders, 1u);
+  EXPECT_EQ(from.generation, 1u);
+}
+
+TEST_F(CheckpointTest, TruncatedFileIsNotLoaded) {
+  BookRegistry books(telemetry_);
+  for (int i = 0; i < 100; i++)
+    add(books.get(0), 100 + i, 1, false);
+  Checkpointer checkpointer(dir_, 1, 0, 1);
+  ASSERT_TRUE(checkpointer.write(books, 0));
+  fs::resize_file(checkpointer.path(),
+                  fs::file_size(checkpointer.path()) - 16);
+
+  Telemetry restored_telemetry;
+  BookRegistry restored(restored_telemetry);
+  JournalPosition from;
+  auto stats = restore(restored, from);
+  EXPECT_EQ(stats.files, 0u);
+  EXPECT_EQ(restored.size(), 0u);
+  EXPECT_EQ(from.generation, 0u);
+}
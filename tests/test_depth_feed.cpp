@@ -0,0 +1,134 @@
+#include "depth_feed.h"
+#include "depth_publisher.h"
+#include "orderbook.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+class DepthTrackerTest : public ::testing::Test {
+protected:
+  std::unique_ptr<DepthQueue> ring_ = std::make_unique<DepthQueue>();
+  Telemetry telemetry_;
+  DepthTracker tracker_{*ring_, telemetry_};
+  Orderbook book_;
+
+  void SetUp() override { book_.set_depth_tracker(&tracker_, 3); }
+
+  std::vector<Client::DepthUpdate> drain() {
+    std::vector<Client::DepthUpdate> out;
+    while (auto u = ring_->dequeue())
+      out.push_back(*u);
+    return out;
+  }
+};
+
+TEST_F(DepthTrackerTest, RepeatedChangesToALevelAreConflated) {
+  for (uint64_t id = 1; id <= 10; id++)
+    book_.addOrder(id, 100, 5, true, 1);
+  book_.removeOrder(4);
+  EXPECT_EQ(tracker_.flush(), 1u);
+
+  auto updates = drain();
+  ASSERT_EQ(updates.size(), 1u);
+  EXPECT_EQ(updates[0].instrument, 3u);
+  EXPECT_EQ(updates[0].side, Side::Bid);
+  EXPECT_EQ(updates[0].price, 100u);
+  EXPECT_EQ(updates[0].volume, 45u);
+  EXPECT_EQ(updates[0].orders, 9u);
+  EXPECT_EQ(updates[0].flags, Client::DEPTH_END_OF_BATCH);
+
+  EXPECT_EQ(telemetry_.depth_events.load(), 11u);
+  EXPECT_EQ(telemetry_.depth_updates.load(), 1u);
+}
+
+TEST_F(DepthTrackerTest, SweptLevelsPublishZeroVolume) {
+  book_.addOrder(1, 100, 10, false, 1);
+  book_.addOrder(2, 101, 10, false, 1);
+  tracker_.flush();
+  drain();
+
+  // Takes all of 100 and half of 101, resting nothing
+  book_.addOrder(3, 101, 15, true, 2);
+  EXPECT_EQ(tracker_.flush(), 2u);
+
+  auto updates = drain();
+  ASSERT_EQ(updates.size(), 2u);
+  EXPECT_EQ(updates[0].side, Side::Ask);
+  EXPECT_EQ(updates[0].price, 100u);
+  EXPECT_EQ(updates[0].volume, 0u);
+  EXPECT_EQ(updates[0].flags, 0u);
+  EXPECT_EQ(updates[1].price, 101u);
+  EXPECT_EQ(updates[1].volume, 5u);
+  EXPECT_EQ(updates[1].flags, Client::DEPTH_END_OF_BATCH);
+}
+
+TEST_F(DepthTrackerTest, LevelRecreatedInOneBatchIsPublishedOnce) {
+  book_.addOrder(1, 100, 10, true, 1);
+  book_.removeOrder(1);
+  book_.addOrder(2, 100, 7, true, 1);
+  tracker_.flush();
+
+  auto updates = drain();
+  ASSERT_EQ(updates.size(), 1u);
+  EXPECT_EQ(updates[0].volume, 7u);
+}
+
+TEST_F(DepthTrackerTest, QuietBatchPublishesNothing) {
+  book_.matchMarketOrder(true, 10); // empty book
+  book_.removeOrder(42);            // stale cancel
+  EXPECT_FALSE(tracker_.pending());
+  EXPECT_EQ(tracker_.flush(), 0u);
+  EXPECT_TRUE(drain().empty());
+}
+
+TEST(DepthPublisherTest, PacksUpdatesIntoSequencedDatagrams) {
+  int rx = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(rx, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(rx, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+  socklen_t len = sizeof(addr);
+  getsockname(rx, reinterpret_cast<sockaddr *>(&addr), &len);
+
+  int fd = open_depth_feed("127.0.0.1", ntohs(addr.sin_port));
+  ASSERT_GE(fd, 0);
+
+  auto ring = std::make_unique<DepthQueue>();
+  constexpr size_t N = 100; // more than one datagram holds
+  for (uint64_t i = 0; i < N; i++)
+    ring->enqueue({1, Side::Ask, 0, 1, 1000 + i, i});
+
+  DepthPublisher publisher({ring.get()}, fd);
+  std::atomic<bool> done{true};
+  publisher.run(done);
+  EXPECT_EQ(publisher.updates(), N);
+  EXPECT_EQ(publisher.dropped(), 0u);
+  ASSERT_GT(publisher.datagrams(), 1u);
+
+  uint64_t expect_seq = 0;
+  uint64_t next_price = 1000;
+  for (uint64_t d = 0; d < publisher.datagrams(); d++) {
+    uint8_t buf[2048];
+    ssize_t r = recv(rx, buf, sizeof(buf), 0);
+    ASSERT_GT(r, 0);
+    Client::DepthPacketHeader hdr;
+    std::memcpy(&hdr, buf, sizeof(hdr));
+    EXPECT_EQ(hdr.seq, expect_seq++);
+    EXPECT_EQ(hdr.shard, 0u);
+    ASSERT_EQ(size_t(r), sizeof(hdr) + hdr.count * sizeof(Client::DepthUpdate));
+    for (size_t i = 0; i < hdr.count; i++) {
+      Client::DepthUpdate u;
+      std::memcpy(&u, buf + sizeof(hdr) + i * sizeof(u), sizeof(u));
+      EXPECT_EQ(u.price, next_price++);
+    }
+  }
+  EXPECT_EQ(next_price, 1000 + N);
+  close(rx);
+}
@@ -0,0 +1,201 @@
+#include "exec_report.h"
+#include "orderbook.h"
+#include "session_tags.h"
+#include "telemetry.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+class ExecReportTest : public ::testing::Test {
+protected:
+  std::unique_ptr<ExecQueue> ring_ = std::make_unique<ExecQueue>();
+  Telemetry telemetry_;
+  ExecSink sink_{*ring_, telemetry_};
+  Orderbook book_;
+
+  void SetUp() override { book_.set_exec_sink(&sink_); }
+
+  std::vector<Client::ExecReport> drain() {
+    std::vector<Client::ExecReport> out;
+    while (auto r = ring_->dequeue())
+      out.push_back(*r);
+    return out;
+  }
+};
+
+TEST_F(ExecReportTest, CrossingLimitFillsBothSides) {
+  sink_.begin(1, 7);
+  book_.addOrder(1, 100, 50, false, 11); // ask @100, session 1
+  sink_.begin(2, 7);
+  book_.addOrder(2, 101, 30, true, 12); // bid @101, session 2
+
+  auto reports = drain();
+  ASSERT_EQ(reports.size(), 4u);
+
+  EXPECT_EQ(reports[0].type, ExecType::Ack);
+  EXPECT_EQ(reports[0].session, 1u);
+  EXPECT_EQ(reports[0].instrument, 7u);
+  EXPECT_EQ(reports[0].leaves, 50u);
+
+  EXPECT_EQ(reports[1].type, ExecType::Ack);
+  EXPECT_EQ(reports[1].session, 2u);
+
+  // Resting side first, at the resting price
+  EXPECT_EQ(reports[2].type, ExecType::Fill);
+  EXPECT_EQ(reports[2].session, 1u);
+  EXPECT_EQ(reports[2].order_id, 1u);
+  EXPECT_EQ(reports[2].price, 100u);
+  EXPECT_EQ(reports[2].quantity, 30u);
+  EXPECT_EQ(reports[2].leaves, 20u);
+
+  EXPECT_EQ(reports[3].type, ExecType::Fill);
+  EXPECT_EQ(reports[3].session, 2u);
+  EXPECT_EQ(reports[3].order_id, 2u);
+  EXPECT_EQ(reports[3].side, Side::Bid);
+  EXPECT_EQ(reports[3].leaves, 0u);
+
+  EXPECT_EQ(telemetry_.exec_reports.load(), 4u);
+}
+
+TEST_F(ExecReportTest, MarketRemainderIsCancelledOrRejected) {
+  sink_.begin(1, 0);
+  book_.addOrder(1, 100, 10, false, 11);
+  sink_.begin(3, 0);
+  book_.matchMarketOrder(true, 15, 901);
+  book_.matchMarketOrder(true, 5, 902); // book is empty now
+
+  auto reports = drain();
+  ASSERT_EQ(reports.size(), 5u);
+  EXPECT_EQ(reports[1].type, ExecType::Fill);
+  EXPECT_EQ(reports[1].session, 1u);
+  EXPECT_EQ(reports[2].type, ExecType::Fill);
+  EXPECT_EQ(reports[2].session, 3u);
+  EXPECT_EQ(reports[2].leaves, 5u);
+  EXPECT_EQ(reports[2].order_id, 901u);
+  EXPECT_EQ(reports[3].type, ExecType::Cancelled);
+  EXPECT_EQ(reports[3].session, 3u);
+  EXPECT_EQ(reports[3].order_id, 901u);
+  EXPECT_EQ(reports[3].quantity, 5u); // the unfilled remainder
+  EXPECT_EQ(reports[4].type, ExecType::Rejected);
+  EXPECT_EQ(reports[4].order_id, 902u);
+  EXPECT_EQ(reports[4].quantity, 5u);
+}
+
+TEST_F(ExecReportTest, CancelReportsWhatWasLeft) {
+  sink_.begin(1, 0);
+  book_.addOrder(1, 100, 10, true, 11);
+  book_.matchMarketOrder(false, 4);
+  book_.removeOrder(1);
+
+  auto reports = drain();
+  ASSERT_EQ(reports.size(), 4u);
+  EXPECT_EQ(reports[3].type, ExecType::Cancelled);
+  EXPECT_EQ(reports[3].order_id, 1u);
+  EXPECT_EQ(reports[3].quantity, 6u);
+}
+
+TEST_F(ExecReportTest, CancelGoesToOwnerAndStaleCancelIsRejected) {
+  sink_.begin(1, 0);
+  book_.addOrder(1, 100, 10, true, 11);
+  sink_.begin(2, 0);
+  book_.removeOrder(1);
+  book_.removeOrder(1);
+
+  auto reports = drain();
+  ASSERT_EQ(reports.size(), 3u);
+  EXPECT_EQ(reports[1].type, ExecType::Cancelled);
+  EXPECT_EQ(reports[1].session, 1u); // the owner, not the canceller
+  EXPECT_EQ(reports[1].price, 100u);
+  EXPECT_EQ(reports[2].type, ExecType::Rejected);
+  EXPECT_EQ(reports[2].session, 2u);
+}
+
+TEST_F(ExecReportTest, SessionZeroIsSilent) {
+  sink_.begin(SessionTags<16>::NONE, 0);
+  book_.addOrder(1, 100, 10, true, 11);
+  book_.matchMarketOrder(false, 10);
+  EXPECT_TRUE(drain().empty());
+  EXPECT_EQ(book_.resting_orders(), 0u);
+}
+
+TEST(SessionTagsTest, MarksFollowRingOrder) {
+  SessionTags<64> tags;
+  tags.tag(5, 3);
+  tags.tag(5, 1); // same session, no new mark
+  tags.tag(8, 2);
+  tags.tag(5, 1);
+
+  std::vector<uint32_t> seen;
+  tags.refresh();
+  for (int i = 0; i < 7; i++)
+    seen.push_back(tags.next());
+  EXPECT_EQ(seen, (std::vector<uint32_t>{5, 5, 5, 5, 8, 8, 5}));
+}
+
+TEST(SessionTagsTest, UntaggedOrdersHaveNoSession) {
+  SessionTags<64> tags;
+  tags.refresh();
+  EXPECT_EQ(tags.next(), SessionTags<64>::NONE);
+
+  // A mark published later picks up at its own position
+  tags.tag(SessionTags<64>::NONE, 1);
+  tags.tag(4, 1);
+  tags.refresh();
+  EXPECT_EQ(tags.next(), 4u);
+}
+
+TEST(SessionTagsTest, StampsTravelWithTheirOrders) {
+  SessionTags<64> tags;
+  tags.tag(5, 2, {10, 20});
+  tags.tag(5, 1, {10, 20}); // same batch, no new mark
+  tags.tag(5, 1, {30, 40}); // same session, new batch
+  tags.tag(6, 1);           // unstamped
+
+  std::vector<uint64_t> enqueued;
+  tags.refresh();
+  for (int i = 0; i < 5; i++) {
+    tags.next();
+    enqueued.push_back(tags.stamps().enqueued);
+  }
+  EXPECT_EQ(enqueued, (std::vector<uint64_t>{20, 20, 20, 40, 0}));
+  EXPECT_EQ(tags.stamps().received, 0u);
+}
+
+TEST_F(ExecReportTest, RestingSideComesFromTheLevel) {
+  sink_.begin(1, 0);
+  book_.addOrder(1, 100, 5, true, 11);
+  book_.addOrder(2, 101, 5, false, 11);
+  book_.removeOrder(2);
+  book_.addOrder(3, 100, 5, false, 12); // fills the resting bid
+
+  auto reports = drain();
+  ASSERT_EQ(reports.size(), 6u);
+  EXPECT_EQ(reports[2].type, ExecType::Cancelled);
+  EXPECT_EQ(reports[2].side, Side::Ask);
+  EXPECT_EQ(reports[2].price, 101u);
+  EXPECT_EQ(reports[4].type, ExecType::Fill);
+  EXPECT_EQ(reports[4].order_id, 1u);
+  EXPECT_EQ(reports[4].side, Side::Bid);
+  EXPECT_EQ(reports[5].side, Side::Ask);
+}
+
+#ifdef COMPACT_ORDERS
+TEST_F(ExecReportTest, CompactLayoutRejectsOversizedLimits) {
+  sink_.begin(1, 0);
+  book_.addOrder(1, 100, 1ull << 32, true, 11);    // quantity
+  book_.addOrder(2, 1ull << 32, 5, false, 11);     // price
+  book_.addOrder(3, 100, UINT32_MAX, true, 11);    // fits
+  book_.matchMarketOrder(false, (1ull << 32) + 1); // never rests
+
+  auto reports = drain();
+  ASSERT_GE(reports.size(), 3u);
+  EXPECT_EQ(reports[0].type, ExecType::Rejected);
+  EXPECT_EQ(reports[0].order_id, 1u);
+  EXPECT_EQ(reports[1].type, ExecType::Rejected);
+  EXPECT_EQ(reports[1].order_id, 2u);
+  EXPECT_EQ(reports[2].type, ExecType::Ack);
+  EXPECT_EQ(book_.telemetry_.rejected_orders.load(), 2u);
+  EXPECT_EQ(book_.resting_orders(), 0u);
+  EXPECT_EQ(reports.back().type, ExecType::Cancelled); // the unfilled rest
+}
+#endif
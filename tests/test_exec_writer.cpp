@@ -0,0 +1,135 @@
+#include "exec_writer.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+class ExecWriterTest : public ::testing::Test {
+protected:
+  std::unique_ptr<ExecQueue> ring_ = std::make_unique<ExecQueue>();
+
+  static Client::ExecReport report(uint32_t session, uint64_t id) {
+    Client::ExecReport r{};
+    r.type = ExecType::Ack;
+    r.session = session;
+    r.order_id = id;
+    return r;
+  }
+
+  // Returns the server end of a fresh socket pair; the peer end goes to
+  // `peer`
+  static int connect_pair(int &peer) {
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    peer = fds[1];
+    return fds[0];
+  }
+
+  static std::vector<Client::ExecReport> read_reports(int fd, size_t n) {
+    std::vector<Client::ExecReport> out(n);
+    size_t want = n * sizeof(Client::ExecReport);
+    size_t got = 0;
+    auto *p = reinterpret_cast<uint8_t *>(out.data());
+    while (got < want) {
+      ssize_t r = read(fd, p + got, want - got);
+      if (r <= 0)
+        break;
+      got += r;
+    }
+    out.resize(got / sizeof(Client::ExecReport));
+    return out;
+  }
+};
+
+TEST_F(ExecWriterTest, DeliversEachSessionItsOwnReports) {
+  int peer_a, peer_b;
+  int a = connect_pair(peer_a);
+  int b = connect_pair(peer_b);
+
+  ExecWriter writer({ring_.get()});
+  writer.open(1, a);
+  writer.open(2, b);
+  close(a); // the writer holds its own copy
+  close(b);
+
+  for (uint64_t i = 0; i < 10; i++)
+    ring_->enqueue(report(i < 4 || i > 7 ? 1 : 2, i));
+
+  std::atomic<bool> done{true};
+  writer.run(done);
+
+  auto got_a = read_reports(peer_a, 6);
+  auto got_b = read_reports(peer_b, 4);
+  ASSERT_EQ(got_a.size(), 6u);
+  ASSERT_EQ(got_b.size(), 4u);
+  EXPECT_EQ(got_a[3].order_id, 3u);
+  EXPECT_EQ(got_a[4].order_id, 8u);
+  EXPECT_EQ(got_b[0].order_id, 4u);
+
+  // One sendmsg per session for the whole batch
+  EXPECT_EQ(writer.reports(), 10u);
+  EXPECT_EQ(writer.syscalls(), 2u);
+  EXPECT_EQ(writer.dropped(), 0u);
+
+  close(peer_a);
+  close(peer_b);
+}
+
+TEST_F(ExecWriterTest, ClosedSessionStillGetsInFlightReports) {
+  int peer;
+  int fd = connect_pair(peer);
+
+  {
+    ExecWriter writer({ring_.get()});
+    writer.open(1, fd);
+    writer.close(1); // client stopped sending; its orders are still queued
+    close(fd);
+
+    ring_->enqueue(report(1, 1));
+    ring_->enqueue(report(9, 2)); // never opened
+
+    std::atomic<bool> done{true};
+    writer.run(done);
+    EXPECT_EQ(writer.reports(), 1u);
+    EXPECT_EQ(writer.dropped(), 1u);
+  }
+
+  // The writer released its copy of the socket on the way out
+  auto got = read_reports(peer, 2);
+  ASSERT_EQ(got.size(), 1u);
+  EXPECT_EQ(got[0].order_id, 1u);
+  close(peer);
+}
+
+TEST_F(ExecWriterTest, SlowClientIsBackloggedInOrder) {
+  int peer;
+  int fd = connect_pair(peer);
+  int small = 4096;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+
+  ExecWriter writer({ring_.get()});
+  writer.open(1, fd);
+  close(fd);
+
+  // Far more than the socket buffer holds
+  constexpr size_t N = 20000;
+  for (uint64_t i = 0; i < N; i++)
+    ring_->enqueue(report(1, i));
+
+  // run() lingers on the backlog while the client catches up
+  std::vector<Client::ExecReport> got;
+  std::thread reader([&] { got = read_reports(peer, N); });
+  std::atomic<bool> done{true};
+  writer.run(done);
+  reader.join();
+
+  ASSERT_EQ(got.size(), N);
+  for (uint64_t i = 0; i < N; i++)
+    ASSERT_EQ(got[i].order_id, i);
+  EXPECT_GT(writer.syscalls(), 1u);
+  EXPECT_EQ(writer.dropped(), 0u);
+  close(peer);
+}
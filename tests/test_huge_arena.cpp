@@ -0,0 +1,141 @@
+#include "huge_arena.h"
+#include "level_pool.h"
+#include "order_pool.h"
+#include "shard.h"
+#include "telemetry.h"
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+TEST(HugeArenaTest, ReservesWholeHugePagesWithSomeBacking) {
+  HugeArena arena(1);
+  ASSERT_TRUE(arena.ok());
+  EXPECT_EQ(arena.capacity(), HugeArena::HUGE_PAGE);
+  EXPECT_NE(arena.backing(), ArenaBacking::None);
+  EXPECT_EQ(arena.used(), 0u);
+
+  // The first allocation starts the mapping, on a huge page boundary
+  void *first = arena.allocate(8, 8);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % HugeArena::HUGE_PAGE, 0u);
+  EXPECT_TRUE(arena.contains(first));
+}
+
+TEST(HugeArenaTest, ZeroCapacityLeavesCallersOnTheHeap) {
+  HugeArena arena(0);
+  EXPECT_FALSE(arena.ok());
+  EXPECT_EQ(arena.backing(), ArenaBacking::None);
+  EXPECT_EQ(arena.allocate(64, 64), nullptr);
+
+  ArenaArray<Level> levels = make_arena_array<Level>(&arena, 4);
+  EXPECT_TRUE(levels.get_deleter().heap);
+  EXPECT_TRUE(levels[3].empty());
+}
+
+TEST(HugeArenaTest, CountsFreeUnreservedHugePages) {
+  char path[] = "/tmp/fastbook_meminfo_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  const char text[] = "MemTotal:        6147400 kB\n"
+                      "HugePages_Total:     512\n"
+                      "HugePages_Free:      300\n"
+                      "HugePages_Rsvd:       44\n"
+                      "Hugepagesize:       2048 kB\n";
+  ASSERT_EQ(write(fd, text, sizeof(text) - 1), ssize_t(sizeof(text) - 1));
+  close(fd);
+  EXPECT_EQ(free_huge_pages(path), 256);
+  unlink(path);
+  EXPECT_EQ(free_huge_pages(path), -1);
+
+  // Only hugetlb memory copies out of the reserved pool on a fork
+  HugeArena arena(1);
+  arena.allocate(64, 64);
+  EXPECT_EQ(arena.cow_pages(),
+            arena.backing() == ArenaBacking::HugeTLB ? 1u : 0u);
+}
+
+TEST(HugeArenaTest, AlignsAndMissesOnceFull) {
+  HugeArena arena(HugeArena::HUGE_PAGE);
+  void *a = arena.allocate(1, 1);
+  void *b = arena.allocate(64, 64);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 64, 0u);
+  EXPECT_EQ(arena.used(), 128u);
+
+  EXPECT_EQ(arena.allocate(HugeArena::HUGE_PAGE, 64), nullptr);
+  EXPECT_EQ(arena.misses(), 1u);
+  EXPECT_NE(arena.allocate(HugeArena::HUGE_PAGE - 128, 64), nullptr);
+  EXPECT_EQ(arena.used(), HugeArena::HUGE_PAGE);
+}
+
+TEST(HugeArenaTest, ConcurrentAllocationsDoNotOverlap) {
+  HugeArena arena(HugeArena::HUGE_PAGE);
+  constexpr int THREADS = 4, EACH = 1000;
+  std::vector<std::vector<uintptr_t>> got(THREADS);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; t++)
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < EACH; i++) {
+        void *p = arena.allocate(64, 64);
+        got[t].push_back(reinterpret_cast<uintptr_t>(p));
+      }
+    });
+  for (auto &t : threads)
+    t.join();
+
+  std::vector<uintptr_t> all;
+  for (auto &g : got)
+    all.insert(all.end(), g.begin(), g.end());
+  std::sort(all.begin(), all.end());
+  EXPECT_NE(all.front(), 0u);
+  EXPECT_EQ(std::adjacent_find(all.begin(), all.end()), all.end());
+  EXPECT_EQ(arena.used(), size_t{THREADS} * EACH * 64);
+}
+
+TEST(HugeArenaTest, PoolSlabsComeFromTheArenaThenTheHeap) {
+  Telemetry telemetry;
+  HugeArena arena(HugeArena::HUGE_PAGE);
+  // The arena holds two slabs, then the heap takes over
+  const uint64_t slab = HugeArena::HUGE_PAGE / sizeof(Matching::Order) / 2;
+  Matching::OrderPool pool(telemetry, slab, &arena);
+  Matching::Order *first = pool.allocate(1, 10, 7);
+  EXPECT_TRUE(arena.contains(first));
+
+  for (uint64_t id = 2; id <= 2 * slab + 1; id++)
+    pool.allocate(id, 10, 7);
+  EXPECT_TRUE(arena.contains(pool.find(2 * slab)));
+  EXPECT_FALSE(arena.contains(pool.find(2 * slab + 1)));
+  EXPECT_EQ(arena.misses(), 1u);
+  EXPECT_EQ(pool.find(1)->quantity, 10u);
+
+  LevelPool levels(telemetry, 4, &arena);
+  EXPECT_FALSE(arena.contains(levels.allocate(100, Side::Bid)));
+}
+
+TEST(HugeArenaTest, ShardBuiltInTheArenaMatches) {
+  HugeArena arena(64 << 20);
+  ArenaPtr<Shard> shard = arena_new<Shard>(&arena, 0,
+                                           ShardOptions{.arena = &arena});
+  ASSERT_FALSE(shard.get_deleter().heap);
+  EXPECT_TRUE(arena.contains(shard.get()));
+  shard->set_verbose(false);
+
+  Client::Order bid{}, ask{};
+  bid.order_type = ask.order_type = OrderType::Limit;
+  bid.side = Side::Bid;
+  ask.side = Side::Ask;
+  bid.price = ask.price = 100;
+  bid.quantity = 5;
+  ask.quantity = 3;
+  shard->dispatch(bid);
+  shard->dispatch(ask);
+
+  const BookRegistry::Book *b = shard->books_.find(0);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(b->book.bestBid(), BestLevel(std::make_pair(Price{100},
+                                                        Volume{2})));
+  EXPECT_TRUE(arena.contains(b->book.level_at(Side::Bid, 100)));
+}
@@ -0,0 +1,190 @@
+#include "journal.h"
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class JournalTest : public ::testing::Test {
+protected:
+  std::string dir_;
+
+  void SetUp() override {
+    char tmpl[] = "/tmp/fastbook_journal_XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    dir_ = tmpl;
+  }
+
+  void TearDown() override { fs::remove_all(dir_); }
+
+  // The smallest segment: two pages, 254 orders after the header
+  static constexpr JournalOptions SMALL{.segment_bytes = 8192};
+
+  static Client::Order order(uint64_t id, InstrumentId instrument = 0) {
+    Client::Order o{};
+    o.order_id = id;
+    o.instrument = instrument;
+    return o;
+  }
+
+  std::vector<Client::Order> replay(JournalReplayStats *stats = nullptr) {
+    std::vector<Client::Order> out;
+    auto s = replay_journal(dir_, [&](std::span<const Client::Order> orders) {
+      out.insert(out.end(), orders.begin(), orders.end());
+    });
+    if (stats)
+      *stats = s;
+    return out;
+  }
+};
+
+TEST_F(JournalTest, ReplaysAcrossSegmentRollsInOrder) {
+  {
+    Journal journal(dir_, 1, 0, SMALL);
+    ASSERT_TRUE(journal.ok());
+    std::vector<Client::Order> batch;
+    for (uint64_t id = 0; id < 1000; id++) {
+      batch.push_back(order(id));
+      if (batch.size() == 37) {
+        journal.append(batch);
+        batch.clear();
+      }
+    }
+    journal.append(batch);
+    EXPECT_EQ(journal.appended(), 1000u);
+    EXPECT_EQ(journal.segments(), 4u); // ceil(1000 / 254)
+    // No sync thread ran, so every roll created its own segment
+    EXPECT_EQ(journal.inline_rolls(), 3u);
+  }
+
+  JournalReplayStats stats;
+  auto got = replay(&stats);
+  ASSERT_EQ(got.size(), 1000u);
+  for (uint64_t id = 0; id < 1000; id++)
+    ASSERT_EQ(got[id].order_id, id);
+  EXPECT_EQ(stats.records, 1000u);
+  EXPECT_EQ(stats.segments, 4u);
+}
+
+TEST_F(JournalTest, SyncThreadPreparesSegmentsAhead) {
+  Journal journal(dir_, 1, 0, SMALL);
+  std::atomic<bool> done{false};
+  std::thread syncer(run_journal_sync, std::vector<Journal *>{&journal},
+                     std::chrono::milliseconds(1), std::cref(done));
+
+  for (uint64_t id = 0; id < 4000; id++) {
+    Client::Order o = order(id);
+    journal.append({&o, 1});
+    if (id % 100 == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  done = true;
+  syncer.join();
+
+  EXPECT_LT(journal.inline_rolls(), journal.segments() - 1);
+  EXPECT_GT(journal.syncs(), 0u);
+  EXPECT_EQ(replay().size(), 4000u);
+}
+
+TEST_F(JournalTest, GenerationsReplayOldestFirstAcrossShards) {
+  EXPECT_EQ(next_journal_generation(dir_), 1u);
+  {
+    // Run 1: two shards, instrument 1 on shard 1
+    Journal a(dir_, 1, 0, SMALL), b(dir_, 1, 1, SMALL);
+    Client::Order o = order(10, 1);
+    b.append({&o, 1});
+  }
+  EXPECT_EQ(next_journal_generation(dir_), 2u);
+  {
+    // Run 2: one shard now owns instrument 1
+    Journal a(dir_, 2, 0, SMALL);
+    Client::Order o = order(11, 1);
+    a.append({&o, 1});
+  }
+
+  auto got = replay();
+  ASSERT_EQ(got.size(), 2u);
+  EXPECT_EQ(got[0].order_id, 10u);
+  EXPECT_EQ(got[1].order_id, 11u);
+}
+
+TEST_F(JournalTest, ReplayStartsAfterACheckpointedPosition) {
+  {
+    Journal a(dir_, 1, 0, SMALL), b(dir_, 1, 1, SMALL);
+    for (uint64_t id = 0; id < 600; id++) {
+      Client::Order o = order(id);
+      (id % 2 ? b : a).append({&o, 1});
+    }
+  }
+  {
+    Journal a(dir_, 2, 0, SMALL);
+    Client::Order o = order(1000);
+    a.append({&o, 1});
+  }
+
+  // Generation 1 is covered up to 280 of shard 0 (past its first segment)
+  // and 10 of shard 1
+  JournalPosition from{.generation = 1, .applied = {280, 10}};
+  std::vector<uint64_t> ids;
+  auto stats = replay_journal(
+      dir_,
+      [&](std::span<const Client::Order> orders) {
+        for (const auto &o : orders)
+          ids.push_back(o.order_id);
+      },
+      from);
+
+  EXPECT_EQ(stats.skipped, 290u);
+  ASSERT_EQ(ids.size(), 600u - 290u + 1u);
+  EXPECT_EQ(ids.front(), 560u); // shard 0's 281st record
+  EXPECT_EQ(ids[20 - 1], 598u); // its last
+  EXPECT_EQ(ids[20], 21u);      // shard 1's 11th
+  EXPECT_EQ(ids.back(), 1000u);
+}
+
+TEST_F(JournalTest, ReplayStopsWhereUnsyncedRecordsWereLost) {
+  {
+    Journal journal(dir_, 1, 0, SMALL);
+    std::vector<Client::Order> batch;
+    for (uint64_t id = 1; id <= 10; id++)
+      batch.push_back(order(id));
+    journal.append(batch);
+  }
+  std::string path = fs::directory_iterator(dir_)->path();
+  int fd = open(path.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  Client::JournalHeader h{};
+  ASSERT_EQ(pread(fd, &h, sizeof(h), 0), ssize_t(sizeof(h)));
+  EXPECT_EQ(h.count, 10u);
+  EXPECT_EQ(h.synced, 10u);
+
+  // A power loss after the count reached the disk but only 4 records were
+  // synced, and of the rest only the next 2 made it
+  h.synced = 4;
+  ASSERT_EQ(pwrite(fd, &h, sizeof(h), 0), ssize_t(sizeof(h)));
+  std::vector<Client::Order> lost(4, Client::Order{});
+  off_t at = sizeof(h) + 6 * sizeof(Client::Order);
+  ASSERT_EQ(pwrite(fd, lost.data(), 4 * sizeof(Client::Order), at),
+            ssize_t(4 * sizeof(Client::Order)));
+  close(fd);
+
+  auto got = replay();
+  ASSERT_EQ(got.size(), 6u);
+  EXPECT_EQ(got.back().order_id, 6u);
+}
+
+TEST_F(JournalTest, IdleRunLeavesNoSegments) {
+  {
+    Journal journal(dir_, 1, 0, SMALL);
+    journal.maintain(); // prepares a spare that is never activated
+  }
+  size_t files = std::distance(fs::directory_iterator(dir_), {});
+  EXPECT_EQ(files, 0u);
+  EXPECT_TRUE(replay().empty());
+}
@@ -0,0 +1,120 @@
+#include "latency_histogram.h"
+#include "telemetry.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+TEST(LatencyHistogramTest, BucketsAreContiguousWithBoundedWidth) {
+  using H = LatencyHistogram;
+  EXPECT_EQ(H::lower_bound(0), 0u);
+  for (size_t b = 1; b < H::BUCKETS; b++) {
+    ASSERT_EQ(H::lower_bound(b), H::upper_bound(b - 1) + 1) << b;
+    ASSERT_EQ(H::bucket_of(H::lower_bound(b)), b);
+    ASSERT_EQ(H::bucket_of(H::lower_bound(b) - 1), b - 1);
+    // Width over lower bound never exceeds 1/32
+    uint64_t width = H::upper_bound(b - 1) - H::lower_bound(b - 1) + 1;
+    ASSERT_LE(width * H::SUB_COUNT, std::max<uint64_t>(H::lower_bound(b - 1),
+                                                      H::SUB_COUNT))
+        << b;
+  }
+  EXPECT_EQ(H::bucket_of(31), 31u);
+  EXPECT_EQ(H::bucket_of((uint64_t{1} << 32) - 1), H::BUCKETS - 1);
+  EXPECT_EQ(H::bucket_of(uint64_t{1} << 40), H::BUCKETS - 1);
+  EXPECT_LE(sizeof(H), 8 * 1024u);
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinRelativeError) {
+  auto h = std::make_unique<LatencyHistogram>();
+  for (uint64_t ns = 1; ns <= 100'000; ns++)
+    h->record(ns);
+
+  EXPECT_EQ(h->total(), 100'000u);
+  EXPECT_EQ(h->max(), 100'000u);
+  EXPECT_DOUBLE_EQ(h->mean(), 50'000.5);
+  for (double q : {0.5, 0.9, 0.99, 0.999}) {
+    double exact = q * 100'000;
+    EXPECT_GE(h->percentile(q), exact);
+    EXPECT_LE(h->percentile(q), exact * (1 + 1.0 / 32)) << q;
+  }
+  EXPECT_EQ(h->percentile(1.0), 100'000u);
+  EXPECT_EQ(LatencyHistogram().percentile(0.5), 0u);
+}
+
+TEST(LatencyHistogramTest, OverflowStillCountsTowardsMax) {
+  LatencyHistogram h;
+  h.record(10);
+  h.record(uint64_t{30} * 1'000'000'000); // 30 s
+  EXPECT_EQ(h.count(LatencyHistogram::BUCKETS - 1), 1u);
+  EXPECT_EQ(h.percentile(1.0), uint64_t{30} * 1'000'000'000);
+  EXPECT_EQ(h.percentile(0.5), 10u);
+}
+
+TEST(LatencyHistogramTest, MergeAddsSamples) {
+  LatencyHistogram a, b;
+  a.record(100);
+  a.record(200);
+  b.record(5000);
+  a.merge(b);
+  EXPECT_EQ(a.total(), 3u);
+  EXPECT_EQ(a.sum(), 5300u);
+  EXPECT_EQ(a.max(), 5000u);
+  EXPECT_EQ(a.count(LatencyHistogram::bucket_of(5000)), 1u);
+}
+
+TEST(LatencyHistogramTest, SubtractLeavesTheSamplesInBetween) {
+  LatencyHistogram live, earlier, interval;
+  live.record(100);
+  live.record(90'000);
+  earlier.merge(live);
+  live.record(300);
+  live.record(310);
+
+  interval.merge(live);
+  interval.subtract(earlier);
+  EXPECT_EQ(interval.total(), 2u);
+  EXPECT_EQ(interval.sum(), 610u);
+  EXPECT_EQ(interval.count(LatencyHistogram::bucket_of(90'000)), 0u);
+  // The old max is gone; the new one is the top of the highest bucket left
+  EXPECT_EQ(interval.max(), LatencyHistogram::upper_bound(
+                                LatencyHistogram::bucket_of(310)));
+  EXPECT_EQ(interval.percentile(0.5), 303u);
+}
+
+TEST(TelemetryLatencyTest, SplitByTypeAndOutcome) {
+  auto t = std::make_unique<Telemetry>();
+  t->record_latency(100, OrderType::Limit, false);
+  t->record_latency(200, OrderType::Limit, true);
+  t->record_latency(300, OrderType::Market, true);
+  t->record_latency(400, OrderType::Market, false); // nothing to trade with
+  t->record_latency(500, OrderType::Cancel, false);
+
+  EXPECT_EQ(t->latency_by_type[0].total(), 2u);
+  EXPECT_EQ(t->latency_by_type[1].total(), 2u);
+  EXPECT_EQ(t->latency_by_type[2].total(), 1u);
+  EXPECT_EQ(t->latency_resting.total(), 1u);
+  EXPECT_EQ(t->latency_crossing.total(), 2u);
+
+  LatencyHistogram all;
+  t->merge_latency_all(all);
+  EXPECT_EQ(all.total(), 5u);
+  EXPECT_EQ(all.max(), 500u);
+
+  char path[] = "/tmp/fastbook_latency_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(t->write_latency_csv(path));
+  FILE *f = std::fopen(path, "r");
+  ASSERT_NE(f, nullptr);
+  char line[128];
+  std::string csv;
+  while (std::fgets(line, sizeof(line), f))
+    csv += line;
+  std::fclose(f);
+  unlink(path);
+  EXPECT_EQ(csv.rfind("class,lower_ns,upper_ns,count\n", 0), 0u);
+  EXPECT_NE(csv.find("cancel,496,503,1\n"), std::string::npos);
+  EXPECT_NE(csv.find("resting,100,101,1\n"), std::string::npos);
+}
@@ -0,0 +1,64 @@
+#include "level_pool.h"
+#include "telemetry.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class LevelPoolTest : public ::testing::Test {
+protected:
+  Telemetry telemetry_;
+  LevelPool pool_{telemetry_, 4};
+};
+
+TEST_F(LevelPoolTest, AllocateInitialisesLevel) {
+  Level *lvl = pool_.allocate(100, Side::Bid);
+  EXPECT_EQ(lvl->price, 100u);
+  EXPECT_EQ(lvl->size, 0u);
+  EXPECT_TRUE(lvl->empty());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(lvl) % 64, 0u);
+}
+
+TEST_F(LevelPoolTest, QueuesRecycleTheirChunks) {
+  std::vector<Matching::Order> orders(FifoChunk::ENTRIES * 3);
+  Level *lvl = pool_.allocate(100, Side::Ask);
+  for (auto &o : orders) {
+    o.quantity_remaining = 1;
+    lvl->push_back(&o);
+  }
+  EXPECT_NE(lvl->first, lvl->last);
+  EXPECT_EQ(lvl->back(), &orders.back());
+  size_t capacity = pool_.chunk_capacity();
+
+  // Draining and refilling, on this level or another, reuses the chunks
+  for (int round = 0; round < 8; round++) {
+    for (auto &o : orders)
+      lvl->pop(&o);
+    EXPECT_EQ(lvl->first, nullptr);
+    pool_.deallocate(lvl);
+    lvl = pool_.allocate(100 + round, Side::Ask);
+    for (auto &o : orders)
+      lvl->push_back(&o);
+  }
+  EXPECT_EQ(pool_.chunk_capacity(), capacity);
+  EXPECT_EQ(lvl->size, orders.size());
+  EXPECT_EQ(lvl->front(), &orders.front());
+}
+
+TEST_F(LevelPoolTest, DeallocatedLevelIsReusedAndReset) {
+  Level *a = pool_.allocate(100, Side::Bid);
+  a->volume = 42;
+  pool_.deallocate(a);
+
+  Level *b = pool_.allocate(200, Side::Bid);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(b->price, 200u);
+  EXPECT_EQ(b->volume, 0u);
+}
+
+TEST_F(LevelPoolTest, GrowsBySlabAndReportsOccupancy) {
+  for (Price p = 0; p < 5; p++)
+    pool_.allocate(p, Side::Bid);
+
+  EXPECT_EQ(pool_.capacity(), 8u);
+  EXPECT_EQ(telemetry_.levels_in_use.load(), 5u);
+  EXPECT_EQ(telemetry_.level_capacity.load(), 8u);
+}
@@ -1,5 +1,6 @@
 #include "orderbook.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <vector>
 
@@ -130,8 +131,8 @@ TEST_F(OrderBookTest, RemoveMiddleOrderMaintainsListIntegrity) {
   auto &level = *book.bids().back();
   EXPECT_EQ(level.size, 2);
   EXPECT_EQ(level.volume, 10);
-  EXPECT_EQ(level.sentinel.next->order_id, 1);
-  EXPECT_EQ(level.sentinel.prev->order_id, 3);
+  EXPECT_EQ(level.front()->order_id, 1);
+  EXPECT_EQ(level.back()->order_id, 3);
 }
 
 TEST_F(OrderBookTest, MatchExactlyRemovesLevel) {
@@ -159,12 +160,12 @@ TEST_F(OrderBookTest, MultipleOpposingLevelsMatchInSequence) {
 
 TEST_F(OrderBookTest, LevelPointerRemainsStable) {
   book.addOrder(1, 100, 5, true, 1);
-  auto levelPtr = book.bids().back().get();
+  auto levelPtr = book.bids().back();
 
   book.addOrder(2, 99, 5, true, 2);
   book.addOrder(3, 101, 5, true, 3);
 
-  EXPECT_EQ(book.bids()[1].get(), levelPtr); // 100 still same address
+  EXPECT_EQ(book.bids()[1], levelPtr); // 100 still same address
 }
 
 TEST_F(OrderBookTest, CancelNonexistentOrderSafe) {
@@ -191,7 +192,75 @@ TEST_F(OrderBookTest, RemoveTailMaintainsListIntegrity) {
 
   book.removeOrder(3);
   auto &level = *book.bids().back();
-  EXPECT_EQ(level.sentinel.next->order_id, 1);
-  EXPECT_EQ(level.sentinel.prev->order_id, 2);
+  EXPECT_EQ(level.front()->order_id, 1);
+  EXPECT_EQ(level.back()->order_id, 2);
   EXPECT_EQ(level.size, 2);
 }
+
+TEST_F(OrderBookTest, SweepSkipsCancelledOrders) {
+  for (uint64_t id = 1; id <= 6; id++)
+    book.addOrder(id, 100, 5, true, 1);
+  book.removeOrder(2);
+  book.removeOrder(3);
+  book.removeOrder(5);
+
+  book.addOrder(10, 100, 12, false, 2); // fills 1, 4 and 2 of 6
+
+  auto &level = *book.bids().back();
+  EXPECT_EQ(level.size, 1);
+  EXPECT_EQ(level.volume, 3);
+  EXPECT_EQ(level.front()->order_id, 6);
+  EXPECT_EQ(level.front()->quantity_remaining, 3);
+  EXPECT_EQ(level.front_entry().remaining, 3);
+  EXPECT_EQ(level.front(), level.back());
+}
+
+TEST_F(OrderBookTest, CancelsAtTheBackSpanChunks) {
+  for (uint64_t id = 1; id <= 40; id++)
+    book.addOrder(id, 100, 1, true, 1);
+  for (uint64_t id = 40; id > 10; id--)
+    book.removeOrder(id);
+
+  const Level &level = *book.bids().back();
+  EXPECT_EQ(level.back()->order_id, 10u);
+  EXPECT_EQ(level.first, level.last);
+  EXPECT_EQ(level.span, 10u);
+
+  book.addOrder(41, 100, 1, true, 1);
+  EXPECT_EQ(level.back()->order_id, 41u);
+  book.addOrder(1000, 100, 11, false, 2);
+  EXPECT_TRUE(book.bids().empty());
+}
+
+TEST_F(OrderBookTest, CompactionKeepsTimePriority) {
+  // Cancel three orders in four, then keep adding until the queue needs a
+  // new chunk and squeezes the holes out instead
+  for (uint64_t id = 1; id <= 64; id++)
+    book.addOrder(id, 100, 1, true, 1);
+  for (uint64_t id = 1; id <= 64; id++)
+    if (id % 4 != 1)
+      book.removeOrder(id);
+  for (uint64_t id = 65; id <= 128; id++)
+    book.addOrder(id, 100, 1, true, 1);
+
+  const Level &level = *book.bids().back();
+  EXPECT_EQ(level.span, level.size);
+  EXPECT_EQ(level.size, 80u);
+
+  // Slots moved by the compaction still cancel the right order
+  book.removeOrder(5);
+  book.removeOrder(100);
+  std::vector<uint64_t> ids;
+  level.for_each([&](const Matching::Order &o) { ids.push_back(o.order_id); });
+  ASSERT_EQ(ids.size(), level.size);
+  EXPECT_EQ(ids.size(), 78u);
+  EXPECT_EQ(ids[0], 1u);
+  EXPECT_EQ(ids[1], 9u);
+  EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+  EXPECT_EQ(std::count(ids.begin(), ids.end(), 100u), 0);
+  EXPECT_EQ(level.volume, 78u);
+
+  // And a sweep fills them oldest first
+  book.addOrder(1000, 100, 2, false, 2);
+  EXPECT_EQ(level.front()->order_id, 13u);
+}
@@ -0,0 +1,98 @@
+#include "order_gen.h"
+#include <algorithm>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+std::vector<Client::Order> generate(const OrderGenParams &params, size_t n,
+                                    unsigned threads) {
+  std::vector<Client::Order> orders(n);
+  generate_orders(params, orders, threads);
+  return orders;
+}
+
+bool same(const std::vector<Client::Order> &a,
+          const std::vector<Client::Order> &b) {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+}
+
+} // namespace
+
+TEST(OrderGenTest, StreamDependsOnSeedNotThreads) {
+  OrderGenParams params{.chunk = 10'000};
+  auto one = generate(params, 55'000, 1);
+  EXPECT_TRUE(same(one, generate(params, 55'000, 4)));
+
+  // A prefix of the stream is the start of the longer stream
+  auto shorter = generate(params, 25'000, 3);
+  EXPECT_TRUE(std::equal(shorter.begin(), shorter.end(), one.begin(),
+                         [](const Client::Order &a, const Client::Order &b) {
+                           return std::memcmp(&a, &b, sizeof(a)) == 0;
+                         }));
+
+  params.seed = 43;
+  EXPECT_FALSE(same(one, generate(params, 55'000, 1)));
+}
+
+TEST(OrderGenTest, IdsAreUniqueAndCancelsTargetRestingLimits) {
+  OrderGenParams params{.chunk = 20'000};
+  auto orders = generate(params, 100'000, 2);
+
+  std::unordered_set<OrderId> placed, resting;
+  for (const Client::Order &o : orders) {
+    EXPECT_EQ(o.instrument, params.instrument);
+    if (o.order_type == OrderType::Cancel) {
+      EXPECT_EQ(resting.erase(o.order_id), 1u) << o.order_id;
+      continue;
+    }
+    EXPECT_TRUE(placed.insert(o.order_id).second) << o.order_id;
+    EXPECT_GE(o.quantity, 1u);
+    EXPECT_GE(o.account_id, 1u);
+    EXPECT_LE(o.account_id, params.accounts);
+    if (o.order_type == OrderType::Limit)
+      resting.insert(o.order_id);
+    else
+      EXPECT_EQ(o.price, 0u);
+  }
+}
+
+TEST(OrderGenTest, MatchesTheScriptsDistributions) {
+  OrderGenParams params;
+  auto orders = generate(params, 400'000, 2);
+
+  size_t limits = 0, markets = 0, cancels = 0, buys = 0, far = 0;
+  std::vector<Volume> quantities;
+  for (const Client::Order &o : orders) {
+    switch (o.order_type) {
+    case OrderType::Limit:
+      limits++;
+      far += o.price > params.fair_price + params.far_threshold ||
+             o.price + params.far_threshold < params.fair_price;
+      break;
+    case OrderType::Market:
+      markets++;
+      break;
+    case OrderType::Cancel:
+      cancels++;
+      continue;
+    }
+    buys += o.side == Side::Bid;
+    quantities.push_back(o.quantity);
+  }
+  const double n = orders.size();
+  EXPECT_NEAR(limits / n, 0.6, 0.01);
+  EXPECT_NEAR(markets / n, 0.1, 0.01);
+  EXPECT_NEAR(cancels / n, 0.3, 0.01);
+  EXPECT_NEAR(buys / double(limits + markets), 0.52, 0.01);
+  // P(|offset| > 50) = exp(-0.003 * 51) for Laplace prices
+  EXPECT_NEAR(far / double(limits), 0.858, 0.01);
+
+  std::nth_element(quantities.begin(),
+                   quantities.begin() + quantities.size() / 2,
+                   quantities.end());
+  EXPECT_EQ(quantities[quantities.size() / 2], 8u);
+}
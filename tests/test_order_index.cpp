@@ -0,0 +1,129 @@
+#include "order_index.h"
+#include "telemetry.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class OrderIndexTest : public ::testing::Test {
+protected:
+  Telemetry telemetry_;
+  Matching::OrderIndex index_{&telemetry_, 16};
+};
+
+TEST_F(OrderIndexTest, InsertFindErase) {
+  auto [v, inserted] = index_.insert(42, 7);
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(v, 7u);
+  EXPECT_EQ(index_.find(42), 7u);
+
+  EXPECT_EQ(index_.erase(42), 7u);
+  EXPECT_EQ(index_.find(42), Matching::OrderIndex::npos);
+  EXPECT_EQ(index_.erase(42), Matching::OrderIndex::npos);
+}
+
+TEST_F(OrderIndexTest, DuplicateInsertReturnsExisting) {
+  index_.insert(0, 3);
+  auto [v, inserted] = index_.insert(0, 9);
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(v, 3u);
+}
+
+TEST_F(OrderIndexTest, IncrementalGrowthKeepsEveryKey) {
+  constexpr uint64_t N = 5000;
+  std::vector<bool> erased(N, false);
+  for (uint64_t k = 0; k < N; k++) {
+    index_.insert(k, k * 2);
+    // erase some while tables are mid-migration
+    uint64_t victim = k / 2;
+    if (k % 3 == 0 && !erased[victim]) {
+      EXPECT_EQ(index_.erase(victim), victim * 2);
+      erased[victim] = true;
+    }
+  }
+
+  for (uint64_t k = 0; k < N; k++) {
+    EXPECT_EQ(index_.find(k), erased[k] ? Matching::OrderIndex::npos : k * 2)
+        << "key " << k;
+  }
+  EXPECT_GT(index_.capacity(), 16u);
+  index_.publish();
+  EXPECT_GT(telemetry_.index_rehashes.load(), 0u);
+  EXPECT_LE(telemetry_.index_load_factor(), 0.75);
+}
+
+TEST_F(OrderIndexTest, ProbeCountsWaitForPublish) {
+  index_.insert(1, 1);
+  index_.find(1);
+  index_.erase(1);
+  EXPECT_EQ(telemetry_.index_lookups.load(), 0u);
+
+  index_.publish();
+  EXPECT_EQ(telemetry_.index_lookups.load(), 3u);
+  EXPECT_GE(telemetry_.index_probes.load(), 3u);
+  EXPECT_EQ(telemetry_.index_size.load(), 0u);
+
+  // Published counts are not added twice
+  index_.publish();
+  EXPECT_EQ(telemetry_.index_lookups.load(), 3u);
+}
+
+TEST(OrderIndexNoTelemetry, WorksWithoutTelemetry) {
+  Matching::OrderIndex index(nullptr, 16);
+  for (uint64_t k = 0; k < 100; k++)
+    index.insert(k, k);
+  index.publish();
+  EXPECT_EQ(index.find(42), 42u);
+  EXPECT_EQ(index.size(), 100u);
+}
+
+TEST_F(OrderIndexTest, MigratedKeysEraseOnce) {
+  // Large enough that the migration spans several inserts
+  Matching::OrderIndex index(&telemetry_, 256);
+  uint64_t n = 0;
+  while (!index.rehashing()) {
+    index.insert(n, n);
+    n++;
+  }
+  index.insert(n, n); // moves the first buckets to the new table
+  n++;
+  ASSERT_TRUE(index.rehashing());
+
+  for (uint64_t k = 0; k < n; k++) {
+    EXPECT_EQ(index.erase(k), k) << "key " << k;
+    EXPECT_EQ(index.find(k), Matching::OrderIndex::npos) << "key " << k;
+    EXPECT_EQ(index.erase(k), Matching::OrderIndex::npos) << "key " << k;
+  }
+  EXPECT_EQ(index.size(), 0u);
+
+  // Draining the old table must not underflow its count
+  for (uint64_t k = n; index.rehashing(); k++)
+    index.insert(k, k);
+  EXPECT_LT(index.size(), n);
+}
+
+TEST_F(OrderIndexTest, BackwardShiftKeepsProbeChains) {
+  // Fill, erase every other key, then verify survivors are still reachable
+  for (uint64_t k = 1; k <= 11; k++)
+    index_.insert(k, k);
+  for (uint64_t k = 1; k <= 11; k += 2)
+    index_.erase(k);
+  for (uint64_t k = 2; k <= 11; k += 2)
+    EXPECT_EQ(index_.find(k), k);
+  EXPECT_EQ(index_.size(), 5u);
+}
+
+TEST_F(OrderIndexTest, ReserveSizesTableWithoutRehashing) {
+  for (uint64_t k = 0; k < 10; k++)
+    index_.insert(k, k);
+  index_.reserve(3000);
+  EXPECT_GE(index_.capacity() * 3, (10u + 3000u) * 4);
+  EXPECT_FALSE(index_.rehashing());
+
+  index_.publish();
+  uint64_t rehashes = telemetry_.index_rehashes.load();
+  for (uint64_t k = 10; k < 3010; k++)
+    index_.insert(k, k);
+  index_.publish();
+  EXPECT_EQ(telemetry_.index_rehashes.load(), rehashes);
+  for (uint64_t k = 0; k < 3010; k++)
+    EXPECT_EQ(index_.find(k), k);
+}
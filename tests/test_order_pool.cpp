@@ -1,6 +1,9 @@
 #include "order_pool.h"
 #include "telemetry.h"
+#include <cstdint>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <vector>
 
 class OrderPoolTest : public ::testing::Test {
 protected:
@@ -9,19 +12,18 @@ protected:
 };
 
 TEST_F(OrderPoolTest, AllocateAndFindOrder) {
-  auto *o1 = pool_.allocate(1001, 50, true, 42);
+  auto *o1 = pool_.allocate(1001, 50, 42);
   ASSERT_NE(o1, nullptr);
   EXPECT_EQ(o1->order_id, 1001);
   EXPECT_EQ(o1->quantity, 50);
-  EXPECT_EQ(o1->side, Side::Bid);
-  EXPECT_EQ(o1->account_id, 42);
+  EXPECT_EQ(pool_.account(*o1), 42);
 
   auto *found = pool_.find(1001);
   EXPECT_EQ(found, o1);
 }
 
 TEST_F(OrderPoolTest, DeallocateOrder) {
-  auto *o1 = pool_.allocate(1001, 50, false, 40);
+  auto *o1 = pool_.allocate(1001, 50, 40);
   auto *found = pool_.find(1001);
 
   ASSERT_NE(o1, nullptr);
@@ -33,11 +35,11 @@ TEST_F(OrderPoolTest, DeallocateOrder) {
 }
 
 TEST_F(OrderPoolTest, DeallocateAndReuseSlot) {
-  auto *o1 = pool_.allocate(1, 10, true, 101);
-  pool_.allocate(2, 10, false, 101);
+  auto *o1 = pool_.allocate(1, 10, 101);
+  pool_.allocate(2, 10, 101);
   pool_.deallocate(1);
 
-  auto *o3 = pool_.allocate(3, 5, false, 102);
+  auto *o3 = pool_.allocate(3, 5, 102);
   EXPECT_EQ(o1, o3);
   EXPECT_EQ(pool_.find(1), nullptr);
   EXPECT_EQ(pool_.find(3), o3);
@@ -45,21 +47,21 @@ TEST_F(OrderPoolTest, DeallocateAndReuseSlot) {
 
 TEST_F(OrderPoolTest, SlabExpansion) {
   for (int i = 0; i < 9; i++) {
-    pool_.allocate(i, 1, true, i);
+    pool_.allocate(i, 1, i);
   }
   EXPECT_GE(telemetry_.total_allocs.load(), 9u);
 }
 
 TEST_F(OrderPoolTest, AllocateIdempotent) {
-  auto *o1 = pool_.allocate(1, 10, true, 101);
-  auto *o2 = pool_.allocate(1, 10, true, 101);
+  auto *o1 = pool_.allocate(1, 10, 101);
+  auto *o2 = pool_.allocate(1, 10, 101);
 
   EXPECT_EQ(o1, o2);
   EXPECT_NE(o1, nullptr);
 }
 
 TEST_F(OrderPoolTest, DoubleDeallocateDoesNotCrash) {
-  auto *o1 = pool_.allocate(1, 100, true, 1);
+  auto *o1 = pool_.allocate(1, 100, 1);
   ASSERT_NE(o1, nullptr);
 
   pool_.deallocate(1);
@@ -71,10 +73,23 @@ TEST_F(OrderPoolTest, DoubleDeallocateDoesNotCrash) {
 }
 
 TEST_F(OrderPoolTest, ReuseFollowsLIFOOrder) {
-  auto _ = pool_.allocate(1, 1, true, 1);
-  auto *o2 = pool_.allocate(2, 1, true, 1);
+  auto _ = pool_.allocate(1, 1, 1);
+  auto *o2 = pool_.allocate(2, 1, 1);
   pool_.deallocate(1);
   pool_.deallocate(2);
-  auto *o3 = pool_.allocate(3, 1, true, 1);
+  auto *o3 = pool_.allocate(3, 1, 1);
   EXPECT_EQ(o3, o2); // LIFO expected
 }
+
+TEST_F(OrderPoolTest, AccountsSurviveTheLayout) {
+  const uint64_t accounts[] = {7, 1ull << 40, 7, 9, 1ull << 40, UINT64_MAX};
+  std::vector<Matching::Order *> orders;
+  for (uint64_t i = 0; i < std::size(accounts); i++)
+    orders.push_back(pool_.allocate(i + 1, 1, accounts[i]));
+  for (uint64_t i = 0; i < std::size(accounts); i++)
+    EXPECT_EQ(pool_.account(*orders[i]), accounts[i]);
+#ifdef COMPACT_ORDERS
+  EXPECT_EQ(orders[0]->account, orders[2]->account); // interned once
+  EXPECT_EQ(sizeof(Matching::Order), 32u);
+#endif
+}
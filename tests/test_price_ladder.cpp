@@ -0,0 +1,249 @@
+#include "book_registry.h"
+#include "hierarchical_bitset.h"
+#include "orderbook.h"
+#include "price_ladder.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using Bitset = HierarchicalBitset<1 << 14>;
+
+TEST(HierarchicalBitsetTest, EmptyFindsNothing) {
+  Bitset bits;
+  EXPECT_TRUE(bits.none());
+  EXPECT_EQ(bits.find_first(), Bitset::npos);
+  EXPECT_EQ(bits.find_last(), Bitset::npos);
+}
+
+TEST(HierarchicalBitsetTest, FindNextAndPrevCrossSummaryWords) {
+  Bitset bits;
+  bits.set(3);
+  bits.set(5000);
+  bits.set(16383);
+
+  EXPECT_EQ(bits.find_first(), 3u);
+  EXPECT_EQ(bits.find_last(), 16383u);
+  EXPECT_EQ(bits.find_next(4), 5000u);
+  EXPECT_EQ(bits.find_next(5001), 16383u);
+  EXPECT_EQ(bits.find_prev(4999), 3u);
+  EXPECT_EQ(bits.find_prev(16382), 5000u);
+  EXPECT_EQ(bits.find_prev(2), Bitset::npos);
+
+  bits.reset(5000);
+  EXPECT_FALSE(bits.test(5000));
+  EXPECT_EQ(bits.find_next(4), 16383u);
+
+  bits.reset(3);
+  bits.reset(16383);
+  EXPECT_TRUE(bits.none());
+}
+
+class PriceLadderTest : public ::testing::Test {
+protected:
+  PriceLadder<Level, 64> bids{Side::Bid};
+  PriceLadder<Level, 64> asks{Side::Ask};
+
+  std::vector<std::unique_ptr<Level>> storage;
+
+  Level *level(Price p) {
+    storage.push_back(std::make_unique<Level>(p));
+    return storage.back().get();
+  }
+};
+
+TEST_F(PriceLadderTest, BestTracksInsertAndErase) {
+  bids.insert(100, level(100));
+  bids.insert(98, level(98));
+  bids.insert(99, level(99));
+  EXPECT_EQ(bids.best()->price, 100u);
+
+  bids.erase(100);
+  EXPECT_EQ(bids.best()->price, 99u);
+  EXPECT_EQ(bids.size(), 2u);
+
+  asks.insert(105, level(105));
+  asks.insert(103, level(103));
+  EXPECT_EQ(asks.best()->price, 103u);
+}
+
+TEST_F(PriceLadderTest, SlidesOntoANearbyBest) {
+  Level *kept = bids.insert(100, level(100)); // window 52..115
+  // Just past the top edge with nothing in the way: slides at once
+  bids.insert(120, level(120)); // window 72..135
+  EXPECT_EQ(bids.recenters(), 2u);
+  bids.insert(60, level(60)); // cold
+  bids.insert(80, level(80));
+
+  // With 80 in the way: parked at first, then slid onto once a second
+  // parked operation pays for spilling it
+  bids.insert(140, level(140));
+  EXPECT_EQ(bids.recenters(), 2u);
+  EXPECT_EQ(bids.best()->price, 140u);
+  bids.insert(141, level(141)); // window 93..156
+  EXPECT_EQ(bids.recenters(), 3u);
+  EXPECT_EQ(bids.best()->price, 141u);
+  EXPECT_EQ(bids.find(100), kept); // level addresses survive the move
+
+  std::vector<Price> seen;
+  bids.for_each_best(6, [&](const Level &l) { seen.push_back(l.price); });
+  EXPECT_EQ(seen, (std::vector<Price>{141, 140, 120, 100, 80, 60}));
+}
+
+TEST_F(PriceLadderTest, FarBestIsParkedUntilWindowEmpties) {
+  Level *deep = bids.insert(1000, level(1000));
+  bids.insert(100, level(100)); // below the window, goes cold
+  EXPECT_EQ(bids.find(100)->price, 100u);
+
+  // A better bid far above the window is parked rather than slid onto,
+  // which would spill 1000
+  bids.insert(5000, level(5000));
+  EXPECT_EQ(bids.recenters(), 1u);
+  EXPECT_EQ(bids.best()->price, 5000u);
+  EXPECT_EQ(bids.find(1000), deep);
+
+  // Emptying the window slides it onto the best cold level
+  bids.erase(5000);
+  EXPECT_EQ(bids.best()->price, 1000u);
+  bids.erase(1000);
+  EXPECT_EQ(bids.best()->price, 100u);
+  EXPECT_EQ(bids.recenters(), 2u);
+  bids.erase(100);
+  EXPECT_TRUE(bids.empty());
+  EXPECT_EQ(bids.best(), nullptr);
+}
+
+TEST_F(PriceLadderTest, FarOrderChurnRarelySlides) {
+  for (Price p = 1000; p < 1032; p++)
+    asks.insert(p, level(p));
+  Level *far = level(10);
+  for (int i = 0; i < 1000; i++) {
+    asks.insert(10, far);
+    EXPECT_EQ(asks.best(), far);
+    asks.erase(10);
+    EXPECT_EQ(asks.best()->price, 1000u);
+  }
+  // Each slide away spills 32 levels, so it waits for 64 parked operations
+  EXPECT_LT(asks.recenters(), 1000u / 16);
+}
+
+TEST_F(PriceLadderTest, MatchesAnOrderedMapWhileDrifting) {
+  for (auto *ladder : {&bids, &asks}) {
+    bool is_bid = ladder == &bids;
+    std::mt19937_64 rng(7);
+    std::map<Price, Level *> ref;
+    Price mid = 10'000;
+    for (int i = 0; i < 20000; i++) {
+      mid += rng() % 5;
+      mid -= rng() % 5;
+      Price p = mid + rng() % 200 - 100;
+      if (rng() % 50 == 0)
+        p = mid + rng() % 4000 - 2000; // now and then far from the mid
+      if (auto it = ref.find(p); it != ref.end()) {
+        ladder->erase(p);
+        ref.erase(it);
+      } else {
+        ref[p] = ladder->insert(p, level(p));
+      }
+
+      ASSERT_EQ(ladder->size(), ref.size());
+      Level *best = ref.empty()          ? nullptr
+                    : is_bid ? ref.rbegin()->second
+                             : ref.begin()->second;
+      ASSERT_EQ(ladder->best(), best) << "step " << i;
+      ASSERT_EQ(ladder->find(p), ref.count(p) ? ref[p] : nullptr);
+    }
+    EXPECT_GT(ladder->recenters(), 1u);
+
+    std::vector<Price> seen, want;
+    for (auto &[p, l] : ref)
+      want.push_back(p);
+    ladder->for_each([&](const Level &l) { seen.push_back(l.price); });
+    EXPECT_EQ(seen, want);
+
+    seen.clear();
+    ladder->for_each_best(ref.size(),
+                          [&](const Level &l) { seen.push_back(l.price); });
+    if (is_bid)
+      std::reverse(want.begin(), want.end());
+    EXPECT_EQ(seen, want);
+  }
+}
+
+TEST_F(PriceLadderTest, ForEachVisitsAscending) {
+  for (Price p : {7, 500, 3, 90, 60000})
+    asks.insert(p, level(p));
+
+  std::vector<Price> seen;
+  asks.for_each([&](const Level &lvl) { seen.push_back(lvl.price); });
+  EXPECT_EQ(seen, (std::vector<Price>{3, 7, 90, 500, 60000}));
+}
+
+TEST_F(PriceLadderTest, ForEachBestWalksFromBestIntoColdLevels) {
+  // Window of 64 ticks: the far levels on each side stay cold
+  for (Price p : {1000, 999, 960, 10, 5})
+    bids.insert(p, level(p));
+  for (Price p : {1000, 1001, 1040, 9000, 20000})
+    asks.insert(p, level(p));
+
+  std::vector<Price> seen;
+  auto collect = [&](const Level &lvl) { seen.push_back(lvl.price); };
+  EXPECT_EQ(bids.for_each_best(10, collect), 5u);
+  EXPECT_EQ(seen, (std::vector<Price>{1000, 999, 960, 10, 5}));
+
+  seen.clear();
+  EXPECT_EQ(asks.for_each_best(4, collect), 4u);
+  EXPECT_EQ(seen, (std::vector<Price>{1000, 1001, 1040, 9000}));
+}
+
+TEST_F(PriceLadderTest, NarrowWindowIsAllocatedOnFirstInsert) {
+  PriceLadder<Level, 1 << 14> narrow(Side::Ask, 64);
+  EXPECT_FALSE(narrow.window_allocated());
+  EXPECT_EQ(narrow.find(100), nullptr);
+  EXPECT_EQ(narrow.best(), nullptr);
+
+  narrow.insert(100, level(100));
+  EXPECT_TRUE(narrow.window_allocated());
+  // 64 ticks with a quarter of headroom: 100 - 16 .. 100 + 47
+  narrow.insert(147, level(147));
+  narrow.insert(148, level(148));
+  std::vector<Price> seen;
+  narrow.for_each_best(3, [&](const Level &l) { seen.push_back(l.price); });
+  EXPECT_EQ(seen, (std::vector<Price>{100, 147, 148}));
+  EXPECT_EQ(narrow.recenters(), 1u);
+}
+
+TEST(OrderBookLadderTest, RegistryBooksUseTheNarrowWindow) {
+  Telemetry telemetry;
+  BookRegistry books(telemetry);
+  const Orderbook &book = books.get(7).book;
+  EXPECT_EQ(book.ladder(Side::Bid).window_ticks(), BookRegistry::LADDER_TICKS);
+  EXPECT_FALSE(book.ladder(Side::Bid).window_allocated());
+  EXPECT_FALSE(book.ladder(Side::Ask).window_allocated());
+}
+
+TEST(OrderBookLadderTest, FarCancelsAndDriftKeepBookConsistent) {
+  Orderbook book;
+  for (uint64_t i = 0; i < 200; i++) {
+    book.addOrder(i + 1, 100'000 - i * 100, 1, true, 1);
+    book.addOrder(i + 1001, 100'001 + i * 100, 1, false, 1);
+  }
+  EXPECT_EQ(book.active_levels(), 400u);
+  EXPECT_EQ(book.resting_orders(), 400u);
+
+  // cancel the far half of each side
+  for (uint64_t i = 100; i < 200; i++) {
+    book.removeOrder(i + 1);
+    book.removeOrder(i + 1001);
+  }
+  EXPECT_EQ(book.bids().front()->price, 100'000u - 99 * 100);
+  EXPECT_EQ(book.asks().front()->price, 100'001u + 99 * 100);
+
+  // sweep the asks so the mid drifts far beyond the original window
+  book.addOrder(5000, 200'000, 150, true, 2);
+  EXPECT_EQ(book.bestBid()->first, 200'000u);
+  EXPECT_FALSE(book.bestAsk().has_value());
+  EXPECT_EQ(book.bids().size(), 101u);
+}
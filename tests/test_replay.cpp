@@ -0,0 +1,94 @@
+#include "replay.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// A deterministic mix of crossing limits, market orders and cancels over
+// a few instruments
+std::vector<Client::Order> make_orders(size_t n) {
+  std::vector<Client::Order> orders;
+  uint64_t x = 12345;
+  for (size_t i = 0; i < n; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    Client::Order o{};
+    o.instrument = static_cast<InstrumentId>((x >> 33) % 3);
+    o.side = (x >> 40) & 1 ? Side::Bid : Side::Ask;
+    uint64_t kind = (x >> 20) % 10;
+    o.order_type = kind < 7   ? OrderType::Limit
+                   : kind < 8 ? OrderType::Market
+                              : OrderType::Cancel;
+    o.price = 1000 + (x >> 45) % 20;
+    o.quantity = 1 + (x >> 50) % 9;
+    o.order_id = 1 + (x >> 24) % (i + 1);
+    orders.push_back(o);
+  }
+  return orders;
+}
+
+std::string describe(const Shard &shard) {
+  std::string out;
+  shard.books_.for_each([&](InstrumentId id, const BookRegistry::Book &b) {
+    out += std::to_string(id) + ":";
+    for (const Level *l : b.book.bids())
+      out += "b" + std::to_string(l->price) + "x" + std::to_string(l->volume);
+    for (const Level *l : b.book.asks())
+      out += "a" + std::to_string(l->price) + "x" + std::to_string(l->volume);
+    out += " ";
+  });
+  return out;
+}
+
+} // namespace
+
+TEST(OrderFileTest, MapsWholeRecordsOnly) {
+  char path[] = "/tmp/fastbook_orders_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  auto orders = make_orders(10);
+  ASSERT_EQ(write(fd, orders.data(), orders.size() * sizeof(Client::Order)),
+            static_cast<ssize_t>(orders.size() * sizeof(Client::Order)));
+  ASSERT_EQ(write(fd, "tail", 4), 4); // a torn last record
+  close(fd);
+
+  OrderFile file(path);
+  ASSERT_TRUE(file.ok());
+  ASSERT_EQ(file.orders().size(), 10u);
+  EXPECT_EQ(file.orders()[9].order_id, orders[9].order_id);
+  EXPECT_EQ(file.orders()[9].price, orders[9].price);
+  unlink(path);
+
+  EXPECT_FALSE(OrderFile("/nonexistent/orders.bin").ok());
+}
+
+TEST(ReplayTest, DirectAndQueuedReplayMatchIdentically) {
+  auto orders = make_orders(20000);
+  TSCClock clock;
+
+  auto direct = std::make_unique<Shard>(0);
+  direct->set_verbose(false);
+  direct->replay(orders, clock);
+
+  auto queued = std::make_unique<Shard>(0);
+  queued->set_verbose(false);
+  std::atomic<bool> closed{false}, stop{false};
+  std::thread matcher(&Shard::run, queued.get(), std::ref(queued->queue_),
+                      std::ref(queued->tags_), std::cref(closed), clock);
+  ReplayFeedStats fed =
+      feed_orders(orders, queued->queue_, queued->tags_, nullptr, stop);
+  closed.store(true);
+  matcher.join();
+
+  EXPECT_EQ(fed.orders, orders.size());
+  EXPECT_EQ(direct->processed(), orders.size());
+  EXPECT_EQ(queued->processed(), orders.size());
+  EXPECT_EQ(direct->books_.size(), 3u);
+  EXPECT_EQ(describe(*direct), describe(*queued));
+}
@@ -0,0 +1,91 @@
+#include "order_gen.h"
+#include "response_matcher.h"
+#include "shard.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+namespace {
+
+Client::Order order(OrderType type, Side side, Price price, Volume qty,
+                    OrderId id = 0) {
+  Client::Order o{};
+  o.order_type = type;
+  o.side = side;
+  o.price = price;
+  o.quantity = qty;
+  o.order_id = id;
+  return o;
+}
+
+// Sends `orders` through a shard as session 1 and feeds every report to a
+// matcher; returns which order each response answered, in arrival order
+std::vector<size_t> answers(const std::vector<Client::Order> &orders,
+                            ResponseMatcher &matcher) {
+  auto shard = std::make_unique<Shard>(0, ShardOptions{.exec_reports = true});
+  std::vector<size_t> out;
+  for (const Client::Order &o : orders) {
+    shard->exec_.begin(1, o.instrument);
+    shard->dispatch(o);
+    while (auto r = shard->exec_queue_.dequeue()) {
+      size_t i = matcher.on_report(*r);
+      if (i != ResponseMatcher::NOT_A_RESPONSE)
+        out.push_back(i);
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(ResponseMatcherTest, FollowUpReportsAreNotResponses) {
+  std::vector<Client::Order> orders = {
+      order(OrderType::Limit, Side::Ask, 100, 5),
+      order(OrderType::Limit, Side::Ask, 101, 5),
+      order(OrderType::Limit, Side::Ask, 102, 5),
+      // Sweeps two levels: two own fills, the second is a follow-up
+      order(OrderType::Market, Side::Bid, 0, 10),
+      // Fills the last level and has a cancelled remainder
+      order(OrderType::Market, Side::Bid, 0, 8),
+      order(OrderType::Market, Side::Bid, 0, 1), // book empty: rejected
+      order(OrderType::Limit, Side::Bid, 90, 5),
+      order(OrderType::Limit, Side::Ask, 90, 2), // crosses: ack, then fills
+      order(OrderType::Cancel, Side::Bid, 0, 0, 4),
+      order(OrderType::Cancel, Side::Bid, 0, 0, 4), // already gone
+  };
+  ResponseMatcher matcher(orders);
+  auto got = answers(orders, matcher);
+
+  std::vector<size_t> expected(orders.size());
+  for (size_t i = 0; i < expected.size(); i++)
+    expected[i] = i;
+  EXPECT_EQ(got, expected);
+  EXPECT_EQ(matcher.answered(), orders.size());
+  EXPECT_EQ(matcher.mismatched(), 0u);
+}
+
+TEST(ResponseMatcherTest, PairsEveryOrderOfASyntheticStream) {
+  OrderGenParams params{.price_decay = 0.05};
+  std::vector<Client::Order> orders(50'000);
+  generate_chunk(params, 0, orders);
+
+  ResponseMatcher matcher(orders);
+  auto got = answers(orders, matcher);
+  ASSERT_EQ(got.size(), orders.size());
+  for (size_t i = 0; i < got.size(); i++)
+    ASSERT_EQ(got[i], i);
+  EXPECT_EQ(matcher.mismatched(), 0u);
+}
+
+TEST(ResponseMatcherTest, SurplusResponsesAreMismatches) {
+  std::vector<Client::Order> orders = {
+      order(OrderType::Market, Side::Bid, 0, 1)};
+  ResponseMatcher matcher(orders);
+  Client::ExecReport ack{};
+  ack.type = ExecType::Ack;
+  ack.order_id = 1;
+  EXPECT_EQ(matcher.on_report(ack), 0u); // an Ack for a market order
+  EXPECT_EQ(matcher.mismatched(), 1u);
+  EXPECT_EQ(matcher.on_report(ack), ResponseMatcher::NOT_A_RESPONSE);
+  EXPECT_EQ(matcher.mismatched(), 2u);
+}
@@ -0,0 +1,88 @@
+#include "order.h"
+#include "ring_reader.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <vector>
+
+class RingReaderTest : public ::testing::Test {
+protected:
+  SPSCQueue<Client::Order, 8> queue_;
+  RingReader<Client::Order, 8> reader_{queue_};
+  int fds_[2];
+
+  void SetUp() override { ASSERT_EQ(pipe(fds_), 0); }
+  void TearDown() override {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  static Client::Order make(uint64_t id) {
+    Client::Order o{};
+    o.order_id = id;
+    o.price = id * 10;
+    return o;
+  }
+};
+
+TEST_F(RingReaderTest, ReassemblesOrdersSplitAcrossReads) {
+  std::vector<Client::Order> orders{make(1), make(2), make(3)};
+  auto *bytes = reinterpret_cast<const uint8_t *>(orders.data());
+
+  size_t published = 0;
+  ASSERT_EQ(write(fds_[1], bytes, 40), 40); // one order + 8 bytes
+  EXPECT_EQ(reader_.read_into(fds_[0], published), 40);
+  EXPECT_EQ(published, 1u);
+  EXPECT_EQ(reader_.pending_bytes(), 8u);
+
+  ASSERT_EQ(write(fds_[1], bytes + 40, 56), 56);
+  EXPECT_EQ(reader_.read_into(fds_[0], published), 56);
+  EXPECT_EQ(published, 2u);
+  EXPECT_EQ(reader_.pending_bytes(), 0u);
+
+  for (uint64_t id = 1; id <= 3; id++) {
+    auto o = queue_.dequeue();
+    ASSERT_TRUE(o.has_value());
+    EXPECT_EQ(o->order_id, id);
+    EXPECT_EQ(o->price, id * 10);
+  }
+}
+
+TEST_F(RingReaderTest, ReportsFullRingAndResumesAfterWrap) {
+  std::vector<Client::Order> orders;
+  for (uint64_t id = 1; id <= 10; id++)
+    orders.push_back(make(id));
+  auto *bytes = reinterpret_cast<const uint8_t *>(orders.data());
+  ASSERT_EQ(write(fds_[1], bytes, orders.size() * sizeof(Client::Order)),
+            static_cast<ssize_t>(orders.size() * sizeof(Client::Order)));
+
+  size_t published = 0;
+  reader_.read_into(fds_[0], published);
+  EXPECT_EQ(published, 7u); // ring of 8 holds 7
+  EXPECT_EQ(reader_.read_into(fds_[0], published),
+            (RingReader<Client::Order, 8>::RING_FULL));
+
+  for (uint64_t id = 1; id <= 7; id++)
+    EXPECT_EQ(queue_.dequeue()->order_id, id);
+
+  // head sits at slot 7, so the rest arrives in two wrapped reads
+  reader_.read_into(fds_[0], published);
+  EXPECT_EQ(published, 1u);
+  reader_.read_into(fds_[0], published);
+  EXPECT_EQ(published, 2u);
+  for (uint64_t id = 8; id <= 10; id++)
+    EXPECT_EQ(queue_.dequeue()->order_id, id);
+}
+
+TEST_F(RingReaderTest, IngestFramesBytesFromMemory) {
+  std::vector<Client::Order> orders{make(1), make(2)};
+  auto *bytes = reinterpret_cast<const uint8_t *>(orders.data());
+
+  size_t published = 0;
+  EXPECT_EQ(reader_.ingest(bytes, 20, published), 20u);
+  EXPECT_EQ(published, 0u);
+  EXPECT_EQ(reader_.ingest(bytes + 20, 44, published), 44u);
+  EXPECT_EQ(published, 2u);
+
+  EXPECT_EQ(queue_.dequeue()->order_id, 1u);
+  EXPECT_EQ(queue_.dequeue()->order_id, 2u);
+}
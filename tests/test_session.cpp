@@ -0,0 +1,90 @@
+#include "order.h"
+#include "session.h"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using Table = SessionTable<Client::Order, 64>;
+
+class SessionTableTest : public ::testing::Test {
+protected:
+  SPSCQueue<Client::Order, 64> queue_;
+
+  static Client::Order make(uint64_t id) {
+    Client::Order o{};
+    o.order_id = id;
+    return o;
+  }
+
+  // Returns the server end of a fresh socket pair; the peer end goes to
+  // `peers`
+  int connect_pair(std::vector<int> &peers) {
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    peers.push_back(fds[1]);
+    return fds[0];
+  }
+};
+
+TEST_F(SessionTableTest, SlotsAreReusedAndCapped) {
+  Table sessions(queue_, 2);
+  std::vector<int> peers;
+
+  auto *a = sessions.open(connect_pair(peers), "a");
+  auto *b = sessions.open(connect_pair(peers), "b");
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_NE(a->id, b->id);
+
+  int extra = connect_pair(peers);
+  EXPECT_EQ(sessions.open(extra, "c"), nullptr);
+  close(extra);
+
+  uint32_t freed = a->id;
+  sessions.close(freed);
+  EXPECT_EQ(sessions.get(freed), nullptr);
+  EXPECT_EQ(sessions.active(), 1u);
+
+  auto *c = sessions.open(connect_pair(peers), "c");
+  ASSERT_NE(c, nullptr);
+  EXPECT_EQ(c->id, freed);
+  EXPECT_EQ(sessions.opened(), 3u);
+
+  for (int fd : peers)
+    close(fd);
+}
+
+TEST_F(SessionTableTest, PartialOrdersStayWithTheirSession) {
+  Table sessions(queue_);
+  std::vector<int> peers;
+  auto *a = sessions.open(connect_pair(peers), "a");
+  auto *b = sessions.open(connect_pair(peers), "b");
+
+  Client::Order oa = make(1), ob = make(2);
+  auto *pa = reinterpret_cast<const uint8_t *>(&oa);
+  auto *pb = reinterpret_cast<const uint8_t *>(&ob);
+
+  // Both gateways send half an order, then the rest, interleaved
+  size_t half = sizeof(Client::Order) / 2, published = 0;
+  ASSERT_EQ(write(peers[0], pa, half), ssize_t(half));
+  ASSERT_EQ(write(peers[1], pb, half), ssize_t(half));
+  a->reader.read_into(a->fd, published);
+  b->reader.read_into(b->fd, published);
+  EXPECT_EQ(queue_.peek().size(), 0u);
+
+  ASSERT_EQ(write(peers[1], pb + half, sizeof(ob) - half),
+            ssize_t(sizeof(ob) - half));
+  ASSERT_EQ(write(peers[0], pa + half, sizeof(oa) - half),
+            ssize_t(sizeof(oa) - half));
+  b->reader.read_into(b->fd, published);
+  a->reader.read_into(a->fd, published);
+
+  auto ready = queue_.peek();
+  ASSERT_EQ(ready.size(), 2u);
+  EXPECT_EQ(ready[0].order_id, 2u);
+  EXPECT_EQ(ready[1].order_id, 1u);
+
+  for (int fd : peers)
+    close(fd);
+}
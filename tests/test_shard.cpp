@@ -0,0 +1,179 @@
+#include "book_registry.h"
+#include "shard.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+Client::Order limit(InstrumentId instrument, Side side, Price price,
+                    Volume qty) {
+  Client::Order o{};
+  o.instrument = instrument;
+  o.side = side;
+  o.order_type = OrderType::Limit;
+  o.price = price;
+  o.quantity = qty;
+  return o;
+}
+
+} // namespace
+
+TEST(BookRegistryTest, BooksAreCreatedOnFirstUse) {
+  Telemetry telemetry;
+  BookRegistry books(telemetry);
+  EXPECT_EQ(books.find(7), nullptr);
+
+  BookRegistry::Book &b = books.get(7);
+  EXPECT_EQ(&books.get(7), &b);
+  EXPECT_EQ(books.find(7), &b);
+  EXPECT_EQ(books.size(), 1u);
+  EXPECT_EQ(&b.book.telemetry_, &telemetry);
+}
+
+TEST(ShardTest, InstrumentsMatchIndependently) {
+  // Shards hold several rings, too large for the test stack
+  auto shard_ptr = std::make_unique<Shard>(0);
+  Shard &shard = *shard_ptr;
+  shard.dispatch(limit(1, Side::Bid, 100, 5));
+  shard.dispatch(limit(2, Side::Ask, 100, 5)); // same price, other symbol
+
+  const auto *b1 = shard.books_.find(1);
+  const auto *b2 = shard.books_.find(2);
+  ASSERT_NE(b1, nullptr);
+  ASSERT_NE(b2, nullptr);
+  EXPECT_EQ(b1->book.bestBid()->first, 100u);
+  EXPECT_FALSE(b2->book.bestBid().has_value());
+  EXPECT_EQ(b2->book.bestAsk()->first, 100u);
+
+  // Order ids are per book, so a cancel only reaches its own symbol
+  Client::Order cancel{};
+  cancel.instrument = 2;
+  cancel.order_type = OrderType::Cancel;
+  cancel.order_id = 1;
+  shard.dispatch(cancel);
+  EXPECT_EQ(b1->book.resting_orders(), 1u);
+  EXPECT_EQ(b2->book.resting_orders(), 0u);
+}
+
+TEST(ShardRouterTest, PartitionsByInstrumentAndKeepsOrder) {
+  std::vector<std::unique_ptr<Shard>> shards;
+  for (size_t i = 0; i < 3; i++)
+    shards.push_back(std::make_unique<Shard>(i));
+  ShardRouter router({shards[0].get(), shards[1].get(), shards[2].get()});
+
+  // Instruments 0-2 from session 7, 3-5 from session 9
+  auto staging = std::make_unique<OrderQueue>();
+  auto tags = std::make_unique<OrderTags>();
+  for (InstrumentId inst = 0; inst < 6; inst++) {
+    tags->tag(inst < 3 ? 7 : 9, 1, {inst + 1u, inst + 2u});
+    staging->enqueue(limit(inst, Side::Bid, 100 + inst, 1));
+  }
+
+  EXPECT_EQ(router.route(*staging, *tags), 6u);
+  EXPECT_TRUE(staging->peek().empty());
+
+  for (size_t s = 0; s < 3; s++) {
+    auto got = shards[s]->queue_.peek();
+    ASSERT_EQ(got.size(), 2u);
+    EXPECT_EQ(got[0].instrument, s);
+    EXPECT_EQ(got[1].instrument, s + 3);
+
+    shards[s]->tags_.refresh();
+    EXPECT_EQ(shards[s]->tags_.next(), 7u);
+    EXPECT_EQ(shards[s]->tags_.stamps().received, s + 1);
+    EXPECT_EQ(shards[s]->tags_.next(), 9u);
+    EXPECT_EQ(shards[s]->tags_.stamps().enqueued, s + 5);
+  }
+}
+
+TEST(ShardRouterTest, FullShardBlocksWithoutReordering) {
+  auto a = std::make_unique<Shard>(0);
+  auto b = std::make_unique<Shard>(1);
+  ShardRouter router({a.get(), b.get()});
+
+  // Fill shard 0's ring completely
+  while (a->queue_.enqueue(limit(0, Side::Bid, 1, 1)))
+    ;
+
+  auto staging = std::make_unique<OrderQueue>();
+  auto tags = std::make_unique<OrderTags>();
+  staging->enqueue(limit(1, Side::Bid, 1, 1));
+  staging->enqueue(limit(0, Side::Bid, 2, 1));
+  staging->enqueue(limit(1, Side::Bid, 3, 1));
+
+  EXPECT_EQ(router.route(*staging, *tags), 1u); // stops at the instrument 0 order
+  EXPECT_EQ(router.blocked(), 1u);
+  EXPECT_EQ(staging->peek().front().price, 2u);
+
+  a->queue_.consume(1);
+  EXPECT_EQ(router.route(*staging, *tags), 2u);
+  EXPECT_EQ(b->queue_.peek().size(), 2u);
+}
+
+TEST(ShardRouterTest, BatchCrossesTheShardRingWrap) {
+  auto a = std::make_unique<Shard>(0);
+  ShardRouter router({a.get()});
+  // Leave shard 0's head three slots before the end of its ring
+  for (size_t i = 0; i < ORDER_QUEUE_SIZE - 3; i++) {
+    a->queue_.enqueue(limit(0, Side::Bid, 1, 1));
+    a->queue_.consume(1);
+  }
+
+  auto staging = std::make_unique<OrderQueue>();
+  auto tags = std::make_unique<OrderTags>();
+  for (Price p = 1; p <= 8; p++)
+    staging->enqueue(limit(0, Side::Bid, p, 1));
+  EXPECT_EQ(router.route(*staging, *tags), 8u);
+
+  for (Price p = 1; p <= 8; p++) {
+    auto got = a->queue_.dequeue();
+    ASSERT_TRUE(got.has_value());
+    EXPECT_EQ(got->price, p);
+  }
+  EXPECT_FALSE(a->queue_.dequeue().has_value());
+}
+
+TEST(ShardTest, RunDrainsInputAfterClose) {
+  auto shard = std::make_unique<Shard>(0);
+  std::atomic<bool> closed{false};
+  for (Price p = 1; p <= 100; p++)
+    shard->queue_.enqueue(limit(p % 4, Side::Bid, p, 1));
+  closed.store(true);
+
+  TSCClock clock;
+  shard->set_verbose(false);
+  shard->run(shard->queue_, shard->tags_, closed, clock);
+  EXPECT_EQ(shard->processed(), 100u);
+  EXPECT_EQ(shard->books_.size(), 4u);
+}
+
+#ifdef ENABLE_TELEMETRY
+TEST(ShardTest, RunRecordsPipelineStagesOfStampedOrders) {
+  auto shard = std::make_unique<Shard>(0);
+  std::atomic<bool> closed{false};
+  TSCClock clock;
+  uint64_t now = pipeline_stamp();
+  shard->tags_.tag(OrderTags::NONE, 40, {now, now});
+  for (Price p = 1; p <= 40; p++)
+    shard->queue_.enqueue(limit(0, Side::Bid, p, 1));
+  shard->tags_.tag(OrderTags::NONE, 1); // not stamped
+  shard->queue_.enqueue(limit(0, Side::Bid, 41, 1));
+  closed.store(true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  shard->set_verbose(false);
+  shard->run(shard->queue_, shard->tags_, closed, clock);
+
+  const Telemetry &t = shard->telemetry_;
+  for (size_t s = 0; s < Telemetry::STAGES; s++)
+    EXPECT_EQ(t.latency_by_stage[s].total(), 40u)
+        << Telemetry::STAGE_NAMES[s];
+  EXPECT_EQ(t.latency_by_stage[Telemetry::NETWORK].max(), 0u);
+  EXPECT_GE(t.latency_by_stage[Telemetry::QUEUE].percentile(0.5),
+            19'000'000u);
+  EXPECT_EQ(t.queue_batches.load(), 1u);
+  EXPECT_EQ(t.queue_high_water.load(), 41u);
+}
+#endif
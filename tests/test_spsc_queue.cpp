@@ -0,0 +1,66 @@
+#include "spsc_queue.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class SPSCQueueTest : public ::testing::Test {
+protected:
+  SPSCQueue<int, 8> queue_; // 7 usable slots
+};
+
+TEST_F(SPSCQueueTest, EnqueueDequeueSingle) {
+  EXPECT_TRUE(queue_.enqueue(1));
+  EXPECT_EQ(queue_.dequeue(), 1);
+  EXPECT_FALSE(queue_.dequeue().has_value());
+}
+
+TEST_F(SPSCQueueTest, EnqueueNStopsWhenFull) {
+  std::vector<int> items{1, 2, 3, 4, 5, 6, 7, 8, 9};
+  EXPECT_EQ(queue_.try_enqueue_n(items), 7u);
+  EXPECT_FALSE(queue_.enqueue(10));
+}
+
+TEST_F(SPSCQueueTest, DequeueNWrapsAround) {
+  std::vector<int> items{1, 2, 3, 4, 5};
+  queue_.try_enqueue_n(items);
+  int out[8];
+  EXPECT_EQ(queue_.dequeue_n(std::span<int>(out, 4)), 4u);
+
+  // head is now near the end of the ring, so this batch wraps
+  std::vector<int> more{6, 7, 8, 9, 10};
+  EXPECT_EQ(queue_.try_enqueue_n(more), 5u);
+  EXPECT_EQ(queue_.dequeue_n(out), 6u);
+  EXPECT_EQ((std::vector<int>(out, out + 6)),
+            (std::vector<int>{5, 6, 7, 8, 9, 10}));
+}
+
+TEST_F(SPSCQueueTest, PeekStopsAtWrapThenConsume) {
+  std::vector<int> items{1, 2, 3, 4, 5, 6};
+  queue_.try_enqueue_n(items);
+  queue_.consume(queue_.peek().size()); // tail -> 6
+
+  std::vector<int> more{7, 8, 9, 10};
+  queue_.try_enqueue_n(more);
+
+  auto first = queue_.peek();
+  EXPECT_EQ(first.size(), 2u); // slots 6 and 7, then the ring wraps
+  EXPECT_EQ(first[0], 7);
+  queue_.consume(first.size());
+
+  auto second = queue_.peek(1);
+  ASSERT_EQ(second.size(), 1u);
+  EXPECT_EQ(second[0], 9);
+}
+
+TEST_F(SPSCQueueTest, OccupancyCountsPublishedUnconsumedItems) {
+  EXPECT_EQ(queue_.occupancy(), 0u);
+  std::vector<int> items{1, 2, 3, 4, 5, 6, 7};
+  queue_.try_enqueue_n(items);
+  EXPECT_EQ(queue_.occupancy(), 7u);
+  queue_.consume(queue_.peek(5).size());
+  EXPECT_EQ(queue_.occupancy(), 2u);
+
+  queue_.claim(3);
+  EXPECT_EQ(queue_.occupancy(), 2u); // claimed, not yet published
+  queue_.publish(3);
+  EXPECT_EQ(queue_.occupancy(), 5u);
+}
@@ -0,0 +1,140 @@
+#include "stats_reporter.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+Client::Order limit(InstrumentId instrument, Side side, Price price,
+                    Volume qty) {
+  Client::Order o{};
+  o.instrument = instrument;
+  o.order_type = OrderType::Limit;
+  o.side = side;
+  o.price = price;
+  o.quantity = qty;
+  return o;
+}
+
+// Two books: instrument 0 with bids at 3 prices, instrument 1 with one ask
+std::vector<Client::Order> resting_orders() {
+  return {limit(0, Side::Bid, 100, 1), limit(0, Side::Bid, 100, 2),
+          limit(0, Side::Bid, 99, 1), limit(0, Side::Bid, 98, 1),
+          limit(1, Side::Ask, 200, 5)};
+}
+
+StatsOptions quiet() {
+  StatsOptions opts;
+  opts.print = false;
+  return opts;
+}
+
+} // namespace
+
+TEST(StatsReporterTest, FinishedShardLeavesItsGauges) {
+  auto shard = std::make_unique<Shard>(0);
+  shard->set_verbose(false);
+  auto orders = resting_orders();
+  shard->replay(orders, TSCClock());
+
+  StatsReporter reporter({shard.get()}, nullptr, quiet());
+  reporter.sample();
+  const Client::StatsShard &s = reporter.last().shard[0];
+  EXPECT_EQ(reporter.last().shards, 1u);
+  EXPECT_EQ(s.orders, orders.size());
+  EXPECT_EQ(s.books, 2u);
+  EXPECT_EQ(s.levels, 4u);
+  EXPECT_EQ(s.resting, 5u);
+}
+
+TEST(StatsReporterTest, RunningMatcherAnswersBetweenBatches) {
+  auto shard = std::make_unique<Shard>(0);
+  shard->set_verbose(false);
+  std::atomic<bool> closed{false};
+  std::thread matcher(&Shard::run, shard.get(), std::ref(shard->queue_),
+                      std::ref(shard->tags_), std::cref(closed), TSCClock());
+
+  auto orders = resting_orders();
+  for (const Client::Order &o : orders)
+    shard->queue_.enqueue(o);
+  while (shard->telemetry_.total_orders.load() < orders.size())
+    std::this_thread::yield();
+
+  StatsReporter reporter({shard.get()}, nullptr, quiet());
+  reporter.sample();
+  uint64_t answered = shard->gauges_.answered.load();
+  closed.store(true);
+  matcher.join();
+
+  // The answer came from the idle loop, not from finish()
+  EXPECT_EQ(answered, 1u);
+  EXPECT_EQ(reporter.last().shard[0].levels, 4u);
+  EXPECT_EQ(reporter.last().shard[0].resting, 5u);
+}
+
+TEST(StatsReporterTest, PercentilesCoverOnlyTheLastInterval) {
+  auto shard = std::make_unique<Shard>(0);
+  StatsReporter reporter({shard.get()}, nullptr, quiet());
+
+  for (int i = 0; i < 1000; i++)
+    shard->telemetry_.record_latency(100'000, OrderType::Limit, false);
+  reporter.sample();
+  EXPECT_GE(reporter.last().shard[0].p50_ns, 100'000u);
+
+  for (int i = 0; i < 1000; i++)
+    shard->telemetry_.record_latency(200, OrderType::Cancel, false);
+  reporter.sample();
+  const Client::StatsShard &s = reporter.last().shard[0];
+  EXPECT_GE(s.p50_ns, 200u);
+  EXPECT_LE(s.p999_ns, 207u);
+  EXPECT_LE(s.max_ns, 207u);
+  EXPECT_EQ(reporter.last().updates, 2u);
+
+  reporter.sample();
+  EXPECT_EQ(reporter.last().shard[0].p50_ns, 0u);
+  EXPECT_EQ(reporter.last().shard[0].orders_per_sec, 0u);
+}
+
+TEST(StatsReporterTest, ReaderSeesPublishedSample) {
+  std::string name = "/fastbook_test_stats_" + std::to_string(getpid());
+  auto a = std::make_unique<Shard>(0);
+  auto b = std::make_unique<Shard>(1);
+  a->set_verbose(false);
+  a->replay(resting_orders(), TSCClock());
+
+  Ingress_Telemetry ingress;
+  ingress.record_batch(1000, 64);
+  ingress.record_syscalls(3);
+  ingress.placement.record({.core = 0, .isolated = false,
+                            .fifo_priority = 0});
+  b->telemetry_.placement.record({.core = 2, .isolated = true,
+                                  .fifo_priority = 10});
+
+  StatsReporter reporter({a.get(), b.get()}, &ingress,
+                         StatsOptions{.print = false, .shm = name});
+  ASSERT_TRUE(reporter.ok());
+  StatsReader reader(name);
+  ASSERT_TRUE(reader.ok());
+
+  reporter.sample();
+  Client::EngineStats got;
+  reader.read(got);
+  EXPECT_EQ(got.seq % 2, 0u);
+  EXPECT_EQ(got.updates, 1u);
+  EXPECT_EQ(got.shards, 2u);
+  EXPECT_EQ(got.ingress_msgs, 64u);
+  EXPECT_EQ(got.ingress_syscalls, 3u);
+  EXPECT_EQ(got.shard[0].resting, 5u);
+  EXPECT_EQ(got.shard[1].orders, 0u);
+  EXPECT_EQ(got.network_core, 0);
+  EXPECT_EQ(got.shard[0].core, -1);
+  EXPECT_EQ(got.shard[1].core, 2);
+  EXPECT_EQ(got.shard[1].core_isolated, 1u);
+  EXPECT_EQ(got.shard[1].fifo_priority, 10u);
+
+  EXPECT_FALSE(StatsReader("/fastbook_test_stats_missing").ok());
+}
@@ -0,0 +1,52 @@
+#include "TSCClock.h"
+#include <chrono>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TSCClockTest, CalibratesWithoutSleeping) {
+  auto begin = std::chrono::steady_clock::now();
+  TSCClock clock;
+  auto took = std::chrono::steady_clock::now() - begin;
+
+  const TscCalibration &cal = TSCClock::calibration();
+  EXPECT_LT(took, std::chrono::milliseconds(100)) << cal.source;
+  EXPECT_GE(cal.hz, 1e8);
+  EXPECT_LE(cal.hz, 1e10);
+  EXPECT_STRNE(cal.source, "");
+}
+
+TEST(TSCClockTest, FixedPointMatchesTheFrequency) {
+  // 1 GHz is exactly 1 ns per cycle; 3 GHz is a third of one
+  EXPECT_EQ(TSCClock::mult_for(1e9), uint64_t{1} << 32);
+  EXPECT_EQ(TSCClock::mult_for(3e9), 1'431'655'765u); // 2^32 / 3, rounded
+
+  TSCClock clock;
+  double ns_per_cycle = 1e9 / TSCClock::calibration().hz;
+  EXPECT_NEAR(double(clock.cycles_to_nanoseconds(1'000'000'000)),
+              1e9 * ns_per_cycle, 1e9 * ns_per_cycle * 0.02);
+}
+
+TEST(TSCClockTest, ConversionTracksTheSystemClock) {
+  TSCClock clock;
+  auto begin = std::chrono::steady_clock::now();
+  uint64_t start = clock.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  uint64_t cycles = clock.stop() - start;
+  double wall = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+
+  double ns = double(clock.cycles_to_nanoseconds(cycles));
+  EXPECT_NEAR(ns / wall, 1.0, 0.02);
+}
+
+TEST(TSCClockTest, MeasuredAndCorrectedFrequencyAgree) {
+  const TscCalibration &cal = TSCClock::calibration();
+  double measured = TSCClock::measure_hz(std::chrono::milliseconds(20));
+  EXPECT_NEAR(measured / cal.hz, 1.0, 0.02);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  double corrected = TSCClock::correct_drift();
+  EXPECT_NEAR(corrected / cal.hz, 1.0, 0.02);
+}
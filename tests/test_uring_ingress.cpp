@@ -0,0 +1,122 @@
+#include "uring_ingress.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <gtest/gtest.h>
+#include <map>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Collector {
+  std::vector<int> accepted;
+  std::map<uint32_t, std::string> data;
+  std::map<uint32_t, int> closed;
+
+  void on_accept(int fd) { accepted.push_back(fd); }
+  void on_data(uint32_t session, const uint8_t *p, size_t len) {
+    data[session].append(reinterpret_cast<const char *>(p), len);
+  }
+  void on_close(uint32_t session, int res) { closed[session] = res; }
+};
+
+// Polls until `done` holds or the spin budget runs out
+template <typename Done>
+bool poll_until(UringIngress &uring, Collector &c, Done done) {
+  for (int spins = 0; spins < 1'000'000; spins++) {
+    if (done())
+      return true;
+    uring.poll(c);
+  }
+  return done();
+}
+
+} // namespace
+
+class UringIngressTest : public ::testing::Test {
+protected:
+  int fds_[2];
+
+  void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+  }
+  void TearDown() override {
+    close(fds_[0]);
+    if (fds_[1] >= 0)
+      close(fds_[1]);
+  }
+};
+
+TEST_F(UringIngressTest, MultishotRecvDeliversAcrossBufferRecycles) {
+  UringIngress uring(UringOptions{.buffers = 4, .buffer_size = 64});
+  if (!uring.ok() || !uring.watch_recv(fds_[0], 7))
+    GTEST_SKIP() << "io_uring multishot recv not available";
+
+  // More writes than provided buffers, so buffers must be recycled
+  Collector c;
+  std::string sent;
+  for (int i = 0; i < 16; i++) {
+    std::string chunk(50, static_cast<char>('a' + i));
+    ASSERT_EQ(write(fds_[1], chunk.data(), chunk.size()), 50);
+    sent += chunk;
+    poll_until(uring, c, [&] { return c.data[7].size() == sent.size(); });
+  }
+  EXPECT_EQ(c.data[7], sent);
+
+  close(fds_[1]);
+  fds_[1] = -1;
+  ASSERT_TRUE(poll_until(uring, c, [&] { return c.closed.count(7) > 0; }));
+  EXPECT_EQ(c.closed[7], 0); // EOF
+}
+
+TEST(UringIngressAcceptTest, MultishotAcceptFeedsSeparateSessions) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listener, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr *>(&addr), len), 0);
+  ASSERT_EQ(listen(listener, 8), 0);
+  ASSERT_EQ(getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len),
+            0);
+
+  UringIngress uring(UringOptions{.buffers = 8, .buffer_size = 256});
+  if (!uring.ok() || !uring.watch_accept(listener)) {
+    close(listener);
+    GTEST_SKIP() << "io_uring multishot accept not available";
+  }
+
+  Collector c;
+  int clients[2];
+  for (int &fd : clients) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&addr), len), 0);
+  }
+  ASSERT_TRUE(poll_until(uring, c, [&] { return c.accepted.size() == 2; }));
+  for (uint32_t s = 0; s < 2; s++) {
+    ASSERT_GE(c.accepted[s], 0);
+    ASSERT_TRUE(uring.watch_recv(c.accepted[s], s));
+  }
+
+  // Accept order is not connect order, so match sessions by content
+  ASSERT_EQ(write(clients[0], "first", 5), 5);
+  ASSERT_EQ(write(clients[1], "second", 6), 6);
+  ASSERT_TRUE(poll_until(uring, c, [&] {
+    return c.data[0].size() + c.data[1].size() == 11;
+  }));
+  EXPECT_TRUE((c.data[0] == "first" && c.data[1] == "second") ||
+              (c.data[0] == "second" && c.data[1] == "first"));
+
+  // One session leaving does not disturb the other
+  close(clients[0]);
+  close(clients[1]);
+  ASSERT_TRUE(poll_until(uring, c, [&] { return c.closed.size() == 2; }));
+
+  for (int fd : c.accepted)
+    close(fd);
+  close(listener);
+}